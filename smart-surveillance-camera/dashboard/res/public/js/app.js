@@ -14,10 +14,11 @@
  * limitations under the License.
  */
 
-const IMG_WIDTH = 640;
-const IMG_HEIGHT = 480;
-const CANVAS_WIDTH = 640;
-const CANVAS_HEIGHT = 480;
+// The camera resolution is chosen at runtime, the view keeps its aspect ratio inside this box
+const VIEW_WIDTH = 640;
+const VIEW_HEIGHT = 480;
+const VIEW_LEFT = 90;
+const VIEW_TOP = 65;
 
 window.onload = function(){
     var canvas;
@@ -113,13 +114,16 @@ window.onload = function(){
         fileReader.onload = function(event) {
             arrayBuffer = event.target.result;
             var exif = EXIF.readFromBinaryFile(arrayBuffer);
+            canvas.fitView(exif.PixelXDimension, exif.PixelYDimension);
+            update_latency(getCaptureTime(exif));
             var exifInfoString = asciiToStr(exif.UserComment, 8);
             var type = 'blur';
             if (getResultType(exifInfoString) != 0) {
                 type = 'active';
             }
 
-            var pointArray = getPointArrayFromString(exifInfoString.slice(4));
+            var pointArray = getPointArrayFromString(exifInfoString);
+            var trackArray = getTrackArrayFromString(exifInfoString, pointArray.length);
 
             if (pointArray.length <= 0) {
                 document.querySelector("#mobile-detection").innerHTML = "No<br>Motion";
@@ -129,6 +133,7 @@ window.onload = function(){
 
             canvas.clearPoints();
             canvas.drawPoints(pointArray, type);
+            canvas.drawTracks(trackArray);
         };
         fileReader.readAsArrayBuffer(evt.data);
 
@@ -169,6 +174,23 @@ window.onload = function(){
         output.appendChild(pre);
     }
 
+    // Glass to glass, assumes the camera and this browser have synchronised clocks
+    function update_latency(captureTime) {
+        var latencyTag = document.getElementById('latency');
+        if (latencyTag == null || !captureTime)
+            return;
+        latencyTag.innerHTML = 'latency: ' + (Date.now() - captureTime) + ' ms';
+    }
+
+    // The camera writes DateTimeOriginal in UTC, "YYYY:MM:DD HH:MM:SS", and the milliseconds in SubsecTimeOriginal
+    function getCaptureTime(exif) {
+        var match = /^(\d{4}):(\d{2}):(\d{2}) (\d{2}):(\d{2}):(\d{2})/.exec(exif.DateTimeOriginal);
+        if (!match)
+            return 0;
+        return Date.UTC(match[1], match[2] - 1, match[3], match[4], match[5], match[6])
+            + (Number(exif.SubsecTimeOriginal) || 0);
+    }
+
     function asciiToStr(asciiArr, start) {
         var string = "";
         var i = start;
@@ -184,19 +206,40 @@ window.onload = function(){
         return Number(str.slice(0, 2));
     }
 
-    function getPointArrayFromString(pointStr) {
-        var strLen = pointStr.length;
+    // TTNN then NN regions of 8 digits, the tracks follow
+    function getPointArrayFromString(str) {
+        var count = Number(str.slice(2, 4)) || 0;
         var i = 0;
         var pointArray = [];
 
-        while (i < strLen) {
-            pointArray.push(pointStr.slice(i, i + 8));
-            i += 8;
+        for (i = 0; i < count; i++) {
+            var point = str.slice(4 + i * 8, 12 + i * 8);
+            if (point.length < 8)
+                break;
+            pointArray.push(point);
         }
 
         return pointArray;
     }
 
+    // MMPP then MM tracks of 16 digits, iixxyywwhhuuvvaa, older cameras send no track section
+    function getTrackArrayFromString(str, pointCount) {
+        var trackStr = str.slice(4 + pointCount * 8);
+        var count = Number(trackStr.slice(0, 2)) || 0;
+        var primary = trackStr.slice(2, 4);
+        var i = 0;
+        var trackArray = [];
+
+        for (i = 0; i < count; i++) {
+            var track = trackStr.slice(4 + i * 16, 20 + i * 16);
+            if (track.length < 16)
+                break;
+            trackArray.push({ id: track.slice(0, 2), point: track.slice(2, 10), primary: track.slice(0, 2) == primary });
+        }
+
+        return trackArray;
+    }
+
     var step = 0
     const total_steps = 8
     setInterval(function() {
@@ -222,10 +265,39 @@ window.onload = function(){
 function Canvas(canvasId) {
     this.viewCanvas = document.getElementById(canvasId);
     this.viewContext = this.viewCanvas.getContext("2d");
+    this.imageWidth = 0;
+    this.imageHeight = 0;
+}
+
+Canvas.prototype.fitView = function(imageWidth, imageHeight) {
+    if (!imageWidth || !imageHeight)
+        return;
+    if (imageWidth == this.imageWidth && imageHeight == this.imageHeight)
+        return;
+
+    this.imageWidth = imageWidth;
+    this.imageHeight = imageHeight;
+
+    var scale = Math.min(VIEW_WIDTH / imageWidth, VIEW_HEIGHT / imageHeight);
+    var width = Math.round(imageWidth * scale);
+    var height = Math.round(imageHeight * scale);
+    var left = (VIEW_LEFT + (VIEW_WIDTH - width) / 2) + 'px';
+    var top = (VIEW_TOP + (VIEW_HEIGHT - height) / 2) + 'px';
+
+    var view = document.getElementById('camera-view');
+    view.style.width = width + 'px';
+    view.style.height = height + 'px';
+    view.style.left = left;
+    view.style.top = top;
+
+    this.viewCanvas.width = width;
+    this.viewCanvas.height = height;
+    this.viewCanvas.style.left = left;
+    this.viewCanvas.style.top = top;
 }
 
 Canvas.prototype.clearCanvas = function() {
-    this.viewContext.clearRect(0,0, CANVAS_WIDTH, CANVAS_HEIGHT);
+    this.viewContext.clearRect(0,0, this.viewCanvas.width, this.viewCanvas.height);
 }
 
 Canvas.prototype.clearPoints = function () {
@@ -255,12 +327,27 @@ Canvas.prototype.drawPoints = function (pointArray, type) {
         color = "rgba(255,0,0, 0.8)";
     }
 
+    // Regions are in 0 ~ 99 of the image, whatever its resolution is
     for (i = 0; i < pointArray.length; i++) {
-        x = IMG_WIDTH / 99 * parseInt(pointArray[i].slice(0,2));
-        y = IMG_HEIGHT / 99 * parseInt(pointArray[i].slice(2,4));
-        w = IMG_WIDTH / 99 * parseInt(pointArray[i].slice(4,6));
-        h = IMG_HEIGHT / 99 * parseInt(pointArray[i].slice(6,8));
+        x = this.viewCanvas.width / 99 * parseInt(pointArray[i].slice(0,2));
+        y = this.viewCanvas.height / 99 * parseInt(pointArray[i].slice(2,4));
+        w = this.viewCanvas.width / 99 * parseInt(pointArray[i].slice(4,6));
+        h = this.viewCanvas.height / 99 * parseInt(pointArray[i].slice(6,8));
 
         this.drawRect(x, y, w, h, color);
     }
 }
+
+Canvas.prototype.drawTracks = function (trackArray) {
+    var i = 0;
+    var x, y;
+
+    this.viewContext.font = "16px sans-serif";
+    for (i = 0; i < trackArray.length; i++) {
+        x = this.viewCanvas.width / 99 * parseInt(trackArray[i].point.slice(0,2));
+        y = this.viewCanvas.height / 99 * parseInt(trackArray[i].point.slice(2,4));
+
+        this.viewContext.fillStyle = trackArray[i].primary ? "rgba(255,200,0,0.9)" : "rgba(57,160,232,0.9)";
+        this.viewContext.fillText(trackArray[i].id, x + 4, y + 18);
+    }
+}
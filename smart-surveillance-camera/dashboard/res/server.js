@@ -19,6 +19,7 @@ var http = require('http');
 
 var SERVER_ROOT_FOLDER_PATH = '/opt/usr/globalapps/org.tizen.smart-surveillance-camera.dashboard/res/';
 var LATEST_FRAME_FILE_PATH = '/opt/usr/home/owner/apps_rw/org.tizen.smart-surveillance-camera/shared/data/latest.jpg'
+var SHARED_DATA_FOLDER_PATH = '/opt/usr/home/owner/apps_rw/org.tizen.smart-surveillance-camera/shared/data/';
 
 function extractPath(url) {
   var urlParts = url.split('/'),
@@ -50,6 +51,19 @@ http.createServer(function(req, res) {
     } else if (req.url == '/css/style.css') {
       res.writeHead(200);
       res.end(fs.readFileSync(SERVER_ROOT_FOLDER_PATH + 'public/css/style.css'));
+    } else if (path[0] == 'heatmap') {
+      // /heatmap for camera 0, /heatmap/<camera> for the others
+      var camera = parseInt(path[1] || '0', 10);
+      var file = camera > 0 ? 'heatmap_' + camera + '.json' : 'heatmap.json';
+      try {
+        var heatmap = fs.readFileSync(SHARED_DATA_FOLDER_PATH + file);
+        res.setHeader('Content-Type', 'application/json');
+        res.writeHead(200);
+        res.end(heatmap);
+      } catch (err) {
+        res.writeHead(404);
+        res.end();
+      }
     } else {
       res.setHeader('Location', 'http://download.tizen.online/smart-surveillance' + req.url);
       res.writeHead(302);
@@ -0,0 +1,52 @@
+ /*
+ * Copyright (c) 2018 Samsung Electronics Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __ANALYSIS_WORKER_H__
+#define __ANALYSIS_WORKER_H__
+
+#include <camera.h>
+#include "resource_camera.h"
+
+/*
+ * A thread of its own that analyses the frames of one camera, off the main loop.
+ * The main loop hands frames over one at a time, a frame still waiting when the next one
+ * comes is dropped, so the worker always picks up the latest frame.
+ * The worker posts result messages back, the main loop handles them in order.
+ * With ANALYSIS_ON_MAIN_LOOP everything runs inside analysis_worker_push() instead.
+ */
+
+typedef struct __analysis_worker_s *analysis_worker_h;
+
+/* On the worker, the frame is released when it returns */
+typedef void (*analysis_worker_analyse_cb)(image_buffer_data_s *image_buffer, void *user_data);
+/* On the main loop, message is freed when it returns */
+typedef void (*analysis_worker_result_cb)(void *message, void *user_data);
+
+analysis_worker_h analysis_worker_create(analysis_worker_analyse_cb analyse_cb,
+	analysis_worker_result_cb result_cb, void *user_data);
+/* On the main loop, waits for the frame in analysis. Messages not handled yet are dropped */
+void analysis_worker_destroy(analysis_worker_h worker);
+
+/* On the main loop, takes over the reference of image_buffer */
+int analysis_worker_push(analysis_worker_h worker, image_buffer_data_s *image_buffer);
+
+/* From analyse_cb, takes over message, a malloc()ed block */
+void analysis_worker_post(analysis_worker_h worker, void *message);
+
+/* Frames dropped for a newer one since the worker was created */
+unsigned int analysis_worker_get_dropped(analysis_worker_h worker);
+
+#endif /* __ANALYSIS_WORKER_H__ */
@@ -19,12 +19,34 @@
 
 #define MV_RESULT_COUNT_MAX 30
 #define MV_RESULT_LENGTH_MAX (MV_RESULT_COUNT_MAX * 4) //4(x, y, w, h) * COUNT
-#define IMAGE_INFO_MAX ((8 * MV_RESULT_LENGTH_MAX) + 4)
+#define MV_TRACK_MAX 8 // objects followed per camera, reported after the regions
+#define IMAGE_INFO_MAX ((8 * MV_RESULT_LENGTH_MAX) + 4 + (16 * MV_TRACK_MAX) + 4)
+#define MV_REGION_MAX 512 // moving regions handled per event, every stream preallocates room for this many
+#define MV_ANALYSIS_DECIMATION 2 // movement detection runs on the luma plane at 1/2 (1, 2 or 4) of the preview size
+#define MV_MERGE_GAP_DEFAULT 2 // percent of the frame width, moving regions closer than this are reported as one
+#define MV_MERGE_IOU_DEFAULT 0 // percent, off, the gap already merges every overlap
+#define MV_ACTIVITY_FLOOR_DEFAULT 2 // changed samples of the activity grid a frame needs to reach the engine, 0 sends every frame
+#define MV_ACTIVITY_KEEP_ALIVE_MS 1000 // a still scene still reaches the engine this often, its background stays fresh
 
-#define IMAGE_WIDTH 320
+#define CAMERA_COUNT 1 // cameras run as independent pipelines, camera 0 is the one on the servo mount
+#define IMAGE_WIDTH 320 // default preview, camera_profile.ini in the app data directory overrides it
 #define IMAGE_HEIGHT 240
 #define CAMERA_IMAGE_QUALITY 100 //1~100
-#define CAMERA_PREVIEW_INTERVAL_MIN 50
+#define CAMERA_PREVIEW_FPS_MAX 20 // while motion is tracked
+#define CAMERA_PREVIEW_FPS_IDLE 3
+#define CAMERA_SCENE_IDLE_TIMEOUT_MS 5000 // no motion for this long lowers the rate to CAMERA_PREVIEW_FPS_IDLE
+#define CAMERA_FRAME_QUEUE_SIZE 4
+#define CAMERA_FRAME_QUEUE_POLICY FRAME_QUEUE_DROP_OLDEST
+#define CAMERA_FRAME_QUEUE_BATCH 2 // frames handled per main loop iteration
+#define CAMERA_FRAME_POOL_SIZE (CAMERA_FRAME_QUEUE_SIZE + 5) // + frame being filled, waiting for analysis, in analysis, latest slot and writer
+#define CAMERA_CAPTURE_POOL_SIZE 2 // full resolution JPEG stills, one being captured and one being written
+#define CAMERA_CAPTURE_STOP_TIMEOUT_MS 3000 // a still in flight when the camera stops is waited for this long
+// #define ENABLE_CAMERA_ZERO_COPY // wrap camera media packets instead of copying preview planes
+// #define IMAGE_KERNEL_NO_SIMD // scalar image kernels only, to compare against the NEON / SSE2 ones
+// #define CONTROLLER_MV_BENCHMARK // log the cost of region handling per event at start
+// #define ANALYSIS_ON_MAIN_LOOP // analyse frames on the main loop instead of a worker per camera, main_loop_lag in frame_trace.json shows the difference
+// #define CONTROLLER_MV_NO_MEDIA_VISION // build without mv_surveillance, only the motion engine is left
+// #define CAMERA_BACKEND_SYNTHETIC // replay files or render a test scene instead of opening the camera
 
 //카메라와 모터에 따라 최적화 필요한 값 --------------------------------
 #define SERVO_MOTOR_VERTICAL_MIN 20
@@ -0,0 +1,67 @@
+ /*
+ * Copyright (c) 2018 Samsung Electronics Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef __CONTROLLER_CLASSIFIER_H__
+#define __CONTROLLER_CLASSIFIER_H__
+
+#include <camera.h>
+#include "resource_camera.h"
+#include "controller_tracker.h"
+
+/*
+ * Second stage after movement detection: the moving regions that passed the size filter are cropped
+ * from the full resolution luma and handed, batched, to a more expensive classifier backend.
+ * A region that belongs to a track classified a short while ago is not classified again,
+ * the main loop publishes its tracks and their verdicts for this.
+ */
+
+typedef enum {
+	CONTROLLER_CLASSIFIER_VERDICT_NONE = -1, // not classified
+	CONTROLLER_CLASSIFIER_VERDICT_OTHER = 0,
+	CONTROLLER_CLASSIFIER_VERDICT_PERSON = 1,
+} controller_classifier_verdict_e;
+
+typedef enum {
+	CONTROLLER_CLASSIFIER_ENGINE_NONE, // no second stage, every movement counts
+	CONTROLLER_CLASSIFIER_ENGINE_FACE, // media vision face detection
+	CONTROLLER_CLASSIFIER_ENGINE_SHAPE, // built-in upright shape check, a CPU stand-in
+	CONTROLLER_CLASSIFIER_ENGINE_MAX,
+} controller_classifier_engine_e;
+
+typedef struct __classifier_data *controller_classifier_h;
+
+/* "none", "face" or "shape", -1 for unknown names */
+int controller_classifier_engine_from_name(const char *name, controller_classifier_engine_e *engine);
+
+/* NULL for CONTROLLER_CLASSIFIER_ENGINE_NONE too */
+controller_classifier_h controller_classifier_create(controller_classifier_engine_e engine);
+void controller_classifier_destroy(controller_classifier_h classifier);
+const char *controller_classifier_get_engine_name(controller_classifier_h classifier);
+
+/*
+ * On the analysis worker. result holds result_count x, y, width, height quadruples in percent of image_buffer,
+ * verdicts gets one controller_classifier_verdict_e per region, VERDICT_NONE where the track verdict is still fresh
+ */
+void controller_classifier_classify(controller_classifier_h classifier, const image_buffer_data_s *image_buffer,
+	const int result[], int result_count, long long int now_ms, int verdicts[]);
+
+/* On the main loop, the tracks the next classify calls look up */
+void controller_classifier_publish_tracks(controller_classifier_h classifier,
+	const controller_tracker_track_s *tracks, int track_count);
+
+/* Regions classified and regions skipped for a fresh track verdict, since the previous call */
+void controller_classifier_get_stats(controller_classifier_h classifier, unsigned int *classified, unsigned int *skipped);
+
+#endif /* __CONTROLLER_CLASSIFIER_H__ */
@@ -0,0 +1,46 @@
+ /*
+ * Copyright (c) 2018 Samsung Electronics Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef __CONTROLLER_CLASSIFIER_ENGINE_H__
+#define __CONTROLLER_CLASSIFIER_ENGINE_H__
+
+/*
+ * Classifier backends behind controller_classifier.
+ * A backend only tells what every crop shows, cropping, batching and the per track cache stay in controller_classifier.c.
+ */
+
+#define CLASSIFIER_CROP_MAX 160 // longest side of a crop in pixels
+
+/* Luma of one moving region with a margin around it, scaled down to CLASSIFIER_CROP_MAX at most */
+typedef struct __controller_classifier_crop_s {
+	const unsigned char *data; // width x height, rows are not padded
+	unsigned int width;
+	unsigned int height;
+} controller_classifier_crop_s;
+
+typedef struct __controller_classifier_engine_s {
+	const char *name;
+	/* Returns the engine context, NULL on failure */
+	void *(*create)(void);
+	/* Fills verdicts with a controller_classifier_verdict_e per crop, the crops are only borrowed for the call */
+	int (*classify)(void *engine, const controller_classifier_crop_s *crops, unsigned int count, int verdicts[]);
+	void (*destroy)(void *engine);
+} controller_classifier_engine_s;
+
+/* controller_classifier_engine_face is not built with CONTROLLER_MV_NO_MEDIA_VISION */
+extern const controller_classifier_engine_s controller_classifier_engine_face;
+extern const controller_classifier_engine_s controller_classifier_engine_shape;
+
+#endif /* __CONTROLLER_CLASSIFIER_ENGINE_H__ */
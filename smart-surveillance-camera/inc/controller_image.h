@@ -17,11 +17,17 @@
 #ifndef __CONTROLLER_IMAGE_H__
 #define __CONTROLLER_IMAGE_H__
 
+#include <camera.h>
+
 void controller_image_initialize(void);
 void controller_image_finalize(void);
+/*
+ * buffer is a tightly packed frame in format, YUV formats are converted to I420 before encoding.
+ * capture_time_ms is the wall clock of the capture in ms since the epoch, 0 leaves it out of the EXIF.
+ */
 int controller_image_save_image_file(const char *path,
-	unsigned int width, unsigned int height, const unsigned char *buffer,
-	const char *comment, unsigned int comment_len);
+	unsigned int width, unsigned int height, camera_pixel_format_e format, const unsigned char *buffer,
+	const char *comment, unsigned int comment_len, long long int capture_time_ms);
 int controller_image_read_image_file(const char *path,
 	unsigned int *width, unsigned int *height, unsigned char *buffer, unsigned long long *size);
 #endif
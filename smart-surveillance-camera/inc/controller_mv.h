@@ -16,15 +16,70 @@
 
 #ifndef __CONTROLLER_MV_H__
 #define __CONTROLLER_MV_H__
-#include <mv_common.h>
+#include <camera.h>
+#include "resource_camera.h"
+#include "controller_mv_mask.h"
 
 typedef void (*movement_detected_cb)(int horizontal, int vertical, int result[], int result_count, void *user_data);
 
-mv_source_h controller_mv_create_source(
-		unsigned char *buffer, unsigned int size,
-		unsigned int width, unsigned int height, mv_colorspace_e colorspace);
-void controller_mv_push_source(mv_source_h source);
-int controller_mv_set_movement_detection_event_cb(movement_detected_cb movement_detected_cb, void *user_data);
-void controller_mv_unset_movement_detection_event_cb(void);
+typedef struct __mv_data *controller_mv_h;
+
+typedef enum {
+	CONTROLLER_MV_ENGINE_MEDIA_VISION, // mv_surveillance movement detection
+	CONTROLLER_MV_ENGINE_MOTION, // built-in luma frame differencing
+	CONTROLLER_MV_ENGINE_MAX,
+} controller_mv_engine_e;
+
+/* "media_vision" or "motion", -1 for unknown names */
+int controller_mv_engine_from_name(const char *name, controller_mv_engine_e *engine);
+const char *controller_mv_get_engine_name(controller_mv_h mv);
+
+/* Engines analyse the Y plane at 1 / decimation of the frame size, 1, 2 or 4. Regions are reported in frame pixels. Before the first push */
+int controller_mv_set_decimation(controller_mv_h mv, unsigned int decimation);
+
+/* Changed samples of a sparse luma grid a frame needs to reach the engine, a still scene still does every MV_ACTIVITY_KEEP_ALIVE_MS. 0 sends every frame. Before the first push */
+int controller_mv_set_activity_floor(controller_mv_h mv, unsigned int floor);
+
+/* Frames the engine analysed and frames left out as still since the last call. From any thread */
+void controller_mv_get_activity_stats(controller_mv_h mv, unsigned int *analysed, unsigned int *skipped);
+
+/* Regions at most gap percent of the frame width apart (-1 for none), or overlapping by iou percent (0 for none), are reported as one. Before the first push */
+int controller_mv_set_merge(controller_mv_h mv, int gap, unsigned int iou);
+
+/* Luma difference of a moving pixel, 0 (default) measures it from the sensor noise and follows its drift. Before the first push */
+int controller_mv_set_threshold(controller_mv_h mv, unsigned int threshold);
+
+/* The camera was moved, the background learnt so far is dropped. From any thread, it applies from the next push */
+void controller_mv_reset(controller_mv_h mv);
+
+/*
+ * The camera starts turning, the view is meant to shift by view_x, view_y percent of the frame.
+ * Engines that can follow the view keep detecting, the others are reset. From any thread, it applies from the next push
+ */
+void controller_mv_turn(controller_mv_h mv, float view_x, float view_y);
+
+/* View shift in percent measured by the last push, -1 when it lost a turning view and the scene is relearnt. From the pushing thread */
+int controller_mv_get_view_shift(controller_mv_h mv, float *view_x, float *view_y);
+
+/* JSON snapshot of where the still view moved lately, see controller_mv_heatmap.h. From any thread, g_free() it */
+char *controller_mv_get_heatmap(controller_mv_h mv);
+/* Continues the heat map of an earlier run from its snapshot, before the first push */
+int controller_mv_load_heatmap(controller_mv_h mv, const char *json);
+
+/* Takes over mask, NULL analyses the whole frame. From any thread, it applies from the next push */
+void controller_mv_set_mask(controller_mv_h mv, controller_mv_mask_h mask);
+
+/* Analyses the frame, movement_detected_cb runs inside the call on the same thread. The frame is only borrowed */
+void controller_mv_push_source(controller_mv_h mv, const image_buffer_data_s *image_buffer);
+
+/* One analysis context per video stream, streams are independent of each other */
+controller_mv_h controller_mv_create(int video_stream_id, controller_mv_engine_e engine,
+	movement_detected_cb movement_detected_cb, void *user_data);
+void controller_mv_destroy(controller_mv_h mv);
+
+#ifdef CONTROLLER_MV_BENCHMARK
+/* Logs the cost of __movement_detected_event_cb at 1, 30 and 300 regions */
+void controller_mv_benchmark(void);
+#endif
 
 #endif
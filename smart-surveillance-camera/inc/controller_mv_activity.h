@@ -0,0 +1,43 @@
+ /*
+ * Copyright (c) 2018 Samsung Electronics Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef __CONTROLLER_MV_ACTIVITY_H__
+#define __CONTROLLER_MV_ACTIVITY_H__
+
+#include "controller_mv_engine.h"
+
+/*
+ * Cheap scene activity check ahead of the engine.
+ * A sparse grid of the luma is compared with the grid of the last analysed frame, not the previous one,
+ * so slow changes add up until they are seen. Samples off by more than the detection threshold count as changed.
+ */
+
+typedef struct __mv_activity_s *controller_mv_activity_h;
+
+controller_mv_activity_h controller_mv_activity_create(void);
+void controller_mv_activity_destroy(controller_mv_activity_h activity);
+
+/* Changed samples of the unmasked grid, -1 when no analysed frame of this size is kept */
+int controller_mv_activity_measure(controller_mv_activity_h activity, const controller_mv_luma_s *luma, unsigned int threshold);
+
+/* The luma of the last measure is analysed, its grid is compared with from now on */
+void controller_mv_activity_keep(controller_mv_activity_h activity);
+
+/* The view changed, the next frame is measured as -1 */
+void controller_mv_activity_reset(controller_mv_activity_h activity);
+
+#endif /* __CONTROLLER_MV_ACTIVITY_H__ */
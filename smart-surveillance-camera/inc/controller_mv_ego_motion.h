@@ -0,0 +1,44 @@
+ /*
+ * Copyright (c) 2018 Samsung Electronics Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __CONTROLLER_MV_EGO_MOTION_H__
+#define __CONTROLLER_MV_EGO_MOTION_H__
+
+#include "controller_mv_engine.h"
+
+/*
+ * Shift of the whole view between two analysed frames, while the servo turns the camera.
+ * Every luma is reduced to a column and a row profile, the shift is where the profiles of
+ * two frames match best. A pan or a tilt of a few degrees is close enough to a translation.
+ */
+
+typedef struct __mv_ego_motion_s *controller_mv_ego_motion_h;
+
+controller_mv_ego_motion_h controller_mv_ego_motion_create(void);
+void controller_mv_ego_motion_destroy(controller_mv_ego_motion_h ego_motion);
+
+/* Keeps the profiles of luma, the ones of the previous push become the reference */
+void controller_mv_ego_motion_push(controller_mv_ego_motion_h ego_motion, const controller_mv_luma_s *luma);
+
+/*
+ * Shift of the last pushed luma against the one before, current(x, y) ~ previous(x - dx, y - dy).
+ * Only shifts in [min_dx, max_dx] x [min_dy, max_dy] are tried.
+ * Returns -1 when there is no reference or the view is too flat for a reliable match.
+ */
+int controller_mv_ego_motion_estimate(controller_mv_ego_motion_h ego_motion,
+	int min_dx, int max_dx, int min_dy, int max_dy, int *dx, int *dy);
+
+#endif /* __CONTROLLER_MV_EGO_MOTION_H__ */
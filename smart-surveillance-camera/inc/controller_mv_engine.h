@@ -0,0 +1,66 @@
+ /*
+ * Copyright (c) 2018 Samsung Electronics Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __CONTROLLER_MV_ENGINE_H__
+#define __CONTROLLER_MV_ENGINE_H__
+
+#include "controller_mv_mask.h"
+
+/*
+ * Detection backends behind controller_mv.
+ * An engine only finds moving regions, filtering and the movement_detected_cb contract stay in controller_mv.c.
+ */
+
+#define MV_MOVEMENT_DETECTION_THRESHOLD 50 // luma difference of a moving pixel [0 ~ 255] until the noise is measured, media vision default is 10
+
+/* Luma plane handed to the engines, already decimated by controller_mv */
+typedef struct __controller_mv_luma_s {
+	const unsigned char *data; // width x height, rows are not padded
+	unsigned int width;
+	unsigned int height;
+	controller_mv_mask_h mask; // rasterized for width x height, NULL when every pixel is analysed
+} controller_mv_luma_s;
+
+typedef struct __controller_mv_region_s {
+	int x; // in pixels of the pushed luma plane
+	int y;
+	int width;
+	int height;
+} controller_mv_region_s;
+
+/* Called inside push, only when something moved. count is MV_REGION_MAX at most */
+typedef void (*controller_mv_regions_cb)(const controller_mv_region_s *regions, unsigned int count, void *user_data);
+
+typedef struct __controller_mv_engine_s {
+	const char *name;
+	/* Returns the engine context, NULL on failure */
+	void *(*create)(int video_stream_id, controller_mv_regions_cb regions_cb, void *user_data);
+	/* Analyses one frame, the plane is only borrowed for the call */
+	int (*push)(void *engine, const controller_mv_luma_s *luma);
+	void (*destroy)(void *engine);
+	/* Forgets the learnt scene, NULL when the engine cannot */
+	void (*reset)(void *engine);
+	/* Luma difference of a moving pixel from the next push on */
+	int (*set_threshold)(void *engine, unsigned int threshold);
+	/* The camera turned, the next luma shows the scene moved by dx, dy pixels. NULL when the engine cannot follow, it is reset instead */
+	void (*shift)(void *engine, int dx, int dy);
+} controller_mv_engine_s;
+
+/* controller_mv_engine_media_vision is not built with CONTROLLER_MV_NO_MEDIA_VISION */
+extern const controller_mv_engine_s controller_mv_engine_media_vision;
+extern const controller_mv_engine_s controller_mv_engine_motion;
+
+#endif /* __CONTROLLER_MV_ENGINE_H__ */
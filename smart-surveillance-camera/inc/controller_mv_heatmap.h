@@ -0,0 +1,57 @@
+ /*
+ * Copyright (c) 2018 Samsung Electronics Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef __CONTROLLER_MV_HEATMAP_H__
+#define __CONTROLLER_MV_HEATMAP_H__
+
+#define HEATMAP_COLUMNS 40
+#define HEATMAP_ROWS 30
+
+/*
+ * Where movement happens over hours and days, for site tuning.
+ * Every cell counts the frames a reported region covered it, against the frames analysed, both in 24.8 fixed point.
+ * A region costs four updates of a difference grid, it is summed into the map and decayed every few minutes.
+ * Both counts halve every HEATMAP_HALF_LIFE_HOURS, so old layouts of the scene fade out.
+ * Thread safe, frames and regions come from the analysis, snapshots from anywhere.
+ */
+
+typedef struct __mv_heatmap_s *controller_mv_heatmap_h;
+
+controller_mv_heatmap_h controller_mv_heatmap_create(void);
+void controller_mv_heatmap_destroy(controller_mv_heatmap_h heatmap);
+
+/* One more analysed frame of a still view, time_us drives the decay */
+void controller_mv_heatmap_add_frame(controller_mv_heatmap_h heatmap, long long int time_us);
+
+/* A region of the last added frame, in pixels of a width x height frame */
+void controller_mv_heatmap_add_region(controller_mv_heatmap_h heatmap, int x, int y, int w, int h,
+	unsigned int width, unsigned int height);
+
+/*
+ * JSON of the cells, per mille of the analysed frames they saw movement in, row by row.
+ * "exclude" suggests the busiest cells as polygons for camera_profile.ini once enough frames were seen.
+ * g_free() it
+ */
+char *controller_mv_heatmap_snapshot(controller_mv_heatmap_h heatmap);
+
+/*
+ * Seeds the map from a snapshot of an earlier run, faded by the time it was saved before.
+ * Per mille cells lose a little precision. Fails on a snapshot of another grid, the map is left empty then
+ */
+int controller_mv_heatmap_load(controller_mv_heatmap_h heatmap, const char *json);
+
+#endif /* __CONTROLLER_MV_HEATMAP_H__ */
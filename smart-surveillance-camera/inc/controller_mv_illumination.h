@@ -0,0 +1,40 @@
+ /*
+ * Copyright (c) 2018 Samsung Electronics Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef __CONTROLLER_MV_ILLUMINATION_H__
+#define __CONTROLLER_MV_ILLUMINATION_H__
+
+#include "controller_mv_engine.h"
+
+/*
+ * Global brightness changes, lights switched, clouds, the IR cut filter.
+ * The mean and a few percentiles of a sparse luma histogram are tracked with a slow running average.
+ * A jump is flagged when the mean and every percentile moved off it the same way, a moving object shifts only some of them.
+ */
+
+typedef struct __mv_illumination_s *controller_mv_illumination_h;
+
+controller_mv_illumination_h controller_mv_illumination_create(void);
+void controller_mv_illumination_destroy(controller_mv_illumination_h illumination);
+
+/* Returns 1 when the brightness of the whole luma jumped, the tracked one is then set to it */
+int controller_mv_illumination_push(controller_mv_illumination_h illumination, const controller_mv_luma_s *luma);
+
+/* The view changed, tracking starts over from the next frame */
+void controller_mv_illumination_reset(controller_mv_illumination_h illumination);
+
+#endif /* __CONTROLLER_MV_ILLUMINATION_H__ */
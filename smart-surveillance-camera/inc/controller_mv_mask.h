@@ -0,0 +1,43 @@
+ /*
+ * Copyright (c) 2018 Samsung Electronics Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __CONTROLLER_MV_MASK_H__
+#define __CONTROLLER_MV_MASK_H__
+
+/*
+ * Areas of the frame movement detection looks at.
+ * Polygons are given in percent of the frame, "x,y x,y x,y ..." with at least 3 points,
+ * so a mask survives a resolution change. A pixel is analysed when it is inside any
+ * include polygon (or there is none) and outside every exclude polygon.
+ * The mask is compiled into runs of analysed pixels per row for one frame size.
+ */
+
+typedef struct __mv_mask_s *controller_mv_mask_h;
+
+/* include / exclude are NULL terminated lists, either may be NULL. Returns NULL if a polygon does not parse */
+controller_mv_mask_h controller_mv_mask_create(const char *const *include, const char *const *exclude);
+void controller_mv_mask_destroy(controller_mv_mask_h mask);
+
+/* Compiles the runs for width x height, nothing is done if they are already of that size */
+int controller_mv_mask_rasterize(controller_mv_mask_h mask, unsigned int width, unsigned int height);
+
+/* Runs of row as start, end pairs (end excluded), returns the number of runs */
+unsigned int controller_mv_mask_get_runs(controller_mv_mask_h mask, unsigned int row, const unsigned short **runs);
+
+/* Analysed pixels of the rectangle in percent of its area, in pixels of the rasterized size */
+unsigned int controller_mv_mask_get_coverage(controller_mv_mask_h mask, int x, int y, int width, int height);
+
+#endif /* __CONTROLLER_MV_MASK_H__ */
@@ -0,0 +1,41 @@
+ /*
+ * Copyright (c) 2018 Samsung Electronics Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef __CONTROLLER_MV_MERGE_H__
+#define __CONTROLLER_MV_MERGE_H__
+
+#include "controller_mv_engine.h"
+
+/*
+ * Clusters the regions of one event that overlap or lie close together into their bounding boxes,
+ * engines often report one moving object as a handful of small rectangles.
+ * Regions are swept in x order, so only the neighbours within reach along x are compared.
+ */
+
+typedef struct __mv_merge_s *controller_mv_merge_h;
+
+/* Room for MV_REGION_MAX regions, events never allocate */
+controller_mv_merge_h controller_mv_merge_create(void);
+void controller_mv_merge_destroy(controller_mv_merge_h merge);
+
+/*
+ * Two regions go together when they are at most gap pixels apart on both axes (a negative gap turns this off)
+ * or when their intersection over union is iou percent at least (0 turns this off), clusters chain.
+ * regions is rewritten with the bounding box of every cluster, returns the cluster count
+ */
+unsigned int controller_mv_merge_regions(controller_mv_merge_h merge, controller_mv_region_s *regions, unsigned int count,
+	int gap, unsigned int iou);
+
+#endif /* __CONTROLLER_MV_MERGE_H__ */
@@ -0,0 +1,43 @@
+ /*
+ * Copyright (c) 2018 Samsung Electronics Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __CONTROLLER_MV_NOISE_H__
+#define __CONTROLLER_MV_NOISE_H__
+
+#include "controller_mv_engine.h"
+
+/*
+ * Temporal noise floor of the analysed luma.
+ * A sparse grid of pixels is compared with the previous frame, the differences are kept per brightness band.
+ * The median difference of the noisiest band gives the sensor noise, moving objects barely shift a median.
+ * The first estimate comes after a short calibration, the next ones after every longer window.
+ */
+
+typedef struct __mv_noise_s *controller_mv_noise_h;
+
+controller_mv_noise_h controller_mv_noise_create(void);
+void controller_mv_noise_destroy(controller_mv_noise_h noise);
+
+/* Returns 1 when the frame closed a window and a new threshold is ready */
+int controller_mv_noise_push(controller_mv_noise_h noise, const controller_mv_luma_s *luma, long long int time_us);
+
+/* Detection threshold for the last estimate, 0 before the calibration is over */
+unsigned int controller_mv_noise_get_threshold(controller_mv_noise_h noise);
+
+/* The view changed, the current window and the previous frame are dropped */
+void controller_mv_noise_reset(controller_mv_noise_h noise);
+
+#endif /* __CONTROLLER_MV_NOISE_H__ */
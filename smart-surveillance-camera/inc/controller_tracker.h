@@ -0,0 +1,66 @@
+ /*
+ * Copyright (c) 2018 Samsung Electronics Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __CONTROLLER_TRACKER_H__
+#define __CONTROLLER_TRACKER_H__
+
+/*
+ * Follows the moving regions of one camera across events.
+ * Regions are matched to the position every track predicts with its velocity,
+ * nearest first, unmatched regions start new tracks and tracks unseen for a while are dropped.
+ * Everything is in percent of the frame, as the result[] of movement_detected_cb.
+ * With a classifier, tracks keep the last verdict of their regions and a person is the preferred primary track.
+ */
+
+typedef struct controller_tracker_track_s {
+	unsigned int id; // 1 ~ 99, reused after a wrap, never shared by two live tracks
+	float x; // centre
+	float y;
+	float width;
+	float height;
+	float velocity_x; // percent per second
+	float velocity_y;
+	unsigned int age; // events the track was matched in
+	long long int last_seen_ms;
+	int verdict; // controller_classifier_verdict_e of the last classified region
+	long long int classified_ms;
+} controller_tracker_track_s;
+
+typedef struct __tracker_data *controller_tracker_h;
+
+controller_tracker_h controller_tracker_create(void);
+void controller_tracker_destroy(controller_tracker_h tracker);
+
+/* result holds result_count x, y, width, height quadruples, verdicts one controller_classifier_verdict_e each or is NULL */
+void controller_tracker_update(controller_tracker_h tracker, const int result[], const int verdicts[], int result_count,
+	long long int now_ms);
+
+/* The camera turned, every track moves by dx, dy */
+void controller_tracker_shift(controller_tracker_h tracker, float dx, float dy);
+
+/* Drops every track */
+void controller_tracker_reset(controller_tracker_h tracker);
+
+/* Returns the number of tracks, valid until the next update */
+int controller_tracker_get_tracks(controller_tracker_h tracker, const controller_tracker_track_s **tracks);
+
+/* The track the camera follows, NULL when no track is confirmed yet */
+const controller_tracker_track_s *controller_tracker_get_primary(controller_tracker_h tracker);
+
+/* Where track is expected at at_ms */
+void controller_tracker_predict(const controller_tracker_track_s *track, long long int at_ms, float *x, float *y);
+
+#endif /* __CONTROLLER_TRACKER_H__ */
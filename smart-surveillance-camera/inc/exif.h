@@ -20,10 +20,14 @@
 /* CAUTION
  * This function is only for adding exif with user comment
  * to JPEG which has No existing exif data !!!
+ *
+ * capture_time_ms (ms since the epoch) goes to DateTimeOriginal in UTC
+ * and SubSecTimeOriginal, 0 leaves both out.
  */
 int exif_write_jpg_file_with_comment(const char *output_file,
 		const unsigned char *jpg_data, unsigned int jpg_size,
 		unsigned int jpg_width, unsigned int jpg_height,
-		const char *comment, unsigned int comment_len);
+		const char *comment, unsigned int comment_len,
+		long long int capture_time_ms);
 
 #endif /* __APP_EXIF_H__ */
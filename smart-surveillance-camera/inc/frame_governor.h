@@ -0,0 +1,46 @@
+ /*
+ * Copyright (c) 2018 Samsung Electronics Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __FRAME_GOVERNOR_H__
+#define __FRAME_GOVERNOR_H__
+
+#include <stdbool.h>
+
+typedef enum {
+	FRAME_GOVERNOR_STAGE_ANALYSIS,
+	FRAME_GOVERNOR_STAGE_ENCODE,
+	FRAME_GOVERNOR_STAGE_MAX,
+} frame_governor_stage_e;
+
+typedef struct __frame_governor_s *frame_governor_h;
+
+/*
+ * Decides which preview frames enter the pipeline.
+ * Runs at max_fps while the scene is active, falls back to idle_fps
+ * once nothing moved for idle_timeout_ms, and never asks for more frames
+ * than the measured pipeline cost allows.
+ */
+frame_governor_h frame_governor_create(unsigned int max_fps, unsigned int idle_fps, unsigned int idle_timeout_ms);
+void frame_governor_destroy(frame_governor_h governor);
+
+/* Called from the camera thread for every preview frame */
+bool frame_governor_accept_frame(frame_governor_h governor);
+
+void frame_governor_report_cost(frame_governor_h governor, frame_governor_stage_e stage, unsigned int cost_ms);
+void frame_governor_report_activity(frame_governor_h governor);
+void frame_governor_get_fps(frame_governor_h governor, unsigned int *current_fps, unsigned int *target_fps);
+
+#endif /* __FRAME_GOVERNOR_H__ */
@@ -0,0 +1,46 @@
+ /*
+ * Copyright (c) 2018 Samsung Electronics Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __FRAME_POOL_H__
+#define __FRAME_POOL_H__
+
+#include <camera.h>
+#include "resource_camera.h"
+
+typedef struct __frame_pool_s *frame_pool_h;
+
+typedef struct __frame_pool_stats_s {
+	unsigned int capacity;
+	unsigned int frame_size;
+	unsigned int in_use;
+	unsigned int high_water;
+	unsigned int exhausted;
+} frame_pool_stats_s;
+
+unsigned int frame_pool_get_frame_size(camera_pixel_format_e format, unsigned int width, unsigned int height);
+
+frame_pool_h frame_pool_create(unsigned int frame_count, unsigned int frame_size);
+/* Frames still referenced by consumers stay valid, the pool is released with the last one */
+void frame_pool_destroy(frame_pool_h pool);
+
+/* Returns a frame with one reference, or NULL if every frame is in use */
+image_buffer_data_s *frame_pool_acquire(frame_pool_h pool);
+void frame_pool_get_stats(frame_pool_h pool, frame_pool_stats_s *stats);
+
+image_buffer_data_s *image_buffer_ref(image_buffer_data_s *image_buffer);
+void image_buffer_unref(image_buffer_data_s *image_buffer);
+
+#endif /* __FRAME_POOL_H__ */
@@ -0,0 +1,45 @@
+ /*
+ * Copyright (c) 2018 Samsung Electronics Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef __FRAME_PYRAMID_H__
+#define __FRAME_PYRAMID_H__
+
+#include <camera.h>
+#include "resource_camera.h"
+
+#define FRAME_PYRAMID_LEVEL_MAX 3 // 1/8 of the frame
+
+/*
+ * Y plane of a frame at 1, 1/2, 1/4 and 1/8 of its size, for every analysis stage to share.
+ * Levels are 2x2 box filtered from the one above on the first request and kept until the frame goes back to its pool.
+ * Every frame of a pool owns one, the memory stays with the pool slot and is reused by the next frames of the same size.
+ */
+
+typedef struct __frame_pyramid_s *frame_pyramid_h;
+
+/* Luma at 1 / (1 << level), rows are not padded. From any thread holding a reference of the frame.
+ * NULL for formats without a Y plane */
+const unsigned char *frame_pyramid_get_level(const image_buffer_data_s *image_buffer, unsigned int level,
+	unsigned int *width, unsigned int *height);
+
+/* For frame_pool */
+frame_pyramid_h frame_pyramid_create(void);
+void frame_pyramid_destroy(frame_pyramid_h pyramid);
+/* The frame went back to the pool, its levels are stale */
+void frame_pyramid_release(frame_pyramid_h pyramid);
+
+#endif /* __FRAME_PYRAMID_H__ */
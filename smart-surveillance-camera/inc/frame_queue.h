@@ -0,0 +1,54 @@
+ /*
+ * Copyright (c) 2018 Samsung Electronics Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __FRAME_QUEUE_H__
+#define __FRAME_QUEUE_H__
+
+#include <camera.h>
+#include "resource_camera.h"
+
+typedef enum {
+	FRAME_QUEUE_DROP_NEWEST,
+	FRAME_QUEUE_DROP_OLDEST,
+} frame_queue_overflow_policy_e;
+
+typedef struct __frame_queue_s *frame_queue_h;
+
+typedef void (*frame_queue_consume_cb)(image_buffer_data_s *image_buffer, void *user_data);
+
+typedef struct __frame_queue_stats_s {
+	unsigned int capacity;
+	unsigned int depth;
+	unsigned int max_depth;
+	unsigned int enqueued;
+	unsigned int dropped;
+} frame_queue_stats_s;
+
+/*
+ * Single producer (camera thread), single consumer (main loop) ring of frames.
+ * The consumer is woken up only when the ring goes from empty to non-empty,
+ * and drains at most batch_size frames per main loop iteration.
+ */
+frame_queue_h frame_queue_create(unsigned int capacity, frame_queue_overflow_policy_e policy,
+	unsigned int batch_size, frame_queue_consume_cb consume_cb, void *user_data);
+/* Must be called on the main loop after the producer has stopped */
+void frame_queue_destroy(frame_queue_h queue);
+
+/* Takes over the reference of image_buffer, even when the frame is dropped */
+int frame_queue_push(frame_queue_h queue, image_buffer_data_s *image_buffer);
+void frame_queue_get_stats(frame_queue_h queue, frame_queue_stats_s *stats);
+
+#endif /* __FRAME_QUEUE_H__ */
@@ -0,0 +1,55 @@
+ /*
+ * Copyright (c) 2018 Samsung Electronics Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __FRAME_TRACE_H__
+#define __FRAME_TRACE_H__
+
+typedef enum {
+	FRAME_TRACE_STAGE_CAPTURE, // camera callback until the frame is queued
+	FRAME_TRACE_STAGE_QUEUE, // queued until the main loop picks it up
+	FRAME_TRACE_STAGE_ANALYSIS, // controller_mv_push_source(), on the analysis worker
+	FRAME_TRACE_STAGE_EVENT, // detection handling on the main loop
+	FRAME_TRACE_STAGE_ENCODE, // JPEG encode and exif
+	FRAME_TRACE_STAGE_RENAME, // rename() to the latest image file
+	FRAME_TRACE_STAGE_TOTAL, // camera callback until the latest image file is in place
+	FRAME_TRACE_STAGE_SNAPSHOT, // still capture started until its evidence file is written
+	FRAME_TRACE_STAGE_PREVIEW_GAP, // still capture started until the preview runs again
+	FRAME_TRACE_STAGE_HANDOFF, // handed to the analysis worker until it picks the frame up
+	FRAME_TRACE_STAGE_RESULT, // analysis result posted until the main loop handles it
+	FRAME_TRACE_STAGE_MAIN_LOOP_LAG, // how late a periodic main loop timer fires, under camera 0
+	FRAME_TRACE_STAGE_CLASSIFY, // controller_classifier_classify() of the moving regions, on the analysis worker
+	FRAME_TRACE_STAGE_MAX,
+} frame_trace_stage_e;
+
+/*
+ * Every thread records into its own ring, without locks.
+ * The main loop drains the rings every second into per camera, per stage histograms.
+ */
+int frame_trace_init(void);
+/* After every thread that records has stopped */
+void frame_trace_fini(void);
+
+long long int frame_trace_get_time_us(void);
+/* Wall clock in ms since the epoch for a frame_trace_get_time_us() value */
+long long int frame_trace_get_wall_clock_ms(long long int time_us);
+
+void frame_trace_record(frame_trace_stage_e stage, int camera_index, unsigned int sequence,
+	long long int enter_us, long long int exit_us);
+
+/* Logs the percentiles since the last report, writes them as JSON to path unless it is NULL, and starts over */
+void frame_trace_report(const char *path);
+
+#endif /* __FRAME_TRACE_H__ */
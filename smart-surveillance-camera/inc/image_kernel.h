@@ -0,0 +1,81 @@
+ /*
+ * Copyright (c) 2018 Samsung Electronics Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __IMAGE_KERNEL_H__
+#define __IMAGE_KERNEL_H__
+
+#include <camera.h>
+
+/*
+ * Plane copy and pixel format conversion kernels.
+ * NEON or SSE2 versions are built when the target has them, scalar ones otherwise.
+ * Strides are in bytes, width and height in pixels and even for the chroma subsampled formats.
+ */
+
+/* "neon", "sse2" or "scalar" */
+const char *image_kernel_get_backend(void);
+
+/* Bytes per row and number of rows of a plane in a tightly packed frame, -1 for unknown formats */
+int image_kernel_get_plane_geometry(camera_pixel_format_e format, int plane,
+	unsigned int width, unsigned int height, unsigned int *row_size, unsigned int *rows);
+
+void image_kernel_copy_plane(unsigned char *dst, unsigned int dst_stride,
+	const unsigned char *src, unsigned int src_stride, unsigned int row_size, unsigned int rows);
+
+/* dst_u / dst_v are swapped by the caller for NV21 */
+void image_kernel_nv12_to_i420(const unsigned char *src_y, unsigned int src_y_stride,
+	const unsigned char *src_uv, unsigned int src_uv_stride,
+	unsigned char *dst_y, unsigned char *dst_u, unsigned char *dst_v,
+	unsigned int width, unsigned int height);
+void image_kernel_i420_to_nv12(const unsigned char *src_y, const unsigned char *src_u, const unsigned char *src_v,
+	unsigned char *dst_y, unsigned char *dst_uv, unsigned int width, unsigned int height);
+
+/* 4:2:2 to 4:2:0, chroma of two rows is averaged. format is YUYV or UYVY */
+void image_kernel_yuv422_to_i420(camera_pixel_format_e format, const unsigned char *src, unsigned int src_stride,
+	unsigned char *dst_y, unsigned char *dst_u, unsigned char *dst_v,
+	unsigned int width, unsigned int height);
+
+/* 2x2 box filter, dst is (width / 2) x (height / 2) */
+void image_kernel_downscale_luma_2x(const unsigned char *src, unsigned int src_stride,
+	unsigned char *dst, unsigned int dst_stride, unsigned int width, unsigned int height);
+
+/* Luma of a YUYV or UYVY frame, dst is width x height */
+void image_kernel_yuv422_to_luma(camera_pixel_format_e format, const unsigned char *src, unsigned int src_stride,
+	unsigned char *dst, unsigned int width, unsigned int height);
+
+/* Motion masks, 255 where a pixel is set and 0 elsewhere */
+
+/*
+ * Background in 8.8 fixed point, level = (background + 128) >> 8.
+ * diff : mask = |src - level| > threshold.
+ * update : background moves 1 / 2^shift of the way to src, foreground_shift where mask is set.
+ * Shifts are 1 ~ 8.
+ */
+void image_kernel_background_diff(const unsigned char *src, const unsigned short *background,
+	unsigned char *mask, unsigned int count, unsigned char threshold);
+void image_kernel_background_update(unsigned short *background, const unsigned char *src, const unsigned char *mask,
+	unsigned int count, unsigned int background_shift, unsigned int foreground_shift);
+/* 3 x 3 min (erode) or max (dilate) of a width x height mask, tmp holds width x height */
+void image_kernel_erode_3x3(const unsigned char *src, unsigned char *dst, unsigned char *tmp,
+	unsigned int width, unsigned int height);
+void image_kernel_dilate_3x3(const unsigned char *src, unsigned char *dst, unsigned char *tmp,
+	unsigned int width, unsigned int height);
+
+/* Converts a tightly packed frame to tightly packed I420, returns -1 if there is no kernel for format */
+int image_kernel_convert_to_i420(camera_pixel_format_e format, const unsigned char *src,
+	unsigned int width, unsigned int height, unsigned char *dst);
+
+#endif /* __IMAGE_KERNEL_H__ */
@@ -17,6 +17,12 @@
 #ifndef __RESOURCE_CAMERA_H__
 #define __RESOURCE_CAMERA_H__
 
+struct __frame_pool_s;
+struct __frame_pool_stats_s;
+struct __frame_queue_stats_s;
+struct __frame_governor_s;
+struct __frame_pyramid_s;
+
 typedef struct __image_buffer_data_s {
     unsigned char *buffer;
 	unsigned int buffer_size;
@@ -24,14 +30,40 @@ typedef struct __image_buffer_data_s {
 	unsigned int image_height;
 	camera_pixel_format_e format;
 	void *user_data;
+	long long int timestamp_us; // frame_trace_get_time_us() when the camera handed the frame over
+	long long int trace_time_us; // when the last traced stage of the frame ended
+	unsigned int sequence; // per camera, gaps are frames dropped after the pool
+
+	/* camera packet wrapped without copy, buffer points into it when it is set */
+	media_packet_h packet;
+
+	/* owned by frame_pool, use image_buffer_ref() / image_buffer_unref() */
+	int ref_count;
+	struct __frame_pool_s *pool;
+	struct __frame_pyramid_s *pyramid; // luma levels of the frame, frame_pyramid_get_level()
 } image_buffer_data_s;
 
 typedef void (*preview_image_buffer_created_cb)(void *buffedata);
-typedef void (*capture_completed_cb)(const void *image, unsigned int size, void *user_data);
+/* Called on the camera thread, takes over the reference of image_buffer, a CAMERA_PIXEL_FORMAT_JPEG still of buffer_size bytes */
+typedef void (*capture_completed_cb)(image_buffer_data_s *image_buffer, void *user_data);
 
-int resource_camera_init(preview_image_buffer_created_cb preview_image_buffer_created_cb, void *user_data);
-int resource_camera_start_preview(void);
-int resource_camera_capture(capture_completed_cb capture_completed_cb, void *data);
-void resource_camera_close(void);
+typedef struct __camera_data *resource_camera_h;
+
+/*
+ * camera_index selects the device, CAMERA_DEVICE_CAMERA0 + camera_index.
+ * width x height is the wanted preview resolution, the closest one the camera supports is used.
+ */
+int resource_camera_init(int camera_index, unsigned int width, unsigned int height,
+	preview_image_buffer_created_cb preview_image_buffer_created_cb, void *user_data, resource_camera_h *camera);
+int resource_camera_start_preview(resource_camera_h camera);
+/* Still at the largest capture resolution, the preview pauses until capture_completed_cb */
+int resource_camera_capture(resource_camera_h camera, capture_completed_cb capture_completed_cb, void *data);
+int resource_camera_get_preview_resolution(resource_camera_h camera, unsigned int *width, unsigned int *height);
+int resource_camera_get_frame_pool_stats(resource_camera_h camera, struct __frame_pool_stats_s *stats);
+int resource_camera_get_frame_queue_stats(resource_camera_h camera, struct __frame_queue_stats_s *stats);
+struct __frame_governor_s *resource_camera_get_frame_governor(resource_camera_h camera);
+/* No preview frame or still is delivered once it returns, a still in flight is waited for and dropped. resource_camera_close() stops too */
+void resource_camera_stop(resource_camera_h camera);
+void resource_camera_close(resource_camera_h camera);
 
 #endif
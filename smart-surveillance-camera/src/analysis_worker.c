@@ -0,0 +1,227 @@
+ /*
+ * Copyright (c) 2018 Samsung Electronics Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <glib.h>
+#include <Ecore.h>
+#include "log.h"
+#include "controller.h"
+#include "frame_pool.h"
+#include "analysis_worker.h"
+
+struct __analysis_worker_s {
+	pthread_t thread;
+	bool thread_started;
+
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+	image_buffer_data_s *pending; // to mutex
+	bool stopping; // to mutex
+	unsigned int dropped; // to mutex
+
+	/* Messages from the worker, drained on the main loop like frame_queue */
+	GAsyncQueue *results;
+	volatile gint wakeup_pending;
+	bool closed;
+
+	analysis_worker_analyse_cb analyse_cb;
+	analysis_worker_result_cb result_cb;
+	void *user_data;
+};
+
+static void __free_worker(struct __analysis_worker_s *worker)
+{
+	void *message = NULL;
+
+	while ((message = g_async_queue_try_pop(worker->results)))
+		free(message);
+
+	g_async_queue_unref(worker->results);
+	pthread_cond_destroy(&worker->cond);
+	pthread_mutex_destroy(&worker->mutex);
+	free(worker);
+}
+
+static void __handle_results(struct __analysis_worker_s *worker)
+{
+	void *message = NULL;
+
+	while ((message = g_async_queue_try_pop(worker->results))) {
+		worker->result_cb(message, worker->user_data);
+		free(message);
+	}
+}
+
+#ifndef ANALYSIS_ON_MAIN_LOOP
+static void __drain_results_cb(void *data)
+{
+	struct __analysis_worker_s *worker = data;
+
+	if (worker->closed) {
+		__free_worker(worker);
+		return;
+	}
+
+	/* Cleared before draining, a message posted from now on schedules another pass */
+	g_atomic_int_set(&worker->wakeup_pending, 0);
+
+	__handle_results(worker);
+}
+
+static void *__worker_thread(void *data)
+{
+	struct __analysis_worker_s *worker = data;
+	image_buffer_data_s *image_buffer = NULL;
+
+	while (1) {
+		pthread_mutex_lock(&worker->mutex);
+		while (!worker->pending && !worker->stopping)
+			pthread_cond_wait(&worker->cond, &worker->mutex);
+
+		if (worker->stopping) {
+			pthread_mutex_unlock(&worker->mutex);
+			break;
+		}
+
+		image_buffer = worker->pending;
+		worker->pending = NULL;
+		pthread_mutex_unlock(&worker->mutex);
+
+		worker->analyse_cb(image_buffer, worker->user_data);
+		image_buffer_unref(image_buffer);
+	}
+
+	return NULL;
+}
+#endif
+
+analysis_worker_h analysis_worker_create(analysis_worker_analyse_cb analyse_cb,
+	analysis_worker_result_cb result_cb, void *user_data)
+{
+	struct __analysis_worker_s *worker = NULL;
+
+	retv_if(!analyse_cb, NULL);
+	retv_if(!result_cb, NULL);
+
+	worker = calloc(1, sizeof(struct __analysis_worker_s));
+	retvm_if(!worker, NULL, "failed to allocate analysis worker");
+
+	pthread_mutex_init(&worker->mutex, NULL);
+	pthread_cond_init(&worker->cond, NULL);
+	worker->results = g_async_queue_new();
+	worker->analyse_cb = analyse_cb;
+	worker->result_cb = result_cb;
+	worker->user_data = user_data;
+
+#ifndef ANALYSIS_ON_MAIN_LOOP
+	if (pthread_create(&worker->thread, NULL, __worker_thread, worker)) {
+		_E("failed to start analysis worker");
+		__free_worker(worker);
+		return NULL;
+	}
+	worker->thread_started = true;
+#endif
+
+	return worker;
+}
+
+void analysis_worker_destroy(analysis_worker_h worker)
+{
+	image_buffer_data_s *image_buffer = NULL;
+
+	ret_if(!worker);
+
+	pthread_mutex_lock(&worker->mutex);
+	worker->stopping = true;
+	image_buffer = worker->pending;
+	worker->pending = NULL;
+	pthread_cond_signal(&worker->cond);
+	pthread_mutex_unlock(&worker->mutex);
+
+	if (image_buffer)
+		image_buffer_unref(image_buffer);
+
+	if (worker->thread_started)
+		pthread_join(worker->thread, NULL);
+
+	_I("analysis worker - dropped[%u]", worker->dropped);
+
+	worker->closed = true;
+
+	/* A scheduled drain owns the release, otherwise nothing can wake up any more */
+	if (g_atomic_int_compare_and_exchange(&worker->wakeup_pending, 0, 1))
+		__free_worker(worker);
+}
+
+int analysis_worker_push(analysis_worker_h worker, image_buffer_data_s *image_buffer)
+{
+#ifndef ANALYSIS_ON_MAIN_LOOP
+	image_buffer_data_s *superseded = NULL;
+#endif
+
+	retv_if(!image_buffer, -1);
+	if (!worker) {
+		image_buffer_unref(image_buffer);
+		return -1;
+	}
+
+#ifdef ANALYSIS_ON_MAIN_LOOP
+	worker->analyse_cb(image_buffer, worker->user_data);
+	image_buffer_unref(image_buffer);
+	__handle_results(worker);
+#else
+	pthread_mutex_lock(&worker->mutex);
+	superseded = worker->pending;
+	worker->pending = image_buffer;
+	if (superseded)
+		worker->dropped++;
+	pthread_cond_signal(&worker->cond);
+	pthread_mutex_unlock(&worker->mutex);
+
+	if (superseded)
+		image_buffer_unref(superseded);
+#endif
+
+	return 0;
+}
+
+void analysis_worker_post(analysis_worker_h worker, void *message)
+{
+	ret_if(!worker);
+	ret_if(!message);
+
+	g_async_queue_push(worker->results, message);
+
+#ifndef ANALYSIS_ON_MAIN_LOOP
+	if (g_atomic_int_compare_and_exchange(&worker->wakeup_pending, 0, 1))
+		ecore_main_loop_thread_safe_call_async(__drain_results_cb, worker);
+#endif
+}
+
+unsigned int analysis_worker_get_dropped(analysis_worker_h worker)
+{
+	unsigned int dropped = 0;
+
+	retv_if(!worker, 0);
+
+	pthread_mutex_lock(&worker->mutex);
+	dropped = worker->dropped;
+	pthread_mutex_unlock(&worker->mutex);
+
+	return dropped;
+}
@@ -19,13 +19,21 @@
 #include <tizen.h>
 #include <service_app.h>
 #include <camera.h>
-#include <mv_common.h>
 #include <pthread.h>
+#include <time.h>
+#include <sys/stat.h>
 #include "controller.h"
 #include "controller_mv.h"
+#include "controller_tracker.h"
+#include "controller_classifier.h"
+#include "analysis_worker.h"
 #include "controller_image.h"
 #include "log.h"
 #include "resource_camera.h"
+#include "frame_pool.h"
+#include "frame_queue.h"
+#include "frame_governor.h"
+#include "frame_trace.h"
 #include "switch.h"
 #include "servo-h.h"
 #include "servo-v.h"
@@ -34,12 +42,45 @@
 #include "st_thing_master.h"
 #include "st_thing_resource.h"
 
+#define SERVO_CAMERA_INDEX 0 // camera on the servo mount, the other cameras are fixed
 #define CAMERA_MOVE_INTERVAL_MS 450
 #define THRESHOLD_VALID_EVENT_COUNT 2
 #define VALID_EVENT_INTERVAL_MS 200
+#define TRACK_PREDICTION_LEAD_MS 200 // the servo aims where the primary track will be once the move settles
+#define VIEW_PERCENT_PER_SERVO_STEP 5.0f // a step of __move_camera() turns the view by about this much
+
+#define PIPELINE_STATS_INTERVAL_SEC 10.0
+#define FRAME_TRACE_REPORT_FILENAME "frame_trace.json" // in the app data directory, rewritten with every stats report
+#define HEATMAP_SNAPSHOT_INTERVAL_SEC 60.0 // heatmap.json (camera 0) or heatmap_<camera>.json in the shared data directory, for the dashboard
+
+/*
+ * Optional, in the app data directory. [camera] applies to every camera, [cameraN] to camera N only.
+ * [camera]
+ * width=640
+ * height=480
+ * engine=motion
+ * decimation=4
+ * threshold=auto
+ * merge_gap=2
+ * merge_iou=0
+ * activity_floor=2
+ * classifier=shape
+ * exclude=0,0 30,0 30,20 0,20;70,60 100,60 100,100 70,100
+ * Masks (include / exclude polygons in percent) are reloaded when the file changes.
+ */
+#define CAMERA_PROFILE_FILENAME "camera_profile.ini"
+#define PROFILE_RELOAD_INTERVAL_SEC 2.0
+
+#ifndef CONTROLLER_MV_NO_MEDIA_VISION
+#define CAMERA_DEFAULT_ENGINE CONTROLLER_MV_ENGINE_MEDIA_VISION
+#else
+#define CAMERA_DEFAULT_ENGINE CONTROLLER_MV_ENGINE_MOTION
+#endif
 
 #define IMAGE_FILE_PREFIX "CAM_"
 #define EVENT_INTERVAL_SECOND 0.5f
+#define EVIDENCE_CAPTURE_INTERVAL_MS 3000 // the preview pauses for every still, keep them apart
+#define EVIDENCE_IMAGE_COUNT 20 // CAM_<camera>_<slot>.jpg in the shared data directory, the oldest is overwritten
 
 //#define TEMP_IMAGE_FILENAME "/opt/usr/home/owner/apps_rw/org.tizen.smart-surveillance-camera/shared/data/tmp.jpg"
 //#define LATEST_IMAGE_FILENAME "/opt/usr/home/owner/apps_rw/org.tizen.smart-surveillance-camera/shared/data/latest.jpg"
@@ -47,221 +88,587 @@
 // #define ENABLE_SMARTTHINGS
 #define APP_CALLBACK_KEY "controller"
 
-typedef struct app_data_s {
-	double current_servo_x;
-	double current_servo_y;
-	int motion_state;
-
-	long long int last_moved_time;
+/* Stills arrive on the camera thread, a wakeup queued on the main loop may outlive its pipeline */
+typedef struct evidence_wakeup_s {
+	struct camera_pipeline_s *pipeline;
+	volatile gint pending;
+	bool closed;
+} evidence_wakeup_s;
+
+typedef struct camera_pipeline_s {
+	int index;
+	struct app_data_s *ad;
+	resource_camera_h camera;
+	controller_mv_h mv; // analysis worker only, but for the requests controller_mv takes from any thread
+	analysis_worker_h worker;
+	struct analysis_result_s *analysis_result; // filled by the analysis worker while it pushes
+	controller_tracker_h tracker; // main loop only
+	controller_classifier_h classifier; // NULL when every movement counts
+	unsigned int image_width;
+	unsigned int image_height;
+	int motion_state; // motion in the latest analysed frame
+
+	long long int last_moved_time; // the view was lost while turning, events are of the move for a while
+	float turn_pending_x; // percent the tracks still have to follow the view for the last servo move
+	float turn_pending_y;
 	long long int last_valid_event_time;
-	int valid_vision_result_x_sum;
-	int valid_vision_result_y_sum;
 	int valid_event_count;
 
-	unsigned int latest_image_width;
-	unsigned int latest_image_height;
 	char *latest_image_info;
 	int latest_image_type; // 0: image during camera repositioning, 1: single valid image but not completed, 2: fully validated image
-	unsigned char *latest_image_buffer;
+	image_buffer_data_s *latest_image;
 
 	Ecore_Thread *image_writter_thread;
 	pthread_mutex_t mutex;
 
+	/* Full resolution stills of fully validated detections */
+	long long int last_evidence_time;
+	image_buffer_data_s *evidence_image; // to mutex
+	Ecore_Thread *evidence_writer_thread; // to mutex
+	evidence_wakeup_s *evidence_wakeup;
+	unsigned int evidence_count; // evidence writer only
+	char *evidence_filename_prefix;
+
+	/* Since the last stats report, analysed_frames belongs to the main loop, written_images to mutex */
+	unsigned int analysed_frames;
+	unsigned int written_images;
+	unsigned int last_dropped_frames;
+
 	char* temp_image_filename;
 	char* latest_image_filename;
-} app_data;
-
-static long long int __get_monotonic_ms(void)
-{
-	long long int ret_time = 0;
-	struct timespec time_s;
+	char *heatmap_filename;
+} camera_pipeline_s;
+
+/* Posted by the analysis worker for every frame it analysed */
+typedef struct analysis_result_s {
+	unsigned int sequence;
+	long long int posted_us;
+	long long int detected_ms; // when movement was found, 0 for none
+	int result[MV_RESULT_LENGTH_MAX];
+	int result_count;
+	int verdicts[MV_RESULT_COUNT_MAX]; // controller_classifier_verdict_e of every region
+	float view_shift_x; // percent the view of a turning camera moved since the previous frame
+	float view_shift_y;
+	int view_lost; // the turn could not be followed, the scene is relearnt
+} analysis_result_s;
+
+typedef struct camera_profile_s {
+	unsigned int width;
+	unsigned int height;
+	controller_mv_engine_e engine;
+	unsigned int decimation;
+	unsigned int threshold; // 0 measures it from the noise
+	int merge_gap; // percent of the frame width, -1 keeps the regions apart
+	unsigned int merge_iou; // percent, 0 for none
+	unsigned int activity_floor; // 0 sends every frame to the engine
+	controller_classifier_engine_e classifier;
+} camera_profile_s;
 
-	if (0 == clock_gettime(CLOCK_MONOTONIC, &time_s))
-		ret_time = time_s.tv_sec* 1000 + time_s.tv_nsec / 1000000;
-	else
-		_E("Failed to get time");
+typedef struct app_data_s {
+	double current_servo_x;
+	double current_servo_y;
 
-	return ret_time;
-}
+	camera_pipeline_s pipelines[CAMERA_COUNT];
+	int pipeline_count;
 
-static mv_colorspace_e __convert_colorspace_from_cam_to_mv(camera_pixel_format_e format)
-{
-	mv_colorspace_e colorspace = MEDIA_VISION_COLORSPACE_INVALID;
-	switch (format) {
-	case CAMERA_PIXEL_FORMAT_NV12:
-		colorspace = MEDIA_VISION_COLORSPACE_NV12;
-		break;
-	case CAMERA_PIXEL_FORMAT_NV21:
-		colorspace = MEDIA_VISION_COLORSPACE_NV21;
-		break;
-	case CAMERA_PIXEL_FORMAT_YUYV:
-		colorspace = MEDIA_VISION_COLORSPACE_YUYV;
-		break;
-	case CAMERA_PIXEL_FORMAT_UYVY:
-		colorspace = MEDIA_VISION_COLORSPACE_UYVY;
-		break;
-	case CAMERA_PIXEL_FORMAT_422P:
-		colorspace = MEDIA_VISION_COLORSPACE_422P;
-		break;
-	case CAMERA_PIXEL_FORMAT_I420:
-		colorspace = MEDIA_VISION_COLORSPACE_I420;
-		break;
-	case CAMERA_PIXEL_FORMAT_YV12:
-		colorspace = MEDIA_VISION_COLORSPACE_YV12;
-		break;
-	case CAMERA_PIXEL_FORMAT_RGB565:
-		colorspace = MEDIA_VISION_COLORSPACE_RGB565;
-		break;
-	case CAMERA_PIXEL_FORMAT_RGB888:
-		colorspace = MEDIA_VISION_COLORSPACE_RGB888;
-		break;
-	case CAMERA_PIXEL_FORMAT_RGBA:
-		colorspace = MEDIA_VISION_COLORSPACE_RGBA;
-		break;
-	case CAMERA_PIXEL_FORMAT_NV12T:
-	case CAMERA_PIXEL_FORMAT_NV16:
-	case CAMERA_PIXEL_FORMAT_ARGB:
-	case CAMERA_PIXEL_FORMAT_JPEG:
-	case CAMERA_PIXEL_FORMAT_H264:
-	case CAMERA_PIXEL_FORMAT_INVALID:
-	default :
-		colorspace = MEDIA_VISION_COLORSPACE_INVALID;
-		_E("unsupported format : %d", format);
-		break;
-	}
-
-	return colorspace;
-}
+	Ecore_Timer *stats_timer;
+	Ecore_Timer *profile_reload_timer;
+	Ecore_Timer *heatmap_timer;
+	time_t profile_modified_time;
+	char *frame_trace_report_path;
+} app_data;
 
 static void __thread_write_image_file(void *data, Ecore_Thread *th)
 {
-	app_data *ad = (app_data *)data;
-	unsigned int width = 0;
-	unsigned int height = 0;
-	unsigned char *buffer = 0;
+	camera_pipeline_s *pipeline = (camera_pipeline_s *)data;
+	image_buffer_data_s *image_buffer = NULL;
 	char *image_info = NULL;
+	long long int started = 0;
+	long long int encoded = 0;
+	long long int renamed = 0;
 	int ret = 0;
 
-	pthread_mutex_lock(&ad->mutex);
-	width = ad->latest_image_width;
-	height = ad->latest_image_height;
-	buffer = ad->latest_image_buffer;
-	ad->latest_image_buffer = NULL;
-	if (ad->latest_image_info) {
-		image_info = ad->latest_image_info;
-		ad->latest_image_info = NULL;
+	pthread_mutex_lock(&pipeline->mutex);
+	image_buffer = pipeline->latest_image;
+	pipeline->latest_image = NULL;
+	if (pipeline->latest_image_info) {
+		image_info = pipeline->latest_image_info;
+		pipeline->latest_image_info = NULL;
 	} else {
 		image_info = strdup("00");
 	}
-	pthread_mutex_unlock(&ad->mutex);
+	pthread_mutex_unlock(&pipeline->mutex);
+
+	if (!image_buffer) {
+		free(image_info);
+		return;
+	}
+
+	started = frame_trace_get_time_us();
+	ret = controller_image_save_image_file(pipeline->temp_image_filename,
+			image_buffer->image_width, image_buffer->image_height, image_buffer->format,
+			image_buffer->buffer, image_info, strlen(image_info),
+			frame_trace_get_wall_clock_ms(image_buffer->timestamp_us));
+	encoded = frame_trace_get_time_us();
+	frame_trace_record(FRAME_TRACE_STAGE_ENCODE, pipeline->index, image_buffer->sequence, started, encoded);
+	renamed = encoded;
 
-	ret = controller_image_save_image_file(ad->temp_image_filename, width, height, buffer, image_info, strlen(image_info));
 	if (ret) {
 		_E("failed to save image file");
 	} else {
-		ret = rename(ad->temp_image_filename, ad->latest_image_filename);
+		ret = rename(pipeline->temp_image_filename, pipeline->latest_image_filename);
 		if (ret != 0 )
 			_E("Rename fail");
+
+		renamed = frame_trace_get_time_us();
+		frame_trace_record(FRAME_TRACE_STAGE_RENAME, pipeline->index, image_buffer->sequence, encoded, renamed);
+	}
+	frame_governor_report_cost(resource_camera_get_frame_governor(pipeline->camera),
+		FRAME_GOVERNOR_STAGE_ENCODE, (renamed - started) / 1000);
+
+	if (ret == 0) {
+		frame_trace_record(FRAME_TRACE_STAGE_TOTAL, pipeline->index, image_buffer->sequence,
+			image_buffer->timestamp_us, renamed);
+		pthread_mutex_lock(&pipeline->mutex);
+		pipeline->written_images++;
+		pthread_mutex_unlock(&pipeline->mutex);
 	}
+
 	free(image_info);
-	free(buffer);
+	image_buffer_unref(image_buffer);
 }
 
 static void __thread_end_cb(void *data, Ecore_Thread *th)
 {
-	app_data *ad = (app_data *)data;
+	camera_pipeline_s *pipeline = (camera_pipeline_s *)data;
 
-	pthread_mutex_lock(&ad->mutex);
-	ad->image_writter_thread = NULL;
-	pthread_mutex_unlock(&ad->mutex);
+	pthread_mutex_lock(&pipeline->mutex);
+	pipeline->image_writter_thread = NULL;
+	pthread_mutex_unlock(&pipeline->mutex);
 }
 
 static void __thread_cancel_cb(void *data, Ecore_Thread *th)
 {
-	app_data *ad = (app_data *)data;
-	unsigned char *buffer = NULL;
+	camera_pipeline_s *pipeline = (camera_pipeline_s *)data;
+	image_buffer_data_s *image_buffer = NULL;
+
+	_E("Thread %p got cancelled.\n", th);
+	pthread_mutex_lock(&pipeline->mutex);
+	image_buffer = pipeline->latest_image;
+	pipeline->latest_image = NULL;
+	pipeline->image_writter_thread = NULL;
+	pthread_mutex_unlock(&pipeline->mutex);
+
+	image_buffer_unref(image_buffer);
+}
+
+static void __thread_write_evidence_file(void *data, Ecore_Thread *th)
+{
+	camera_pipeline_s *pipeline = (camera_pipeline_s *)data;
+	image_buffer_data_s *image_buffer = NULL;
+	GError *error = NULL;
+	gchar *path = NULL;
+
+	/* A still that arrives while writing is picked up by the same thread */
+	while (1) {
+		pthread_mutex_lock(&pipeline->mutex);
+		image_buffer = pipeline->evidence_image;
+		pipeline->evidence_image = NULL;
+		pthread_mutex_unlock(&pipeline->mutex);
+
+		if (!image_buffer)
+			break;
+
+		path = g_strdup_printf("%s%02u.jpg", pipeline->evidence_filename_prefix,
+				pipeline->evidence_count++ % EVIDENCE_IMAGE_COUNT);
+
+		if (g_file_set_contents(path, (const gchar *)image_buffer->buffer, image_buffer->buffer_size, &error)) {
+			frame_trace_record(FRAME_TRACE_STAGE_SNAPSHOT, pipeline->index, image_buffer->sequence,
+				image_buffer->timestamp_us, frame_trace_get_time_us());
+			_I("camera%d evidence [%s] [%u x %u], %u bytes", pipeline->index, path,
+				image_buffer->image_width, image_buffer->image_height, image_buffer->buffer_size);
+		} else {
+			_E("Failed to write evidence [%s]", error ? error->message : path);
+			g_clear_error(&error);
+		}
+
+		g_free(path);
+		image_buffer_unref(image_buffer);
+	}
+}
+
+static void __start_evidence_writer(void *data);
+
+static void __evidence_thread_end_cb(void *data, Ecore_Thread *th)
+{
+	camera_pipeline_s *pipeline = (camera_pipeline_s *)data;
+
+	pthread_mutex_lock(&pipeline->mutex);
+	pipeline->evidence_writer_thread = NULL;
+	pthread_mutex_unlock(&pipeline->mutex);
+
+	/* A still may have come between the last check of the thread and its end */
+	__start_evidence_writer(pipeline);
+}
+
+static void __evidence_thread_cancel_cb(void *data, Ecore_Thread *th)
+{
+	camera_pipeline_s *pipeline = (camera_pipeline_s *)data;
 
 	_E("Thread %p got cancelled.\n", th);
-	pthread_mutex_lock(&ad->mutex);
-	buffer = ad->latest_image_buffer;
-	ad->latest_image_buffer = NULL;
-	ad->image_writter_thread = NULL;
-	pthread_mutex_unlock(&ad->mutex);
+	pthread_mutex_lock(&pipeline->mutex);
+	pipeline->evidence_writer_thread = NULL;
+	pthread_mutex_unlock(&pipeline->mutex);
+}
 
-	free(buffer);
+static void __start_evidence_writer(void *data)
+{
+	camera_pipeline_s *pipeline = (camera_pipeline_s *)data;
+
+	pthread_mutex_lock(&pipeline->mutex);
+	if (pipeline->evidence_image && !pipeline->evidence_writer_thread)
+		pipeline->evidence_writer_thread = ecore_thread_run(__thread_write_evidence_file,
+				__evidence_thread_end_cb, __evidence_thread_cancel_cb, pipeline);
+	pthread_mutex_unlock(&pipeline->mutex);
 }
 
-static void __copy_image_buffer(image_buffer_data_s *image_buffer, app_data *ad)
+static void __evidence_wakeup_cb(void *data)
 {
-	unsigned char *buffer = NULL;
+	evidence_wakeup_s *wakeup = data;
 
-	pthread_mutex_lock(&ad->mutex);
-	ad->latest_image_height = image_buffer->image_height;
-	ad->latest_image_width = image_buffer->image_width;
+	if (wakeup->closed) {
+		free(wakeup);
+		return;
+	}
 
-	buffer = ad->latest_image_buffer;
-	ad->latest_image_buffer = image_buffer->buffer;
-	pthread_mutex_unlock(&ad->mutex);
+	/* Cleared before starting, a still arriving from now on queues another wakeup */
+	g_atomic_int_set(&wakeup->pending, 0);
 
-	free(buffer);
+	__start_evidence_writer(wakeup->pipeline);
 }
 
-static void __preview_image_buffer_created_cb(void *data)
+/* After the camera stopped, a queued wakeup owns the release */
+static void __evidence_wakeup_close(evidence_wakeup_s *wakeup)
 {
-	image_buffer_data_s *image_buffer = data;
-	app_data *ad = (app_data *)image_buffer->user_data;
-	mv_source_h source = NULL;
-	mv_colorspace_e image_colorspace = MEDIA_VISION_COLORSPACE_INVALID;
-	switch_state_e switch_state = SWITCH_STATE_OFF;
-	char *info = NULL;
+	ret_if(!wakeup);
 
-	ret_if(!image_buffer);
-	ret_if(!ad);
+	wakeup->closed = true;
+	if (g_atomic_int_compare_and_exchange(&wakeup->pending, 0, 1))
+		free(wakeup);
+}
 
-	image_colorspace = __convert_colorspace_from_cam_to_mv(image_buffer->format);
-	goto_if(image_colorspace == MEDIA_VISION_COLORSPACE_INVALID, FREE_ALL_BUFFER);
+static void __evidence_captured_cb(image_buffer_data_s *image_buffer, void *user_data)
+{
+	camera_pipeline_s *pipeline = (camera_pipeline_s *)user_data;
+	image_buffer_data_s *old_image_buffer = NULL;
 
-	__copy_image_buffer(image_buffer, ad);
+	pthread_mutex_lock(&pipeline->mutex);
+	old_image_buffer = pipeline->evidence_image;
+	pipeline->evidence_image = image_buffer;
+	pthread_mutex_unlock(&pipeline->mutex);
 
-	switch_state_get(&switch_state);
-	if (switch_state == SWITCH_STATE_OFF) { /* SWITCH_STATE_OFF means automatic mode */
-		source = controller_mv_create_source(image_buffer->buffer,
-					image_buffer->buffer_size, image_buffer->image_width,
-					image_buffer->image_height, image_colorspace);
+	if (old_image_buffer) {
+		_W("camera%d evidence writer falls behind, a still is dropped", pipeline->index);
+		image_buffer_unref(old_image_buffer);
 	}
 
-	pthread_mutex_lock(&ad->mutex);
-	info = ad->latest_image_info;
-	ad->latest_image_info = NULL;
-	pthread_mutex_unlock(&ad->mutex);
-	free(info);
+	/* Called on the camera thread, ecore threads are started from the main loop */
+	if (g_atomic_int_compare_and_exchange(&pipeline->evidence_wakeup->pending, 0, 1))
+		ecore_main_loop_thread_safe_call_async(__evidence_wakeup_cb, pipeline->evidence_wakeup);
+}
 
-	if (source)
-		controller_mv_push_source(source);
+static void __capture_evidence(camera_pipeline_s *pipeline, long long int now)
+{
+	if (now < pipeline->last_evidence_time + EVIDENCE_CAPTURE_INTERVAL_MS)
+		return;
+
+	if (resource_camera_capture(pipeline->camera, __evidence_captured_cb, pipeline) == 0)
+		pipeline->last_evidence_time = now;
+}
+
+static void __set_latest_image_buffer(image_buffer_data_s *image_buffer, camera_pipeline_s *pipeline)
+{
+	image_buffer_data_s *old_image_buffer = NULL;
 
-	free(image_buffer);
+	image_buffer_ref(image_buffer);
 
-	motion_state_set(ad->motion_state, APP_CALLBACK_KEY);
-	ad->motion_state = 0;
+	pthread_mutex_lock(&pipeline->mutex);
+	old_image_buffer = pipeline->latest_image;
+	pipeline->latest_image = image_buffer;
+	pthread_mutex_unlock(&pipeline->mutex);
+
+	image_buffer_unref(old_image_buffer);
+}
+
+static void __update_motion_state(app_data *ad)
+{
+	int motion_state = 0;
+	int i = 0;
 
-	pthread_mutex_lock(&ad->mutex);
-	if (!ad->image_writter_thread) {
-		ad->image_writter_thread = ecore_thread_run(__thread_write_image_file, __thread_end_cb, __thread_cancel_cb, ad);
+	/* The motion sensor resource stands for all cameras */
+	for (i = 0; i < ad->pipeline_count; i++)
+		motion_state |= ad->pipelines[i].motion_state;
+
+	motion_state_set(motion_state, APP_CALLBACK_KEY);
+}
+
+/* The latest image is written with what the analysis of its frame found, if anything */
+static void __finish_frame(camera_pipeline_s *pipeline)
+{
+	pipeline->analysed_frames++;
+
+	__update_motion_state(pipeline->ad);
+
+	pthread_mutex_lock(&pipeline->mutex);
+	if (!pipeline->image_writter_thread) {
+		pipeline->image_writter_thread = ecore_thread_run(__thread_write_image_file, __thread_end_cb, __thread_cancel_cb, pipeline);
 	} else {
 		_E("Thread is running NOW");
 	}
-	pthread_mutex_unlock(&ad->mutex);
+	pthread_mutex_unlock(&pipeline->mutex);
+}
+
+static void __clear_result_info(camera_pipeline_s *pipeline)
+{
+	char *info = NULL;
+
+	pthread_mutex_lock(&pipeline->mutex);
+	info = pipeline->latest_image_info;
+	pipeline->latest_image_info = NULL;
+	pthread_mutex_unlock(&pipeline->mutex);
+	free(info);
+}
 
+static void __preview_image_buffer_created_cb(void *data)
+{
+	image_buffer_data_s *image_buffer = data;
+	camera_pipeline_s *pipeline = NULL;
+	switch_state_e switch_state = SWITCH_STATE_OFF;
+
+	ret_if(!image_buffer);
+	pipeline = (camera_pipeline_s *)image_buffer->user_data;
+	goto_if(!pipeline, FREE_ALL_BUFFER);
+
+	__set_latest_image_buffer(image_buffer, pipeline);
+
+	switch_state_get(&switch_state);
+	if (switch_state == SWITCH_STATE_OFF || pipeline->index != SERVO_CAMERA_INDEX) {
+		/* SWITCH_STATE_OFF means automatic mode, fixed cameras are always automatic. The worker finishes the frame */
+		image_buffer->trace_time_us = frame_trace_get_time_us();
+		analysis_worker_push(pipeline->worker, image_buffer);
+		return;
+	}
+
+	/* Someone is steering the camera by hand, keep the full frame rate */
+	frame_governor_report_activity(resource_camera_get_frame_governor(pipeline->camera));
+
+	__clear_result_info(pipeline);
+	pipeline->motion_state = 0;
+	__finish_frame(pipeline);
+
+	image_buffer_unref(image_buffer);
 	return;
 
 FREE_ALL_BUFFER:
-	free(image_buffer->buffer);
-	free(image_buffer);
+	image_buffer_unref(image_buffer);
+}
+
+/* On the analysis worker */
+static void __analyse_frame_cb(image_buffer_data_s *image_buffer, void *user_data)
+{
+	camera_pipeline_s *pipeline = user_data;
+	analysis_result_s *analysis_result = NULL;
+	long long int started = frame_trace_get_time_us();
+	long long int ended = 0;
+
+	frame_trace_record(FRAME_TRACE_STAGE_HANDOFF, pipeline->index, image_buffer->sequence,
+		image_buffer->trace_time_us, started);
+
+	analysis_result = calloc(1, sizeof(analysis_result_s));
+	retm_if(!analysis_result, "failed to allocate analysis result");
+	analysis_result->sequence = image_buffer->sequence;
+
+	/* __mv_detection_event_cb fills it inside the push */
+	pipeline->analysis_result = analysis_result;
+	controller_mv_push_source(pipeline->mv, image_buffer);
+	pipeline->analysis_result = NULL;
+	analysis_result->view_lost = controller_mv_get_view_shift(pipeline->mv,
+		&analysis_result->view_shift_x, &analysis_result->view_shift_y) != 0;
+
+	ended = frame_trace_get_time_us();
+	frame_trace_record(FRAME_TRACE_STAGE_ANALYSIS, pipeline->index, image_buffer->sequence, started, ended);
+
+	/* Only the regions that passed the size filter go to the second stage, the frame is still ours */
+	if (pipeline->classifier && analysis_result->result_count > 0) {
+		long long int classify_started = ended;
+
+		controller_classifier_classify(pipeline->classifier, image_buffer, analysis_result->result,
+			analysis_result->result_count, analysis_result->detected_ms, analysis_result->verdicts);
+		ended = frame_trace_get_time_us();
+		frame_trace_record(FRAME_TRACE_STAGE_CLASSIFY, pipeline->index, image_buffer->sequence, classify_started, ended);
+	}
+
+	frame_governor_report_cost(resource_camera_get_frame_governor(pipeline->camera),
+		FRAME_GOVERNOR_STAGE_ANALYSIS, (ended - started) / 1000);
+
+	analysis_result->posted_us = frame_trace_get_time_us();
+	analysis_worker_post(pipeline->worker, analysis_result);
+}
+
+static void __print_pipeline_stats(camera_pipeline_s *pipeline)
+{
+	frame_pool_stats_s pool_stats = {0, };
+	frame_queue_stats_s queue_stats = {0, };
+	unsigned int current_fps = 0;
+	unsigned int target_fps = 0;
+	unsigned int written_images = 0;
+	unsigned int engine_frames = 0;
+	unsigned int still_frames = 0;
+
+	if (resource_camera_get_frame_pool_stats(pipeline->camera, &pool_stats) == 0)
+		_I("camera%d frame pool - in use[%u/%u], high water[%u], exhausted[%u]", pipeline->index,
+			pool_stats.in_use, pool_stats.capacity, pool_stats.high_water, pool_stats.exhausted);
+
+	if (resource_camera_get_frame_queue_stats(pipeline->camera, &queue_stats) == 0) {
+		_I("camera%d frame queue - depth[%u/%u], max depth[%u], enqueued[%u], dropped[%u]", pipeline->index,
+			queue_stats.depth, queue_stats.capacity, queue_stats.max_depth,
+			queue_stats.enqueued, queue_stats.dropped);
+
+		if (queue_stats.dropped > pipeline->last_dropped_frames)
+			_W("camera%d analysis falls behind, %u frames dropped in last %.0f sec", pipeline->index,
+				queue_stats.dropped - pipeline->last_dropped_frames, PIPELINE_STATS_INTERVAL_SEC);
+		pipeline->last_dropped_frames = queue_stats.dropped;
+	}
+
+	_I("camera%d analysis worker - dropped[%u]", pipeline->index, analysis_worker_get_dropped(pipeline->worker));
+
+	controller_mv_get_activity_stats(pipeline->mv, &engine_frames, &still_frames);
+	_I("camera%d movement detection - analysed[%u], skipped as still[%u]", pipeline->index,
+		engine_frames, still_frames);
+
+	if (pipeline->classifier) {
+		unsigned int classified = 0;
+		unsigned int skipped = 0;
+
+		controller_classifier_get_stats(pipeline->classifier, &classified, &skipped);
+		_I("camera%d classifier - classified[%u], skipped for a fresh track verdict[%u]", pipeline->index,
+			classified, skipped);
+	}
+
+	frame_governor_get_fps(resource_camera_get_frame_governor(pipeline->camera), &current_fps, &target_fps);
+	_I("camera%d frame governor - fps[%u], target fps[%u]", pipeline->index, current_fps, target_fps);
+
+	pthread_mutex_lock(&pipeline->mutex);
+	written_images = pipeline->written_images;
+	pipeline->written_images = 0;
+	pthread_mutex_unlock(&pipeline->mutex);
+
+	/* Stage latencies are in the frame trace report */
+	_I("camera%d analysed - fps[%.1f], written - fps[%.1f]", pipeline->index,
+		pipeline->analysed_frames / PIPELINE_STATS_INTERVAL_SEC, written_images / PIPELINE_STATS_INTERVAL_SEC);
+
+	pipeline->analysed_frames = 0;
+}
+
+static Eina_Bool __pipeline_stats_timer_cb(void *data)
+{
+	app_data *ad = (app_data *)data;
+	int i = 0;
+
+	retv_if(!ad, ECORE_CALLBACK_CANCEL);
+
+	for (i = 0; i < ad->pipeline_count; i++)
+		__print_pipeline_stats(&ad->pipelines[i]);
+
+	frame_trace_report(ad->frame_trace_report_path);
+
+	return ECORE_CALLBACK_RENEW;
+}
+
+static void __write_heatmap(camera_pipeline_s *pipeline)
+{
+	GError *error = NULL;
+	char *json = NULL;
+
+	json = controller_mv_get_heatmap(pipeline->mv);
+	ret_if(!json);
+
+	/* Written to a temporary file and renamed, the dashboard never reads half a snapshot */
+	if (!g_file_set_contents(pipeline->heatmap_filename, json, -1, &error)) {
+		_E("Failed to write heat map [%s]", error ? error->message : pipeline->heatmap_filename);
+		g_clear_error(&error);
+	}
+
+	g_free(json);
+}
+
+/* Hours and days of movement survive a restart, the snapshot of the last run is continued */
+static void __load_heatmap(camera_pipeline_s *pipeline)
+{
+	GError *error = NULL;
+	gchar *json = NULL;
+
+	if (!g_file_test(pipeline->heatmap_filename, G_FILE_TEST_EXISTS))
+		return;
+
+	if (!g_file_get_contents(pipeline->heatmap_filename, &json, NULL, &error)) {
+		_E("Failed to read heat map [%s]", error ? error->message : pipeline->heatmap_filename);
+		g_clear_error(&error);
+		return;
+	}
+
+	if (controller_mv_load_heatmap(pipeline->mv, json))
+		_W("camera%d heat map [%s] not restored, it starts over", pipeline->index, pipeline->heatmap_filename);
+
+	g_free(json);
+}
+
+static Eina_Bool __heatmap_timer_cb(void *data)
+{
+	app_data *ad = data;
+	int i = 0;
+
+	retv_if(!ad, ECORE_CALLBACK_CANCEL);
+
+	for (i = 0; i < ad->pipeline_count; i++)
+		__write_heatmap(&ad->pipelines[i]);
+
+	return ECORE_CALLBACK_RENEW;
+}
+
+/* The view of the servo camera changed, what its background model learnt is of another scene */
+static void __servo_camera_moved(app_data *ad)
+{
+	if (ad->pipeline_count > SERVO_CAMERA_INDEX)
+		controller_mv_reset(ad->pipelines[SERVO_CAMERA_INDEX].mv);
+}
+
+/* Turned by __move_camera(), detection follows the view as it shifts */
+static void __servo_camera_turning(app_data *ad, float view_x, float view_y)
+{
+	camera_pipeline_s *pipeline = NULL;
+
+	ret_if(ad->pipeline_count <= SERVO_CAMERA_INDEX);
+
+	pipeline = &ad->pipelines[SERVO_CAMERA_INDEX];
+	controller_mv_turn(pipeline->mv, view_x, view_y);
+	pipeline->turn_pending_x = view_x;
+	pipeline->turn_pending_y = view_y;
+}
+
+/* Moved by someone else, where the tracks were is unknown */
+static void __servo_camera_steered(app_data *ad)
+{
+	__servo_camera_moved(ad);
+	if (ad->pipeline_count > SERVO_CAMERA_INDEX)
+		controller_tracker_reset(ad->pipelines[SERVO_CAMERA_INDEX].tracker);
 }
 
 static void __move_camera(int x, int y, void *user_data)
 {
 	app_data *ad = (app_data *)user_data;
+	float view_x = 0.0f;
+	float view_y = 0.0f;
 	ret_if(!ad);
 
 	// x, y Range : -10 ~ 10
@@ -286,16 +693,22 @@ static void __move_camera(int x, int y, void *user_data)
 	if (calculated_y < SERVO_MOTOR_VERTICAL_MIN)
 		calculated_y = SERVO_MOTOR_VERTICAL_MIN;
 
+	/* The view shifts the other way, and only as far as the servo really turns at its limits */
+	view_x = (calculated_x - ad->current_servo_x) / SERVO_MOTOR_HORIZONTAL_STEP * VIEW_PERCENT_PER_SERVO_STEP;
+	view_y = -(calculated_y - ad->current_servo_y) / SERVO_MOTOR_VERTICAL_STEP * VIEW_PERCENT_PER_SERVO_STEP;
+
 	ad->current_servo_x = calculated_x;
 	ad->current_servo_y = calculated_y;
 
 	servo_h_state_set(calculated_x, APP_CALLBACK_KEY);
 	servo_v_state_set(calculated_y, APP_CALLBACK_KEY);
+	if (view_x != 0.0f || view_y != 0.0f)
+		__servo_camera_turning(ad, view_x, view_y);
 
 	return;
 }
 
-static void __set_result_info(int result[], int result_count, app_data *ad, int image_result_type)
+static void __set_result_info(int result[], int result_count, camera_pipeline_s *pipeline, int image_result_type)
 {
 	char image_info[IMAGE_INFO_MAX + 1] = {'\0', };
 	char *current_position;
@@ -304,6 +717,9 @@ static void __set_result_info(int result[], int result_count, app_data *ad, int
 	int i = 0;
 	char *latest_image_info = NULL;
 	char *info = NULL;
+	const controller_tracker_track_s *tracks = NULL;
+	const controller_tracker_track_s *primary = NULL;
+	int track_count = 0;
 
 	current_position = image_info;
 
@@ -323,68 +739,192 @@ static void __set_result_info(int result[], int result_count, app_data *ad, int
 		string_count += 8;
 	}
 
+	track_count = controller_tracker_get_tracks(pipeline->tracker, &tracks);
+	primary = controller_tracker_get_primary(pipeline->tracker);
+
+	current_position += snprintf(current_position, IMAGE_INFO_MAX - string_count, "%02d%02u",
+		track_count, primary ? primary->id : 0);
+	string_count += 4;
+
+	/* Velocities in percent per second, offset by 50 to stay positive */
+	for (i = 0; i < track_count; i++) {
+		const controller_tracker_track_s *track = &tracks[i];
+
+		if (IMAGE_INFO_MAX - string_count < 16)
+			break;
+
+		current_position += snprintf(current_position, IMAGE_INFO_MAX - string_count, "%02u%02d%02d%02d%02d%02d%02d%02u"
+			, track->id
+			, CLAMP((int)(track->x - track->width / 2), 0, 99), CLAMP((int)(track->y - track->height / 2), 0, 99)
+			, CLAMP((int)track->width, 0, 99), CLAMP((int)track->height, 0, 99)
+			, CLAMP((int)track->velocity_x + 50, 0, 99), CLAMP((int)track->velocity_y + 50, 0, 99)
+			, MIN(track->age, 99));
+		string_count += 16;
+	}
+
 	latest_image_info = strdup(image_info);
-	pthread_mutex_lock(&ad->mutex);
-	info = ad->latest_image_info;
-	ad->latest_image_info = latest_image_info;
-	pthread_mutex_unlock(&ad->mutex);
+	pthread_mutex_lock(&pipeline->mutex);
+	info = pipeline->latest_image_info;
+	pipeline->latest_image_info = latest_image_info;
+	pthread_mutex_unlock(&pipeline->mutex);
 	free(info);
 }
 
-static void __mv_detection_event_cb(int horizontal, int vertical, int result[], int result_count, void *user_data)
+/* Turns the servo camera towards where the primary track is heading */
+static void __follow_primary_track(camera_pipeline_s *pipeline, long long int now)
 {
-	app_data *ad = (app_data *)user_data;
-	long long int now = __get_monotonic_ms();
+	const controller_tracker_track_s *primary = controller_tracker_get_primary(pipeline->tracker);
+	float predicted_x = 0.0f;
+	float predicted_y = 0.0f;
+	int x = 0;
+	int y = 0;
+
+	if (!primary) {
+		_D("no confirmed track to follow");
+		return;
+	}
 
-	ad->motion_state = 1;
+	controller_tracker_predict(primary, now + TRACK_PREDICTION_LEAD_MS, &predicted_x, &predicted_y);
 
-	if (now < ad->last_moved_time + CAMERA_MOVE_INTERVAL_MS) {
-		ad->valid_event_count = 0;
-		pthread_mutex_lock(&ad->mutex);
-		ad->latest_image_type = 0; // 0: image during camera repositioning
-		pthread_mutex_unlock(&ad->mutex);
-		__set_result_info(result, result_count, ad, 0);
+	// Offset of the target from the centre, 50 percent is 10 steps
+	x = CLAMP((int)((predicted_x - 50.0f) / VIEW_PERCENT_PER_SERVO_STEP), -10, 10);
+	y = CLAMP((int)((predicted_y - 50.0f) / VIEW_PERCENT_PER_SERVO_STEP), -10, 10);
+
+	/* The move is meant to bring the target to the centre, the tracks follow the view as it turns */
+	__move_camera(x, y, pipeline->ad);
+}
+
+/* Tracks move along with the view of the turning camera, all at once when it was lost */
+static void __follow_view(camera_pipeline_s *pipeline, const analysis_result_s *analysis_result)
+{
+	if (analysis_result->view_lost) {
+		controller_tracker_shift(pipeline->tracker, pipeline->turn_pending_x, pipeline->turn_pending_y);
+		pipeline->turn_pending_x = 0.0f;
+		pipeline->turn_pending_y = 0.0f;
+		pipeline->last_moved_time = frame_trace_get_time_us() / 1000;
 		return;
 	}
 
-	if (now < ad->last_valid_event_time + VALID_EVENT_INTERVAL_MS) {
-		ad->valid_event_count++;
+	if (analysis_result->view_shift_x == 0.0f && analysis_result->view_shift_y == 0.0f)
+		return;
+
+	controller_tracker_shift(pipeline->tracker, analysis_result->view_shift_x, analysis_result->view_shift_y);
+	pipeline->turn_pending_x -= analysis_result->view_shift_x;
+	pipeline->turn_pending_y -= analysis_result->view_shift_y;
+}
+
+/* Without a classifier every movement counts */
+static int __person_tracked(camera_pipeline_s *pipeline)
+{
+	const controller_tracker_track_s *tracks = NULL;
+	int track_count = 0;
+	int i = 0;
+
+	if (!pipeline->classifier)
+		return 1;
+
+	track_count = controller_tracker_get_tracks(pipeline->tracker, &tracks);
+	for (i = 0; i < track_count; i++) {
+		if (tracks[i].verdict == CONTROLLER_CLASSIFIER_VERDICT_PERSON)
+			return 1;
+	}
+
+	return 0;
+}
+
+static void __handle_detection_event(camera_pipeline_s *pipeline,
+	int result[], int verdicts[], int result_count, long long int now)
+{
+	pipeline->motion_state = 1;
+	frame_governor_report_activity(resource_camera_get_frame_governor(pipeline->camera));
+
+	if (now < pipeline->last_moved_time + CAMERA_MOVE_INTERVAL_MS) {
+		pipeline->valid_event_count = 0;
+		pthread_mutex_lock(&pipeline->mutex);
+		pipeline->latest_image_type = 0; // 0: image during camera repositioning
+		pthread_mutex_unlock(&pipeline->mutex);
+		__set_result_info(result, result_count, pipeline, 0);
+		return;
+	}
+
+	/* Frames of a view being relearnt would teach the tracks the move, they coast through it instead */
+	controller_tracker_update(pipeline->tracker, result, pipeline->classifier ? verdicts : NULL, result_count, now);
+
+	if (now < pipeline->last_valid_event_time + VALID_EVENT_INTERVAL_MS) {
+		pipeline->valid_event_count++;
 	} else {
-		ad->valid_event_count = 1;
+		pipeline->valid_event_count = 1;
 	}
 
-	ad->last_valid_event_time = now;
+	pipeline->last_valid_event_time = now;
 
-	if (ad->valid_event_count < THRESHOLD_VALID_EVENT_COUNT) {
-		ad->valid_vision_result_x_sum += horizontal;
-		ad->valid_vision_result_y_sum += vertical;
-		pthread_mutex_lock(&ad->mutex);
-		ad->latest_image_type = 1; // 1: single valid image but not completed
-		pthread_mutex_unlock(&ad->mutex);
-		__set_result_info(result, result_count, ad, 1);
+	/* Moving leaves are movement too, only a person alerts and turns the camera */
+	if (pipeline->valid_event_count < THRESHOLD_VALID_EVENT_COUNT || !__person_tracked(pipeline)) {
+		pthread_mutex_lock(&pipeline->mutex);
+		pipeline->latest_image_type = 1; // 1: single valid image but not completed
+		pthread_mutex_unlock(&pipeline->mutex);
+		__set_result_info(result, result_count, pipeline, 1);
 		return;
 	}
 
-	ad->valid_event_count = 0;
-	ad->valid_vision_result_x_sum += horizontal;
-	ad->valid_vision_result_y_sum += vertical;
+	pipeline->valid_event_count = 0;
+
+	if (pipeline->index == SERVO_CAMERA_INDEX)
+		__follow_primary_track(pipeline, now);
+
+	pthread_mutex_lock(&pipeline->mutex);
+	pipeline->latest_image_type = 2; // 2: fully validated image
+	pthread_mutex_unlock(&pipeline->mutex);
+
+	__set_result_info(result, result_count, pipeline, 2);
+
+	__capture_evidence(pipeline, now);
+}
 
-	int x = ad->valid_vision_result_x_sum / THRESHOLD_VALID_EVENT_COUNT;
-	int y = ad->valid_vision_result_y_sum / THRESHOLD_VALID_EVENT_COUNT;
+/* On the analysis worker, only copies the result for the main loop */
+static void __mv_detection_event_cb(int horizontal, int vertical, int result[], int result_count, void *user_data)
+{
+	camera_pipeline_s *pipeline = (camera_pipeline_s *)user_data;
+	analysis_result_s *analysis_result = pipeline->analysis_result;
 
-	x = 10 * x / (IMAGE_WIDTH / 2);
-	y = 10 * y / (IMAGE_HEIGHT / 2);
+	ret_if(!analysis_result);
 
-	__move_camera((int) x, (int) y, ad);
-	ad->last_moved_time = now;
+	/* horizontal, vertical lump every region together, the tracker tells them apart */
+	analysis_result->detected_ms = frame_trace_get_time_us() / 1000;
+	analysis_result->result_count = MIN(result_count, MV_RESULT_COUNT_MAX);
+	memcpy(analysis_result->result, result, sizeof(int) * 4 * analysis_result->result_count);
+}
 
-	ad->valid_vision_result_x_sum = 0;
-	ad->valid_vision_result_y_sum = 0;
-	pthread_mutex_lock(&ad->mutex);
-	ad->latest_image_type = 2; // 2: fully validated image
-	pthread_mutex_unlock(&ad->mutex);
+/* On the main loop, for every frame the worker analysed */
+static void __analysis_result_cb(void *message, void *user_data)
+{
+	camera_pipeline_s *pipeline = user_data;
+	analysis_result_s *analysis_result = message;
+	long long int started = frame_trace_get_time_us();
+
+	frame_trace_record(FRAME_TRACE_STAGE_RESULT, pipeline->index, analysis_result->sequence,
+		analysis_result->posted_us, started);
+
+	__clear_result_info(pipeline);
+	pipeline->motion_state = 0;
+	__follow_view(pipeline, analysis_result);
+
+	if (analysis_result->detected_ms) {
+		__handle_detection_event(pipeline, analysis_result->result, analysis_result->verdicts,
+			analysis_result->result_count, analysis_result->detected_ms);
+		frame_trace_record(FRAME_TRACE_STAGE_EVENT, pipeline->index, analysis_result->sequence,
+			started, frame_trace_get_time_us());
+	}
 
-	__set_result_info(result, result_count, ad, 2);
+	/* Where the tracks are now and what they are, for the regions of the next frames */
+	if (pipeline->classifier) {
+		const controller_tracker_track_s *tracks = NULL;
+		int track_count = controller_tracker_get_tracks(pipeline->tracker, &tracks);
+
+		controller_classifier_publish_tracks(pipeline->classifier, tracks, track_count);
+	}
+
+	__finish_frame(pipeline);
 }
 
 static void __switch_changed(switch_state_e state, void* user_data)
@@ -402,6 +942,7 @@ static void __switch_changed(switch_state_e state, void* user_data)
 
 	servo_h_state_set(ad->current_servo_x, APP_CALLBACK_KEY);
 	servo_v_state_set(ad->current_servo_y, APP_CALLBACK_KEY);
+	__servo_camera_steered(ad);
 }
 
 static void __servo_v_changed(double value, void* user_data)
@@ -411,6 +952,7 @@ static void __servo_v_changed(double value, void* user_data)
 
 	_D("servo_v changed to - %lf", value);
 	ad->current_servo_y = value;
+	__servo_camera_steered(ad);
 }
 
 static void __servo_h_changed(double value, void* user_data)
@@ -420,6 +962,7 @@ static void __servo_h_changed(double value, void* user_data)
 
 	_D("servo_h changed to - %lf", value);
 	ad->current_servo_x = value;
+	__servo_camera_steered(ad);
 }
 
 static void __device_interfaces_fini(void)
@@ -466,43 +1009,432 @@ ERROR :
 	return -1;
 }
 
+static void __pipeline_fini(camera_pipeline_s *pipeline)
+{
+	Ecore_Thread *thread_id = NULL;
+	image_buffer_data_s *image_buffer = NULL;
+	char *info = NULL;
+
+	/* No new frame or still from here on, the camera itself goes last as the worker reports to its governor */
+	resource_camera_stop(pipeline->camera);
+	__evidence_wakeup_close(pipeline->evidence_wakeup);
+	pipeline->evidence_wakeup = NULL;
+	/* Joins the worker before what it pushes into goes away */
+	analysis_worker_destroy(pipeline->worker);
+	pipeline->worker = NULL;
+	/* The last minute of movement is kept too */
+	if (pipeline->mv && pipeline->heatmap_filename)
+		__write_heatmap(pipeline);
+	controller_mv_destroy(pipeline->mv);
+	pipeline->mv = NULL;
+	controller_tracker_destroy(pipeline->tracker);
+	pipeline->tracker = NULL;
+	controller_classifier_destroy(pipeline->classifier);
+	pipeline->classifier = NULL;
+
+	pthread_mutex_lock(&pipeline->mutex);
+	thread_id = pipeline->image_writter_thread;
+	pipeline->image_writter_thread = NULL;
+	pthread_mutex_unlock(&pipeline->mutex);
+
+	if (thread_id)
+		ecore_thread_wait(thread_id, 3.0); // wait for 3 second
+
+	/* The still is dropped first, so the writer's end does not start another one */
+	pthread_mutex_lock(&pipeline->mutex);
+	image_buffer = pipeline->evidence_image;
+	pipeline->evidence_image = NULL;
+	thread_id = pipeline->evidence_writer_thread;
+	pipeline->evidence_writer_thread = NULL;
+	pthread_mutex_unlock(&pipeline->mutex);
+
+	if (image_buffer)
+		image_buffer_unref(image_buffer);
+
+	if (thread_id)
+		ecore_thread_wait(thread_id, 3.0);
+
+	pthread_mutex_lock(&pipeline->mutex);
+	image_buffer = pipeline->latest_image;
+	pipeline->latest_image = NULL;
+	info = pipeline->latest_image_info;
+	pipeline->latest_image_info = NULL;
+	pthread_mutex_unlock(&pipeline->mutex);
+	image_buffer_unref(image_buffer);
+	free(info);
+
+	resource_camera_close(pipeline->camera);
+	pipeline->camera = NULL;
+
+	g_free(pipeline->temp_image_filename);
+	pipeline->temp_image_filename = NULL;
+	g_free(pipeline->latest_image_filename);
+	pipeline->latest_image_filename = NULL;
+	g_free(pipeline->evidence_filename_prefix);
+	pipeline->evidence_filename_prefix = NULL;
+	g_free(pipeline->heatmap_filename);
+	pipeline->heatmap_filename = NULL;
+
+	pthread_mutex_destroy(&pipeline->mutex);
+}
+
+static gchar *__get_camera_profile_path(void)
+{
+	char *data_path = NULL;
+	gchar *path = NULL;
+
+	data_path = app_get_data_path();
+	retv_if(!data_path, NULL);
+	path = g_strconcat(data_path, CAMERA_PROFILE_FILENAME, NULL);
+	free(data_path);
+
+	return path;
+}
+
+static GKeyFile *__open_camera_profile(void)
+{
+	GKeyFile *profile = NULL;
+	gchar *path = NULL;
+
+	path = __get_camera_profile_path();
+	retv_if(!path, NULL);
+
+	profile = g_key_file_new();
+	if (!g_key_file_load_from_file(profile, path, G_KEY_FILE_NONE, NULL)) {
+		_D("no camera profile [%s]", path);
+		g_key_file_free(profile);
+		profile = NULL;
+	}
+	g_free(path);
+
+	return profile;
+}
+
+static void __load_camera_profile(int index, camera_profile_s *camera_profile)
+{
+	GKeyFile *profile = NULL;
+	gchar *group = NULL;
+	gchar *engine_name = NULL;
+	gchar *classifier_name = NULL;
+	gchar *threshold = NULL;
+	const gchar *groups[2] = {"camera", NULL};
+	int value = 0;
+	int i = 0;
+
+	camera_profile->width = IMAGE_WIDTH;
+	camera_profile->height = IMAGE_HEIGHT;
+	camera_profile->engine = CAMERA_DEFAULT_ENGINE;
+	camera_profile->decimation = MV_ANALYSIS_DECIMATION;
+	camera_profile->merge_gap = MV_MERGE_GAP_DEFAULT;
+	camera_profile->merge_iou = MV_MERGE_IOU_DEFAULT;
+	camera_profile->activity_floor = MV_ACTIVITY_FLOOR_DEFAULT;
+	camera_profile->classifier = CONTROLLER_CLASSIFIER_ENGINE_NONE;
+
+	profile = __open_camera_profile();
+	ret_if(!profile);
+
+	group = g_strdup_printf("camera%d", index);
+	groups[1] = group;
+
+	/* The camera's own group is read last and wins */
+	for (i = 0; i < 2; i++) {
+		value = g_key_file_get_integer(profile, groups[i], "width", NULL);
+		if (value > 0)
+			camera_profile->width = value;
+
+		value = g_key_file_get_integer(profile, groups[i], "height", NULL);
+		if (value > 0)
+			camera_profile->height = value;
+
+		engine_name = g_key_file_get_string(profile, groups[i], "engine", NULL);
+		if (engine_name && controller_mv_engine_from_name(g_strstrip(engine_name), &camera_profile->engine))
+			_W("camera%d profile - unknown engine [%s]", index, engine_name);
+		g_free(engine_name);
+
+		classifier_name = g_key_file_get_string(profile, groups[i], "classifier", NULL);
+		if (classifier_name && controller_classifier_engine_from_name(g_strstrip(classifier_name), &camera_profile->classifier))
+			_W("camera%d profile - unknown classifier [%s]", index, classifier_name);
+		g_free(classifier_name);
+
+		value = g_key_file_get_integer(profile, groups[i], "decimation", NULL);
+		if (value > 0)
+			camera_profile->decimation = value;
+
+		/* "auto" or a luma difference, so [cameraN] can go back to auto */
+		threshold = g_key_file_get_string(profile, groups[i], "threshold", NULL);
+		if (threshold) {
+			g_strstrip(threshold);
+			value = g_ascii_strtoll(threshold, NULL, 10);
+			if (!g_strcmp0(threshold, "auto"))
+				camera_profile->threshold = 0;
+			else if (value > 0 && value < 256)
+				camera_profile->threshold = value;
+			else
+				_W("camera%d profile - unsupported threshold [%s]", index, threshold);
+		}
+		g_free(threshold);
+
+		/* 0 still merges touching regions, -1 turns the gap off */
+		if (g_key_file_has_key(profile, groups[i], "merge_gap", NULL)) {
+			value = g_key_file_get_integer(profile, groups[i], "merge_gap", NULL);
+			if (value >= -1 && value <= 100)
+				camera_profile->merge_gap = value;
+			else
+				_W("camera%d profile - unsupported merge_gap [%d]", index, value);
+		}
+
+		if (g_key_file_has_key(profile, groups[i], "merge_iou", NULL)) {
+			value = g_key_file_get_integer(profile, groups[i], "merge_iou", NULL);
+			if (value >= 0 && value <= 100)
+				camera_profile->merge_iou = value;
+			else
+				_W("camera%d profile - unsupported merge_iou [%d]", index, value);
+		}
+
+		/* 0 turns the check off */
+		if (g_key_file_has_key(profile, groups[i], "activity_floor", NULL)) {
+			value = g_key_file_get_integer(profile, groups[i], "activity_floor", NULL);
+			if (value >= 0)
+				camera_profile->activity_floor = value;
+			else
+				_W("camera%d profile - unsupported activity_floor [%d]", index, value);
+		}
+	}
+
+	_I("camera%d profile - resolution [%u x %u], analysis at 1/%u, threshold %u, merge gap %d iou %u, activity floor %u", index,
+		camera_profile->width, camera_profile->height, camera_profile->decimation, camera_profile->threshold,
+		camera_profile->merge_gap, camera_profile->merge_iou, camera_profile->activity_floor);
+
+	g_free(group);
+	g_key_file_free(profile);
+}
+
+/* NULL when the profile has no polygons for the camera or one of them does not parse */
+static controller_mv_mask_h __load_camera_mask(int index)
+{
+	GKeyFile *profile = NULL;
+	controller_mv_mask_h mask = NULL;
+	gchar *group = NULL;
+	gchar **include = NULL;
+	gchar **exclude = NULL;
+	gchar **list = NULL;
+	const gchar *groups[2] = {"camera", NULL};
+	int i = 0;
+
+	profile = __open_camera_profile();
+	retv_if(!profile, NULL);
+
+	group = g_strdup_printf("camera%d", index);
+	groups[1] = group;
+
+	/* Like the other keys, a list of the camera's own group replaces the one of [camera] */
+	for (i = 0; i < 2; i++) {
+		list = g_key_file_get_string_list(profile, groups[i], "include", NULL, NULL);
+		if (list) {
+			g_strfreev(include);
+			include = list;
+		}
+
+		list = g_key_file_get_string_list(profile, groups[i], "exclude", NULL, NULL);
+		if (list) {
+			g_strfreev(exclude);
+			exclude = list;
+		}
+	}
+
+	if (include || exclude) {
+		mask = controller_mv_mask_create((const char *const *)include, (const char *const *)exclude);
+		if (mask)
+			_I("camera%d mask - %u include, %u exclude polygons", index,
+				include ? g_strv_length(include) : 0, exclude ? g_strv_length(exclude) : 0);
+		else
+			_E("camera%d mask is invalid, the whole frame is analysed", index);
+	}
+
+	g_strfreev(include);
+	g_strfreev(exclude);
+	g_free(group);
+	g_key_file_free(profile);
+
+	return mask;
+}
+
+/* 0 when there is no profile */
+static time_t __get_camera_profile_modified_time(void)
+{
+	struct stat profile_stat;
+	gchar *path = NULL;
+	time_t modified_time = 0;
+
+	path = __get_camera_profile_path();
+	retv_if(!path, 0);
+
+	if (stat(path, &profile_stat) == 0)
+		modified_time = profile_stat.st_mtime;
+	g_free(path);
+
+	return modified_time;
+}
+
+/* Masks follow camera_profile.ini while the pipelines run, the rest of the profile needs a restart */
+static Eina_Bool __profile_reload_timer_cb(void *data)
+{
+	app_data *ad = data;
+	time_t modified_time = __get_camera_profile_modified_time();
+	int i = 0;
+
+	if (modified_time == ad->profile_modified_time)
+		return ECORE_CALLBACK_RENEW;
+
+	ad->profile_modified_time = modified_time;
+	_I("camera profile changed, reloading masks");
+
+	for (i = 0; i < ad->pipeline_count; i++)
+		controller_mv_set_mask(ad->pipelines[i].mv, __load_camera_mask(ad->pipelines[i].index));
+
+	return ECORE_CALLBACK_RENEW;
+}
+
+static int __pipeline_init(app_data *ad, int index, const char *shared_data_path)
+{
+	camera_pipeline_s *pipeline = &ad->pipelines[index];
+	camera_profile_s profile = {0, };
+
+	pipeline->index = index;
+	pipeline->ad = ad;
+	pthread_mutex_init(&pipeline->mutex, NULL);
+
+	/* The dashboard reads latest.jpg, so the servo camera keeps the old names */
+	if (index == SERVO_CAMERA_INDEX) {
+		pipeline->temp_image_filename = g_strconcat(shared_data_path, "tmp.jpg", NULL);
+		pipeline->latest_image_filename = g_strconcat(shared_data_path, "latest.jpg", NULL);
+		pipeline->heatmap_filename = g_strconcat(shared_data_path, "heatmap.json", NULL);
+	} else {
+		pipeline->temp_image_filename = g_strdup_printf("%stmp_%d.jpg", shared_data_path, index);
+		pipeline->latest_image_filename = g_strdup_printf("%slatest_%d.jpg", shared_data_path, index);
+		pipeline->heatmap_filename = g_strdup_printf("%sheatmap_%d.json", shared_data_path, index);
+	}
+
+	pipeline->evidence_filename_prefix = g_strdup_printf("%s%s%d_", shared_data_path, IMAGE_FILE_PREFIX, index);
+
+	pipeline->evidence_wakeup = calloc(1, sizeof(evidence_wakeup_s));
+	if (!pipeline->evidence_wakeup) {
+		_E("Failed to allocate evidence wakeup of camera%d", index);
+		goto ERROR;
+	}
+	pipeline->evidence_wakeup->pipeline = pipeline;
+
+	_D("%s", pipeline->temp_image_filename);
+	_D("%s", pipeline->latest_image_filename);
+
+	__load_camera_profile(index, &profile);
+
+	pipeline->tracker = controller_tracker_create();
+	if (!pipeline->tracker) {
+		_E("Failed to create tracker of camera%d", index);
+		goto ERROR;
+	}
+
+	/* The camera index doubles as the media vision stream id */
+	pipeline->mv = controller_mv_create(index, profile.engine, __mv_detection_event_cb, pipeline);
+	if (!pipeline->mv) {
+		_E("Failed to create movement detection of camera%d", index);
+		goto ERROR;
+	}
+	_I("camera%d movement detection - %s", index, controller_mv_get_engine_name(pipeline->mv));
+	__load_heatmap(pipeline);
+
+	/* An unsupported value keeps MV_ANALYSIS_DECIMATION */
+	controller_mv_set_decimation(pipeline->mv, profile.decimation);
+	controller_mv_set_merge(pipeline->mv, profile.merge_gap, profile.merge_iou);
+	controller_mv_set_activity_floor(pipeline->mv, profile.activity_floor);
+	if (controller_mv_set_threshold(pipeline->mv, profile.threshold))
+		_W("camera%d movement detection - threshold %u not applied", index, profile.threshold);
+	controller_mv_set_mask(pipeline->mv, __load_camera_mask(index));
+
+	/* Without its classifier the camera still runs, every movement counts then */
+	if (profile.classifier != CONTROLLER_CLASSIFIER_ENGINE_NONE) {
+		pipeline->classifier = controller_classifier_create(profile.classifier);
+		if (!pipeline->classifier)
+			_W("camera%d classifier not available, every movement counts", index);
+	}
+	_I("camera%d classifier - %s", index, controller_classifier_get_engine_name(pipeline->classifier));
+
+	pipeline->worker = analysis_worker_create(__analyse_frame_cb, __analysis_result_cb, pipeline);
+	if (!pipeline->worker) {
+		_E("Failed to start analysis worker of camera%d", index);
+		goto ERROR;
+	}
+
+	if (resource_camera_init(index, profile.width, profile.height, __preview_image_buffer_created_cb, pipeline, &pipeline->camera) == -1) {
+		_E("Failed to init camera%d", index);
+		goto ERROR;
+	}
+
+	/* The camera may have picked another size, everything downstream follows the camera */
+	resource_camera_get_preview_resolution(pipeline->camera, &pipeline->image_width, &pipeline->image_height);
+
+	if (resource_camera_start_preview(pipeline->camera) == -1) {
+		_E("Failed to start camera%d preview", index);
+		goto ERROR;
+	}
+
+	return 0;
+
+ERROR:
+	__pipeline_fini(pipeline);
+	return -1;
+}
+
 static bool service_app_create(void *data)
 {
 	app_data *ad = (app_data *)data;
+	char *data_path = NULL;
+	int i = 0;
 
 	char* shared_data_path = app_get_shared_data_path();
 	if (shared_data_path == NULL) {
 		_E("Failed to get shared data path");
 		goto ERROR;
 	}
-	ad->temp_image_filename = g_strconcat(shared_data_path, "tmp.jpg", NULL);
-	ad->latest_image_filename = g_strconcat(shared_data_path, "latest.jpg", NULL);
-	free(shared_data_path);
-
-	_D("%s", ad->temp_image_filename);
-	_D("%s", ad->latest_image_filename);
 
 	controller_image_initialize();
 
-	pthread_mutex_init(&ad->mutex, NULL);
+#ifdef CONTROLLER_MV_BENCHMARK
+	controller_mv_benchmark();
+#endif
 
-	if (__device_interfaces_init(ad))
+	if (frame_trace_init()) {
+		free(shared_data_path);
 		goto ERROR;
+	}
 
-	if (controller_mv_set_movement_detection_event_cb(__mv_detection_event_cb, data) == -1) {
-		_E("Failed to set movement detection event callback");
-		goto ERROR;
+	data_path = app_get_data_path();
+	if (data_path) {
+		ad->frame_trace_report_path = g_strconcat(data_path, FRAME_TRACE_REPORT_FILENAME, NULL);
+		free(data_path);
 	}
 
-	if (resource_camera_init(__preview_image_buffer_created_cb, ad) == -1) {
-		_E("Failed to init camera");
+	if (__device_interfaces_init(ad)) {
+		free(shared_data_path);
 		goto ERROR;
 	}
 
-	if (resource_camera_start_preview() == -1) {
-		_E("Failed to start camera preview");
-		goto ERROR;
+	for (i = 0; i < CAMERA_COUNT; i++) {
+		if (__pipeline_init(ad, ad->pipeline_count, shared_data_path) == 0) {
+			ad->pipeline_count++;
+			continue;
+		}
+
+		/* Without the servo camera there is nothing to follow, other cameras are optional */
+		if (i == SERVO_CAMERA_INDEX) {
+			free(shared_data_path);
+			goto ERROR;
+		}
+		_W("camera%d is not available, running with %d camera(s)", i, ad->pipeline_count);
+		break;
 	}
+	free(shared_data_path);
 
 #ifdef ENABLE_SMARTTHINGS
 	/* smartthings APIs should be called after camera start preview, they can't wait to start camera */
@@ -519,13 +1451,26 @@ static bool service_app_create(void *data)
 	servo_h_state_set(ad->current_servo_x, APP_CALLBACK_KEY);
 	servo_v_state_set(ad->current_servo_y, APP_CALLBACK_KEY);
 
+	ad->stats_timer = ecore_timer_add(PIPELINE_STATS_INTERVAL_SEC, __pipeline_stats_timer_cb, ad);
+
+	/* The pipelines just read the profile */
+	ad->profile_modified_time = __get_camera_profile_modified_time();
+	ad->profile_reload_timer = ecore_timer_add(PROFILE_RELOAD_INTERVAL_SEC, __profile_reload_timer_cb, ad);
+	ad->heatmap_timer = ecore_timer_add(HEATMAP_SNAPSHOT_INTERVAL_SEC, __heatmap_timer_cb, ad);
+
 	return true;
 
 ERROR:
 	__device_interfaces_fini();
 
-	resource_camera_close();
-	controller_mv_unset_movement_detection_event_cb();
+	for (i = 0; i < ad->pipeline_count; i++)
+		__pipeline_fini(&ad->pipelines[i]);
+	ad->pipeline_count = 0;
+
+	frame_trace_fini();
+	g_free(ad->frame_trace_report_path);
+	ad->frame_trace_report_path = NULL;
+
 	controller_image_finalize();
 
 #ifdef ENABLE_SMARTTHINGS
@@ -533,34 +1478,40 @@ ERROR:
 	st_thing_resource_fini();
 #endif /* ENABLE_SMARTTHINGS */
 
-	pthread_mutex_destroy(&ad->mutex);
-
 	return false;
 }
 
 static void service_app_terminate(void *data)
 {
 	app_data *ad = (app_data *)data;
-	Ecore_Thread *thread_id = NULL;
-	unsigned char *buffer = NULL;
-	char *info = NULL;
-	gchar *temp_image_filename;
-	gchar *latest_image_filename;
+	int i = 0;
 	_D("App Terminated - enter");
 
-	resource_camera_close();
-	controller_mv_unset_movement_detection_event_cb();
+	if (ad->stats_timer) {
+		ecore_timer_del(ad->stats_timer);
+		ad->stats_timer = NULL;
+	}
 
-	pthread_mutex_lock(&ad->mutex);
-	thread_id = ad->image_writter_thread;
-	ad->image_writter_thread = NULL;
-	pthread_mutex_unlock(&ad->mutex);
+	if (ad->profile_reload_timer) {
+		ecore_timer_del(ad->profile_reload_timer);
+		ad->profile_reload_timer = NULL;
+	}
 
-	if (thread_id)
-		ecore_thread_wait(thread_id, 3.0); // wait for 3 second
+	if (ad->heatmap_timer) {
+		ecore_timer_del(ad->heatmap_timer);
+		ad->heatmap_timer = NULL;
+	}
+
+	for (i = 0; i < ad->pipeline_count; i++)
+		__pipeline_fini(&ad->pipelines[i]);
+	ad->pipeline_count = 0;
 
 	__device_interfaces_fini();
 
+	frame_trace_fini();
+	g_free(ad->frame_trace_report_path);
+	ad->frame_trace_report_path = NULL;
+
 	controller_image_finalize();
 
 #ifdef ENABLE_SMARTTHINGS
@@ -568,22 +1519,6 @@ static void service_app_terminate(void *data)
 	st_thing_resource_fini();
 #endif /* ENABLE_SMARTTHINGS */
 
-	pthread_mutex_lock(&ad->mutex);
-	buffer = ad->latest_image_buffer;
-	ad->latest_image_buffer = NULL;
-	info  = ad->latest_image_info;
-	ad->latest_image_info = NULL;
-	temp_image_filename = ad->temp_image_filename;
-	ad->temp_image_filename = NULL;
-	latest_image_filename = ad->latest_image_filename;
-	ad->latest_image_filename = NULL;
-	pthread_mutex_unlock(&ad->mutex);
-	free(buffer);
-	free(info);
-	g_free(temp_image_filename);
-	g_free(latest_image_filename);
-
-	pthread_mutex_destroy(&ad->mutex);
 	free(ad);
 	_D("App Terminated - leave");
 }
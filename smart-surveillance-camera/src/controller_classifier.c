@@ -0,0 +1,356 @@
+ /*
+ * Copyright (c) 2018 Samsung Electronics Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <glib.h>
+#include "log.h"
+#include "controller.h"
+#include "controller_classifier.h"
+#include "controller_classifier_engine.h"
+#include "frame_pyramid.h"
+
+#define CLASSIFIER_BATCH_MAX 4 // crops per frame, the largest regions go first
+#define CLASSIFIER_REFRESH_MS 500 // a track verdict younger than this is trusted
+#define CLASSIFIER_MARGIN 10 // percent of the region size added on every side
+#define CLASSIFIER_GATE_MIN 10.0f // percent, plus half the size of the track, as the tracker gate
+
+typedef struct {
+	unsigned int id;
+	float x; // centre
+	float y;
+	float width;
+	float height;
+	int verdict;
+	long long int classified_ms;
+} classifier_track_s;
+
+struct __classifier_data {
+	const controller_classifier_engine_s *engine;
+	void *engine_data;
+
+	pthread_mutex_t mutex;
+	classifier_track_s tracks[MV_TRACK_MAX]; // to mutex
+	int track_count; // to mutex
+	unsigned int classified; // to mutex
+	unsigned int skipped; // to mutex
+
+	/* Analysis worker scratch */
+	unsigned char *crop_data[CLASSIFIER_BATCH_MAX];
+	controller_classifier_crop_s crops[CLASSIFIER_BATCH_MAX];
+	int batch[CLASSIFIER_BATCH_MAX]; // region of every crop
+	int batch_verdicts[CLASSIFIER_BATCH_MAX];
+	unsigned int track_ids[MV_RESULT_COUNT_MAX]; // matched track of every region, 0 for none
+};
+
+static const controller_classifier_engine_s *__get_engine(controller_classifier_engine_e engine)
+{
+	switch (engine) {
+	case CONTROLLER_CLASSIFIER_ENGINE_FACE:
+#ifndef CONTROLLER_MV_NO_MEDIA_VISION
+		return &controller_classifier_engine_face;
+#else
+		_E("media vision is not built in");
+		return NULL;
+#endif
+	case CONTROLLER_CLASSIFIER_ENGINE_SHAPE:
+		return &controller_classifier_engine_shape;
+	default:
+		_E("unknown classifier : %d", engine);
+		return NULL;
+	}
+}
+
+int controller_classifier_engine_from_name(const char *name, controller_classifier_engine_e *engine)
+{
+	retv_if(!name, -1);
+	retv_if(!engine, -1);
+
+	if (!strcmp(name, "none"))
+		*engine = CONTROLLER_CLASSIFIER_ENGINE_NONE;
+	else if (!strcmp(name, "face"))
+		*engine = CONTROLLER_CLASSIFIER_ENGINE_FACE;
+	else if (!strcmp(name, "shape"))
+		*engine = CONTROLLER_CLASSIFIER_ENGINE_SHAPE;
+	else
+		return -1;
+
+	return 0;
+}
+
+const char *controller_classifier_get_engine_name(controller_classifier_h classifier)
+{
+	retv_if(!classifier, "none");
+
+	return classifier->engine->name;
+}
+
+/* Nearest published track whose gate holds the centre of the region, to mutex */
+static const classifier_track_s *__find_track(controller_classifier_h classifier, float x, float y)
+{
+	const classifier_track_s *nearest = NULL;
+	float nearest_cost = 0.0f;
+	int i = 0;
+
+	for (i = 0; i < classifier->track_count; i++) {
+		const classifier_track_s *track = &classifier->tracks[i];
+		float gate = CLASSIFIER_GATE_MIN + MAX(track->width, track->height) / 2;
+		float dx = x - track->x;
+		float dy = y - track->y;
+		float cost = dx * dx + dy * dy;
+
+		if (cost > gate * gate)
+			continue;
+
+		if (!nearest || cost < nearest_cost) {
+			nearest = track;
+			nearest_cost = cost;
+		}
+	}
+
+	return nearest;
+}
+
+/* Y plane of the frame around the region with its margin, read from the pyramid level the crop step allows */
+static int __crop(controller_classifier_h classifier, int slot, const image_buffer_data_s *image_buffer, const int *region)
+{
+	controller_classifier_crop_s *crop = &classifier->crops[slot];
+	unsigned char *data = classifier->crop_data[slot];
+	const unsigned char *luma = NULL;
+	unsigned int luma_width = 0;
+	unsigned int luma_height = 0;
+	int frame_width = image_buffer->image_width;
+	int frame_height = image_buffer->image_height;
+	int x = 0;
+	int y = 0;
+	int width = 0;
+	int height = 0;
+	int margin_x = 0;
+	int margin_y = 0;
+	int step = 0;
+	int level = 0;
+	unsigned int column = 0;
+	unsigned int row = 0;
+
+	x = region[0] * frame_width / 99;
+	y = region[1] * frame_height / 99;
+	width = region[2] * frame_width / 99;
+	height = region[3] * frame_height / 99;
+
+	margin_x = width * CLASSIFIER_MARGIN / 100;
+	margin_y = height * CLASSIFIER_MARGIN / 100;
+	x = MAX(0, x - margin_x);
+	y = MAX(0, y - margin_y);
+	width = MIN(frame_width - x, width + 2 * margin_x);
+	height = MIN(frame_height - y, height + 2 * margin_y);
+	if (width <= 0 || height <= 0)
+		return -1;
+
+	step = (MAX(width, height) + CLASSIFIER_CROP_MAX - 1) / CLASSIFIER_CROP_MAX;
+	crop->width = width / step;
+	crop->height = height / step;
+	crop->data = data;
+	if (crop->width == 0 || crop->height == 0)
+		return -1;
+
+	/* Box filtered pixels instead of skipped ones, the motion analysis has usually built the level already */
+	while (level < FRAME_PYRAMID_LEVEL_MAX && step >= (2 << level))
+		level++;
+
+	luma = frame_pyramid_get_level(image_buffer, level, &luma_width, &luma_height);
+	if (!luma || luma_width == 0 || luma_height == 0)
+		return -1;
+
+	for (row = 0; row < crop->height; row++) {
+		const unsigned char *line = luma + MIN((unsigned int)(y + row * step) >> level, luma_height - 1) * luma_width;
+
+		for (column = 0; column < crop->width; column++)
+			*data++ = line[MIN((unsigned int)(x + column * step) >> level, luma_width - 1)];
+	}
+
+	return 0;
+}
+
+void controller_classifier_classify(controller_classifier_h classifier, const image_buffer_data_s *image_buffer,
+	const int result[], int result_count, long long int now_ms, int verdicts[])
+{
+	int candidates[MV_RESULT_COUNT_MAX];
+	int candidate_count = 0;
+	unsigned int skipped = 0;
+	int batch_count = 0;
+	int i = 0;
+	int j = 0;
+
+	ret_if(!verdicts);
+
+	result_count = MIN(result_count, MV_RESULT_COUNT_MAX);
+	for (i = 0; i < result_count; i++)
+		verdicts[i] = CONTROLLER_CLASSIFIER_VERDICT_NONE;
+
+	ret_if(!classifier);
+	ret_if(!image_buffer || !image_buffer->buffer);
+	ret_if(result_count > 0 && !result);
+
+	/* Regions of tracks with a fresh verdict are left out */
+	pthread_mutex_lock(&classifier->mutex);
+	for (i = 0; i < result_count; i++) {
+		const int *region = &result[i * 4];
+		const classifier_track_s *track = __find_track(classifier,
+			region[0] + region[2] / 2.0f, region[1] + region[3] / 2.0f);
+
+		classifier->track_ids[i] = track ? track->id : 0;
+		if (track && track->verdict != CONTROLLER_CLASSIFIER_VERDICT_NONE
+				&& now_ms - track->classified_ms < CLASSIFIER_REFRESH_MS) {
+			skipped++;
+			continue;
+		}
+
+		candidates[candidate_count++] = i;
+	}
+	classifier->skipped += skipped;
+	pthread_mutex_unlock(&classifier->mutex);
+
+	/* The largest of the others are batched, a person is rarely the smallest blob */
+	for (i = 0; i < candidate_count && batch_count < CLASSIFIER_BATCH_MAX; i++) {
+		int largest = i;
+		int swap = 0;
+
+		for (j = i + 1; j < candidate_count; j++) {
+			const int *region = &result[candidates[j] * 4];
+			const int *best = &result[candidates[largest] * 4];
+
+			if (region[2] * region[3] > best[2] * best[3])
+				largest = j;
+		}
+		swap = candidates[i];
+		candidates[i] = candidates[largest];
+		candidates[largest] = swap;
+
+		if (__crop(classifier, batch_count, image_buffer, &result[candidates[i] * 4]))
+			continue;
+		classifier->batch[batch_count++] = candidates[i];
+	}
+
+	if (batch_count == 0)
+		return;
+
+	if (classifier->engine->classify(classifier->engine_data, classifier->crops, batch_count, classifier->batch_verdicts)) {
+		_E("%s classifier failed", classifier->engine->name);
+		return;
+	}
+
+	/* Taken into the published tracks at once, the next frame may come before the main loop publishes again */
+	pthread_mutex_lock(&classifier->mutex);
+	for (i = 0; i < batch_count; i++) {
+		int region = classifier->batch[i];
+
+		verdicts[region] = classifier->batch_verdicts[i];
+		for (j = 0; j < classifier->track_count; j++) {
+			if (!classifier->track_ids[region] || classifier->tracks[j].id != classifier->track_ids[region])
+				continue;
+			classifier->tracks[j].verdict = verdicts[region];
+			classifier->tracks[j].classified_ms = now_ms;
+		}
+	}
+	classifier->classified += batch_count;
+	pthread_mutex_unlock(&classifier->mutex);
+}
+
+void controller_classifier_publish_tracks(controller_classifier_h classifier,
+	const controller_tracker_track_s *tracks, int track_count)
+{
+	int i = 0;
+
+	ret_if(!classifier);
+	ret_if(track_count > 0 && !tracks);
+
+	pthread_mutex_lock(&classifier->mutex);
+	classifier->track_count = MIN(track_count, MV_TRACK_MAX);
+	for (i = 0; i < classifier->track_count; i++) {
+		classifier->tracks[i].id = tracks[i].id;
+		classifier->tracks[i].x = tracks[i].x;
+		classifier->tracks[i].y = tracks[i].y;
+		classifier->tracks[i].width = tracks[i].width;
+		classifier->tracks[i].height = tracks[i].height;
+		classifier->tracks[i].verdict = tracks[i].verdict;
+		classifier->tracks[i].classified_ms = tracks[i].classified_ms;
+	}
+	pthread_mutex_unlock(&classifier->mutex);
+}
+
+void controller_classifier_get_stats(controller_classifier_h classifier, unsigned int *classified, unsigned int *skipped)
+{
+	ret_if(!classifier);
+	ret_if(!classified || !skipped);
+
+	pthread_mutex_lock(&classifier->mutex);
+	*classified = classifier->classified;
+	*skipped = classifier->skipped;
+	classifier->classified = 0;
+	classifier->skipped = 0;
+	pthread_mutex_unlock(&classifier->mutex);
+}
+
+controller_classifier_h controller_classifier_create(controller_classifier_engine_e engine)
+{
+	struct __classifier_data *classifier = NULL;
+	int i = 0;
+
+	if (engine == CONTROLLER_CLASSIFIER_ENGINE_NONE)
+		return NULL;
+
+	classifier = calloc(1, sizeof(struct __classifier_data));
+	retvm_if(!classifier, NULL, "failed to allocate classifier");
+	pthread_mutex_init(&classifier->mutex, NULL);
+
+	classifier->engine = __get_engine(engine);
+	goto_if(!classifier->engine, ERROR);
+
+	for (i = 0; i < CLASSIFIER_BATCH_MAX; i++) {
+		classifier->crop_data[i] = malloc(CLASSIFIER_CROP_MAX * CLASSIFIER_CROP_MAX);
+		goto_if(!classifier->crop_data[i], ERROR);
+	}
+
+	classifier->engine_data = classifier->engine->create();
+	if (!classifier->engine_data) {
+		_E("failed to create %s classifier", classifier->engine->name);
+		goto ERROR;
+	}
+
+	return classifier;
+
+ERROR:
+	for (i = 0; i < CLASSIFIER_BATCH_MAX; i++)
+		free(classifier->crop_data[i]);
+	pthread_mutex_destroy(&classifier->mutex);
+	free(classifier);
+
+	return NULL;
+}
+
+void controller_classifier_destroy(controller_classifier_h classifier)
+{
+	int i = 0;
+
+	if (!classifier)
+		return;
+
+	classifier->engine->destroy(classifier->engine_data);
+	for (i = 0; i < CLASSIFIER_BATCH_MAX; i++)
+		free(classifier->crop_data[i]);
+	pthread_mutex_destroy(&classifier->mutex);
+	free(classifier);
+}
@@ -0,0 +1,115 @@
+ /*
+ * Copyright (c) 2018 Samsung Electronics Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <stdlib.h>
+#include "log.h"
+#include "controller.h"
+#include "controller_classifier.h"
+#include "controller_classifier_engine.h"
+
+#ifndef CONTROLLER_MV_NO_MEDIA_VISION
+
+#include <mv_common.h>
+#include <mv_face.h>
+
+/*
+ * mv_face_detect on every crop, a region with a face in it is a person.
+ * Only people turned towards the camera pass, a back stays unconfirmed until the person turns.
+ */
+
+struct __classifier_face_s {
+	mv_source_h source; // refilled for every crop
+};
+
+static void __face_detected_cb(mv_source_h source, mv_engine_config_h engine_cfg,
+	mv_rectangle_s *faces_locations, int number_of_faces, void *user_data)
+{
+	int *faces = user_data;
+
+	*faces = number_of_faces;
+}
+
+static int __face_classify(void *data, const controller_classifier_crop_s *crops, unsigned int count, int verdicts[])
+{
+	struct __classifier_face_s *engine = data;
+	unsigned int i = 0;
+	int faces = 0;
+	int ret = 0;
+
+	retv_if(!engine, -1);
+	retv_if(!crops || !verdicts, -1);
+
+	for (i = 0; i < count; i++) {
+		verdicts[i] = CONTROLLER_CLASSIFIER_VERDICT_NONE;
+
+		mv_source_clear(engine->source);
+		ret = mv_source_fill_by_buffer(engine->source, (unsigned char *)crops[i].data, crops[i].width * crops[i].height,
+				crops[i].width, crops[i].height, MEDIA_VISION_COLORSPACE_Y800);
+		if (ret) {
+			_E("failed to fill source - %d", ret);
+			continue;
+		}
+
+		/* Default engine config, the callback runs inside the call */
+		faces = 0;
+		ret = mv_face_detect(engine->source, NULL, __face_detected_cb, &faces);
+		if (ret) {
+			_E("failed to mv_face_detect - %d", ret);
+			continue;
+		}
+
+		verdicts[i] = faces > 0 ? CONTROLLER_CLASSIFIER_VERDICT_PERSON : CONTROLLER_CLASSIFIER_VERDICT_OTHER;
+	}
+
+	return 0;
+}
+
+static void *__face_create(void)
+{
+	struct __classifier_face_s *engine = NULL;
+	int ret = 0;
+
+	engine = calloc(1, sizeof(struct __classifier_face_s));
+	retvm_if(!engine, NULL, "failed to allocate face classifier");
+
+	ret = mv_create_source(&engine->source);
+	if (ret) {
+		_E("failed to mv_create_source - %d", ret);
+		free(engine);
+		return NULL;
+	}
+
+	return engine;
+}
+
+static void __face_destroy(void *data)
+{
+	struct __classifier_face_s *engine = data;
+
+	if (!engine)
+		return;
+
+	mv_destroy_source(engine->source);
+	free(engine);
+}
+
+const controller_classifier_engine_s controller_classifier_engine_face = {
+	.name = "face",
+	.create = __face_create,
+	.classify = __face_classify,
+	.destroy = __face_destroy,
+};
+
+#endif /* !CONTROLLER_MV_NO_MEDIA_VISION */
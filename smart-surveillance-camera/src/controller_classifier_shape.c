@@ -0,0 +1,117 @@
+ /*
+ * Copyright (c) 2018 Samsung Electronics Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <stdlib.h>
+#include "log.h"
+#include "controller_classifier.h"
+#include "controller_classifier_engine.h"
+
+/*
+ * CPU stand-in for a person detector, for the synthetic backend and hosts without media vision.
+ * An upright region whose edges run mostly up and down passes, a person standing or walking is taller
+ * than wide and its limbs and torso make vertical edges. Leaves and shadows are wider or edged all ways.
+ */
+
+#define SHAPE_ASPECT_MIN 1.2f // height / width of the crop, margin included
+#define SHAPE_ASPECT_MAX 4.0f
+#define SHAPE_EDGE_MIN 4 // mean gradient, a flat or blurred crop shows nothing
+#define SHAPE_VERTICAL_EDGE_SHARE 55 // percent of the gradient across the rows
+
+struct __classifier_shape_s {
+	unsigned int crops;
+	unsigned int persons;
+};
+
+static int __shape_classify_crop(const controller_classifier_crop_s *crop)
+{
+	unsigned long long int across = 0; // |d/dx|, edges running up and down
+	unsigned long long int along = 0; // |d/dy|
+	unsigned int pixels = 0;
+	unsigned int x = 0;
+	unsigned int y = 0;
+	float aspect = 0.0f;
+
+	if (crop->width < 3 || crop->height < 3)
+		return CONTROLLER_CLASSIFIER_VERDICT_OTHER;
+
+	aspect = (float)crop->height / crop->width;
+	if (aspect < SHAPE_ASPECT_MIN || aspect > SHAPE_ASPECT_MAX)
+		return CONTROLLER_CLASSIFIER_VERDICT_OTHER;
+
+	for (y = 1; y < crop->height; y++) {
+		const unsigned char *row = crop->data + y * crop->width;
+		const unsigned char *above = row - crop->width;
+
+		for (x = 1; x < crop->width; x++) {
+			across += abs(row[x] - row[x - 1]);
+			along += abs(row[x] - above[x]);
+		}
+	}
+	pixels = (crop->width - 1) * (crop->height - 1);
+
+	if ((across + along) / pixels < SHAPE_EDGE_MIN)
+		return CONTROLLER_CLASSIFIER_VERDICT_OTHER;
+
+	if (across * 100 < (across + along) * SHAPE_VERTICAL_EDGE_SHARE)
+		return CONTROLLER_CLASSIFIER_VERDICT_OTHER;
+
+	return CONTROLLER_CLASSIFIER_VERDICT_PERSON;
+}
+
+static int __shape_classify(void *data, const controller_classifier_crop_s *crops, unsigned int count, int verdicts[])
+{
+	struct __classifier_shape_s *engine = data;
+	unsigned int i = 0;
+
+	retv_if(!engine, -1);
+	retv_if(!crops || !verdicts, -1);
+
+	for (i = 0; i < count; i++) {
+		verdicts[i] = __shape_classify_crop(&crops[i]);
+		if (verdicts[i] == CONTROLLER_CLASSIFIER_VERDICT_PERSON)
+			engine->persons++;
+	}
+	engine->crops += count;
+
+	return 0;
+}
+
+static void *__shape_create(void)
+{
+	struct __classifier_shape_s *engine = NULL;
+
+	engine = calloc(1, sizeof(struct __classifier_shape_s));
+	retvm_if(!engine, NULL, "failed to allocate shape classifier");
+
+	return engine;
+}
+
+static void __shape_destroy(void *data)
+{
+	struct __classifier_shape_s *engine = data;
+
+	if (!engine)
+		return;
+
+	_D("shape classifier - %u of %u crops upright", engine->persons, engine->crops);
+	free(engine);
+}
+
+const controller_classifier_engine_s controller_classifier_engine_shape = {
+	.name = "shape",
+	.create = __shape_create,
+	.classify = __shape_classify,
+	.destroy = __shape_destroy,
+};
@@ -18,14 +18,48 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <tizen.h>
+#include <pthread.h>
 #include <image_util.h>
 #include "log.h"
 #include "exif.h"
+#include "image_kernel.h"
 
 static image_util_encode_h encode_h = NULL;
 static image_util_decode_h decode_h = NULL;
 
-#define IMAGE_COLORSPACE IMAGE_UTIL_COLORSPACE_I420
+/* Writer threads of all cameras share the encoder and the conversion buffer */
+static pthread_mutex_t encode_mutex = PTHREAD_MUTEX_INITIALIZER;
+static unsigned char *i420_buffer = NULL;
+static unsigned int i420_buffer_size = 0;
+
+static int __convert_colorspace_from_cam_to_image_util(camera_pixel_format_e format, image_util_colorspace_e *colorspace)
+{
+	switch (format) {
+	case CAMERA_PIXEL_FORMAT_RGB565:
+		*colorspace = IMAGE_UTIL_COLORSPACE_RGB565;
+		break;
+	case CAMERA_PIXEL_FORMAT_RGB888:
+		*colorspace = IMAGE_UTIL_COLORSPACE_RGB888;
+		break;
+	case CAMERA_PIXEL_FORMAT_RGBA:
+		*colorspace = IMAGE_UTIL_COLORSPACE_RGBA8888;
+		break;
+	case CAMERA_PIXEL_FORMAT_ARGB:
+		*colorspace = IMAGE_UTIL_COLORSPACE_ARGB8888;
+		break;
+	case CAMERA_PIXEL_FORMAT_NV16:
+		*colorspace = IMAGE_UTIL_COLORSPACE_NV16;
+		break;
+	case CAMERA_PIXEL_FORMAT_422P:
+		*colorspace = IMAGE_UTIL_COLORSPACE_YUV422;
+		break;
+	default:
+		_E("unsupported format : %d", format);
+		return -1;
+	}
+
+	return 0;
+}
 
 void controller_image_initialize(void)
 {
@@ -38,6 +72,8 @@ void controller_image_initialize(void)
 	if (error_code != IMAGE_UTIL_ERROR_NONE) {
 		_E("image_util_decode_create [%s]", get_error_message(error_code));
 	}
+
+	_I("image kernels [%s]", image_kernel_get_backend());
 }
 
 void controller_image_finalize(void)
@@ -51,11 +87,17 @@ void controller_image_finalize(void)
     if (error_code != IMAGE_UTIL_ERROR_NONE) {
         _E("image_util_decode_destroy [%s]", get_error_message(error_code));
     }
+
+	pthread_mutex_lock(&encode_mutex);
+	free(i420_buffer);
+	i420_buffer = NULL;
+	i420_buffer_size = 0;
+	pthread_mutex_unlock(&encode_mutex);
 }
 
-int controller_image_save_image_file(const char *path,
-	unsigned int width, unsigned int height, const unsigned char *buffer,
-	const char *comment, unsigned int comment_len)
+static int __encode_image_file(const char *path,
+	unsigned int width, unsigned int height, image_util_colorspace_e colorspace, const unsigned char *buffer,
+	const char *comment, unsigned int comment_len, long long int capture_time_ms)
 {
 	unsigned char *encoded = NULL;
 	unsigned long long size = 0;
@@ -66,7 +108,7 @@ int controller_image_save_image_file(const char *path,
 		return -1;
 	}
 
-	error_code = image_util_encode_set_colorspace(encode_h, IMAGE_COLORSPACE);
+	error_code = image_util_encode_set_colorspace(encode_h, colorspace);
 	if (error_code != IMAGE_UTIL_ERROR_NONE) {
 		_E("image_util_encode_set_colorspace [%s]", get_error_message(error_code));
 		return -1;
@@ -97,13 +139,50 @@ int controller_image_save_image_file(const char *path,
 	}
 
 	error_code = exif_write_jpg_file_with_comment(path,
-			encoded, (unsigned int)size, width, height, comment, comment_len);
+			encoded, (unsigned int)size, width, height, comment, comment_len, capture_time_ms);
 
 	free(encoded);
 
 	return error_code;
 }
 
+int controller_image_save_image_file(const char *path,
+	unsigned int width, unsigned int height, camera_pixel_format_e format, const unsigned char *buffer,
+	const char *comment, unsigned int comment_len, long long int capture_time_ms)
+{
+	unsigned int i420_size = width * height * 3 / 2;
+	image_util_colorspace_e colorspace = IMAGE_UTIL_COLORSPACE_I420;
+	int ret = 0;
+
+	retv_if(!buffer, -1);
+
+	pthread_mutex_lock(&encode_mutex);
+
+	if (format != CAMERA_PIXEL_FORMAT_I420) {
+		if (i420_buffer_size < i420_size) {
+			free(i420_buffer);
+			i420_buffer = malloc(i420_size);
+			i420_buffer_size = i420_buffer ? i420_size : 0;
+		}
+
+		if (i420_buffer && image_kernel_convert_to_i420(format, buffer, width, height, i420_buffer) == 0) {
+			buffer = i420_buffer;
+		} else {
+			/* No kernel for it, let the encoder convert */
+			if (__convert_colorspace_from_cam_to_image_util(format, &colorspace)) {
+				pthread_mutex_unlock(&encode_mutex);
+				return -1;
+			}
+		}
+	}
+
+	ret = __encode_image_file(path, width, height, colorspace, buffer, comment, comment_len, capture_time_ms);
+
+	pthread_mutex_unlock(&encode_mutex);
+
+	return ret;
+}
+
 int controller_image_read_image_file(const char *path,
 	unsigned long *width, unsigned long *height, unsigned char *buffer, unsigned long long *size)
 {
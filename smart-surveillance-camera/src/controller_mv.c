@@ -16,243 +16,780 @@
 
 #include <glib.h>
 #include <stdlib.h>
-#include <mv_common.h>
-#include <mv_surveillance.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
 #include "controller.h"
 #include "controller_mv.h"
+#include "controller_mv_engine.h"
+#include "controller_mv_noise.h"
+#include "controller_mv_ego_motion.h"
+#include "controller_mv_merge.h"
+#include "controller_mv_activity.h"
+#include "controller_mv_illumination.h"
+#include "controller_mv_heatmap.h"
+#include "frame_pyramid.h"
 #include "log.h"
 
-#define VIDEO_STREAM_ID 0
-#define THRESHOLD_SIZE_REGION 100
+#define THRESHOLD_SIZE_REGION 100 // in a frame of THRESHOLD_SIZE_REGION_FRAME_AREA, scaled with the frame area
+#define THRESHOLD_SIZE_REGION_FRAME_AREA (320 * 240)
+
+#define MV_MASK_COVERAGE_MIN 50 // percent of a region that has to be analysed, the rest is masked
+#define MV_THRESHOLD_DRIFT_MAX 4 // a new noise estimate further off than this rebuilds the engine threshold
+#define MV_TURN_WINDOW_MS 600 // a servo move has settled by then, the view is taken as still again
+#define MV_TURN_SEARCH_MARGIN 5 // percent the view may shift beyond what the servo move was meant for
+#define MV_ILLUMINATION_HOLD_MS 1500 // events after a brightness jump are of the light, auto exposure settles by then
 
 struct __mv_data {
-	mv_surveillance_event_trigger_h mv_trigger_handle;
+	int video_stream_id;
+	unsigned int frame_width; // of the source being pushed
+	unsigned int frame_height;
+	unsigned int decimation; // 1, 2 or 4, the engine sees frame_width / decimation
+
+	/* Analysis luma comes from the pyramid of the frame, other stages reuse its levels */
+	camera_pixel_format_e unsupported_format; // logged once
+	controller_mv_mask_h mask; // rasterized for the luma size of the last push
+
+	/* Unmasked regions of an event, merged in place */
+	controller_mv_merge_h merge;
+	controller_mv_region_s *regions; // MV_REGION_MAX
+	int merge_gap; // percent of the frame width, negative for none
+	unsigned int merge_iou; // percent, 0 for none
+
+	/* Detection threshold, measured from the noise of the analysed luma unless the profile fixes it */
+	controller_mv_noise_h noise; // NULL for a fixed threshold
+	unsigned int threshold;
+	int threshold_measured;
+
+	/* Where the still view moves over hours, regions of a turning view are left out */
+	controller_mv_heatmap_h heatmap;
+
+	/* Events are held while the scene settles from a brightness jump */
+	controller_mv_illumination_h illumination;
+	long long int push_us; // of the frame being pushed
+	long long int relit_until_us;
+
+	/* Frames too still for the engine are left out, one per MV_ACTIVITY_KEEP_ALIVE_MS still goes through */
+	controller_mv_activity_h activity;
+	unsigned int activity_floor; // changed grid samples a frame needs, 0 sends every frame
+	long long int analysed_us; // of the last frame the engine saw
+	int engine_moving; // the engine found regions in the last frame it saw
+	unsigned int analysed_frames; // to request_mutex, since the last controller_mv_get_activity_stats()
+	unsigned int skipped_frames; // to request_mutex
+
+	/* The view followed while the camera turns, instead of relearning the scene */
+	controller_mv_ego_motion_h ego_motion;
+	long long int turn_until_us; // 0 while the camera stands still, -1 until the next push starts the window
+	float turn_remaining_x; // percent the view is still meant to shift
+	float turn_remaining_y;
+	float view_shift_x; // measured by the last push, percent
+	float view_shift_y;
+	int view_lost; // the last push could not follow a turn, the engine relearns the scene
+
+	/* Asked for from other threads, taken at the start of the next push so pushing never waits for them */
+	pthread_mutex_t request_mutex;
+	int mask_requested; // to request_mutex
+	controller_mv_mask_h requested_mask; // to request_mutex
+	int reset_requested; // to request_mutex
+	int turn_requested; // to request_mutex
+	float requested_turn_x; // to request_mutex
+	float requested_turn_y; // to request_mutex
+
+	const controller_mv_engine_s *engine;
+	void *engine_data;
 	movement_detected_cb movement_detected_cb;
 	void *movement_detected_cb_data;
 };
 
-static struct __mv_data *mv_data = NULL;
-
-static const char *__mv_err_to_str(mv_error_e err)
+static const controller_mv_engine_s *__get_engine(controller_mv_engine_e engine)
 {
-	const char *err_str;
-	switch (err) {
-	case MEDIA_VISION_ERROR_NONE:
-		err_str = "MEDIA_VISION_ERROR_NONE";
-		break;
-	case MEDIA_VISION_ERROR_NOT_SUPPORTED:
-		err_str = "MEDIA_VISION_ERROR_NOT_SUPPORTED";
-		break;
-	case MEDIA_VISION_ERROR_MSG_TOO_LONG:
-		err_str = "MEDIA_VISION_ERROR_MSG_TOO_LONG";
-		break;
-	case MEDIA_VISION_ERROR_NO_DATA:
-		err_str = "MEDIA_VISION_ERROR_NO_DATA";
-		break;
-	case MEDIA_VISION_ERROR_KEY_NOT_AVAILABLE:
-		err_str = "MEDIA_VISION_ERROR_KEY_NOT_AVAILABLE";
-		break;
-	case MEDIA_VISION_ERROR_OUT_OF_MEMORY:
-		err_str = "MEDIA_VISION_ERROR_OUT_OF_MEMORY";
-		break;
-	case MEDIA_VISION_ERROR_INVALID_PARAMETER:
-		err_str = "MEDIA_VISION_ERROR_INVALID_PARAMETER";
-		break;
-	case MEDIA_VISION_ERROR_INVALID_OPERATION:
-		err_str = "MEDIA_VISION_ERROR_INVALID_OPERATION";
-		break;
-	case MEDIA_VISION_ERROR_PERMISSION_DENIED:
-		err_str = "MEDIA_VISION_ERROR_PERMISSION_DENIED";
-		break;
-	case MEDIA_VISION_ERROR_NOT_SUPPORTED_FORMAT:
-		err_str = "MEDIA_VISION_ERROR_NOT_SUPPORTED_FORMAT";
-		break;
-	case MEDIA_VISION_ERROR_INTERNAL:
-		err_str = "MEDIA_VISION_ERROR_INTERNAL";
-		break;
-	case MEDIA_VISION_ERROR_INVALID_DATA:
-		err_str = "MEDIA_VISION_ERROR_INVALID_DATA";
-		break;
-	case MEDIA_VISION_ERROR_INVALID_PATH:
-		err_str = "MEDIA_VISION_ERROR_INVALID_PATH";
-		break;
+	switch (engine) {
+	case CONTROLLER_MV_ENGINE_MEDIA_VISION:
+#ifndef CONTROLLER_MV_NO_MEDIA_VISION
+		return &controller_mv_engine_media_vision;
+#else
+		_E("media vision is not built in");
+		return NULL;
+#endif
+	case CONTROLLER_MV_ENGINE_MOTION:
+		return &controller_mv_engine_motion;
 	default:
-		err_str = "Unknown Error";
-		break;
+		_E("unknown engine : %d", engine);
+		return NULL;
 	}
+}
+
+/* Y plane of the frame at 1 / decimation */
+static int __prepare_luma(struct __mv_data *mv_data, const image_buffer_data_s *image_buffer, controller_mv_luma_s *luma)
+{
+	unsigned int level = 0;
 
-	return err_str;
+	while ((1U << level) < mv_data->decimation)
+		level++;
+
+	luma->data = frame_pyramid_get_level(image_buffer, level, &luma->width, &luma->height);
+	if (!luma->data) {
+		if (image_buffer->format != mv_data->unsupported_format)
+			_E("no luma in frames of format %d", image_buffer->format);
+		mv_data->unsupported_format = image_buffer->format;
+		return -1;
+	}
+
+	return 0;
 }
 
-static void __movement_detected_event_cb(mv_surveillance_event_trigger_h trigger, mv_source_h source, int video_stream_id, mv_surveillance_result_h event_result, void *data)
+/*
+ * The regions of an event: mask filter, merging of the pieces of one object, scaling back to frame pixels,
+ * size filter, the 0 ~ 99 result list and the area weighted offset.
+ * Nothing is allocated, the regions are copied to the scratch of mv_data once.
+ */
+static void __movement_detected_event_cb(const controller_mv_region_s *luma_regions, unsigned int move_regions_num, void *data)
 {
-	int ret = 0;
+	struct __mv_data *mv_data = data;
 	int horizontal = 0;
 	int vertical = 0;
 	int result[MV_RESULT_LENGTH_MAX] = {0, };
 	int result_count = 0;
-	int result_index = 0;
-	int valid_area_sum = 0;
+	int unmasked_count = 0;
+	long long int valid_area_sum = 0;
+	long long int x_moment = 0;
+	long long int y_moment = 0;
+	int threshold_size_region = 0;
+	int decimation = 0;
+	int width = 0;
+	int height = 0;
+	int merge_gap = 0;
 	int i;
-	size_t move_regions_num = 0;
-	mv_rectangle_s *regions = NULL;
 
-	ret_if(!trigger);
-	ret_if(!event_result);
+	ret_if(!luma_regions);
 	ret_if(!mv_data);
 
-	ret = mv_surveillance_get_result_value(event_result, MV_SURVEILLANCE_MOVEMENT_NUMBER_OF_REGIONS, &move_regions_num);
-	retm_if(ret, "failed to mv_surveillance_get_result_value for %s - [%s]", MV_SURVEILLANCE_MOVEMENT_NUMBER_OF_REGIONS, __mv_err_to_str(ret));
+	/* Whatever the filters make of it, the next frame goes to the engine too */
+	mv_data->engine_moving = 1;
 
-	regions = malloc(sizeof(mv_rectangle_s) * move_regions_num);
-	ret = mv_surveillance_get_result_value(event_result, MV_SURVEILLANCE_MOVEMENT_REGIONS, regions);
-	retm_if(ret, "failed to mv_surveillance_get_result_value for %s - [%s]", MV_SURVEILLANCE_MOVEMENT_REGIONS, __mv_err_to_str(ret));
+	ret_if(mv_data->frame_width == 0 || mv_data->frame_height == 0);
 
-	for (i = 0; i < move_regions_num; i++) {
-		// _D("region[%u] - position[%d x %d], witdh[%d], height[%d]", i, regions[i].point.x, regions[i].point.y, regions[i].width, regions[i].height);
-		// _D("region[%u] - area[%d]", i, regions[i].width * regions[i].height);
+	/* The whole frame changed with the light, nothing moved */
+	if (mv_data->push_us < mv_data->relit_until_us)
+		return;
+
+	width = mv_data->frame_width;
+	height = mv_data->frame_height;
+	decimation = mv_data->decimation;
+	threshold_size_region = THRESHOLD_SIZE_REGION * width * height / THRESHOLD_SIZE_REGION_FRAME_AREA;
+
+	for (i = 0; i < (int)MIN(move_regions_num, MV_REGION_MAX); i++) {
+		const controller_mv_region_s *region = &luma_regions[i];
 
-		if (regions[i].width * regions[i].height < THRESHOLD_SIZE_REGION || result_count >= MV_RESULT_COUNT_MAX)
+		/* Regions mostly in masked areas are dropped, mv may still report them from around the mask edges */
+		if (mv_data->mask && controller_mv_mask_get_coverage(mv_data->mask, region->x, region->y,
+				region->width, region->height) < MV_MASK_COVERAGE_MIN)
 			continue;
+		mv_data->regions[unmasked_count++] = *region;
+	}
 
-		result[result_index] = regions[i].point.x * 99 / IMAGE_WIDTH;
-		result[result_index + 1] = regions[i].point.y * 99 / IMAGE_HEIGHT;
-		result[result_index + 2] = regions[i].width * 99 / IMAGE_WIDTH;
-		result[result_index + 3] = regions[i].height * 99 / IMAGE_HEIGHT;
+	/* Movement only in masked areas is no movement */
+	if (unmasked_count == 0)
+		return;
 
-		result_count++;
-		result_index = result_count * 4;
+	/* Pieces of one object make one result and weigh in the offset once, small pieces pass the size filter together */
+	merge_gap = mv_data->merge_gap < 0 ? -1 : mv_data->merge_gap * width / decimation / 100;
+	unmasked_count = controller_mv_merge_regions(mv_data->merge, mv_data->regions, unmasked_count,
+		merge_gap, mv_data->merge_iou);
 
-		valid_area_sum += regions[i].width * regions[i].height;
-	}
+	for (i = 0; i < unmasked_count; i++) {
+		const controller_mv_region_s *region = &mv_data->regions[i];
+		int x, y, region_width, region_height, area;
 
-	for (i = 0; i < move_regions_num; i++) {
-		if (regions[i].width * regions[i].height < THRESHOLD_SIZE_REGION)
+		/* Back to frame pixels, the odd last row and column dropped by decimation are not covered */
+		x = region->x * decimation;
+		y = region->y * decimation;
+		region_width = region->width * decimation;
+		region_height = region->height * decimation;
+		area = region_width * region_height;
+
+		// _D("region[%u] - position[%d x %d], witdh[%d], height[%d]", i, x, y, region_width, region_height);
+		// _D("region[%u] - area[%d]", i, area);
+
+		if (area < threshold_size_region)
 			continue;
 
-		//offset 은 움직임의 중심 좌표가 화면의 중심으로 부터 얼마나 벗어났는지의 값으로 -160 ~ 160, -120 ~ 120 의 값을 갖는다.
-		int x_offset = (regions[i].point.x + regions[i].width / 2) - (IMAGE_WIDTH / 2);
-		int y_offset = (regions[i].point.y + regions[i].height / 2) - (IMAGE_HEIGHT / 2);
-		int area = regions[i].width * regions[i].height;
+		if (mv_data->turn_until_us == 0)
+			controller_mv_heatmap_add_region(mv_data->heatmap, x, y, region_width, region_height, width, height);
+
+		if (result_count < MV_RESULT_COUNT_MAX) {
+			result[result_count * 4] = x * 99 / width;
+			result[result_count * 4 + 1] = y * 99 / height;
+			result[result_count * 4 + 2] = region_width * 99 / width;
+			result[result_count * 4 + 3] = region_height * 99 / height;
+			result_count++;
+		}
 
+		//offset 은 움직임의 중심 좌표가 화면의 중심으로 부터 얼마나 벗어났는지의 값으로 -width/2 ~ width/2, -height/2 ~ height/2 의 값을 갖는다. (320x240 : -160 ~ 160, -120 ~ 120)
 		// offset 값에 움직임 크기의 상대값(비율)을 곱한 다음, 모두 더해서 최종 offset 값을 구한다.
 		// 최종값의 범위는 offset 값의 범위와 같아야 한다.
-		horizontal += (int) x_offset * area / valid_area_sum;
-		vertical += (int) y_offset * area / valid_area_sum;
+		x_moment += (long long int)((x + region_width / 2) - (width / 2)) * area;
+		y_moment += (long long int)((y + region_height / 2) - (height / 2)) * area;
+		valid_area_sum += area;
+	}
+
+	if (valid_area_sum > 0) {
+		horizontal = (int)(x_moment / valid_area_sum);
+		vertical = (int)(y_moment / valid_area_sum);
 	}
-	free(regions);
 
 	mv_data->movement_detected_cb(horizontal, vertical, result, result_count, mv_data->movement_detected_cb_data);
 }
 
-void controller_mv_push_source(mv_source_h source)
+static void __take_requests(struct __mv_data *mv_data)
 {
-	int ret = 0;
-	ret_if(!source);
+	controller_mv_mask_h old_mask = NULL;
+	int mask_changed = 0;
+	int reset = 0;
+	int turn = 0;
+	float turn_x = 0.0f;
+	float turn_y = 0.0f;
+
+	pthread_mutex_lock(&mv_data->request_mutex);
+	if (mv_data->mask_requested) {
+		old_mask = mv_data->mask;
+		mv_data->mask = mv_data->requested_mask;
+		mv_data->requested_mask = NULL;
+		mv_data->mask_requested = 0;
+		mask_changed = 1;
+	}
+	reset = mv_data->reset_requested;
+	mv_data->reset_requested = 0;
+	turn = mv_data->turn_requested;
+	turn_x = mv_data->requested_turn_x;
+	turn_y = mv_data->requested_turn_y;
+	mv_data->turn_requested = 0;
+	mv_data->requested_turn_x = 0.0f;
+	mv_data->requested_turn_y = 0.0f;
+	pthread_mutex_unlock(&mv_data->request_mutex);
+
+	controller_mv_mask_destroy(old_mask);
+
+	/* An engine that cannot follow the view relearns it, as after any other move */
+	if (turn && !mv_data->engine->shift) {
+		reset = 1;
+		mv_data->view_lost = 1;
+	}
+
+	if (reset) {
+		if (mv_data->engine->reset)
+			mv_data->engine->reset(mv_data->engine_data);
+		mv_data->turn_until_us = 0;
+		mv_data->turn_remaining_x = 0.0f;
+		mv_data->turn_remaining_y = 0.0f;
+	} else if (turn) {
+		/* Taken up by the next push, a turn still going on is extended */
+		mv_data->turn_until_us = -1;
+		mv_data->turn_remaining_x += turn_x;
+		mv_data->turn_remaining_y += turn_y;
+	}
 
-	ret = mv_surveillance_push_source(source, VIDEO_STREAM_ID);
-	if (ret)
-		_E("failed to mv_surveillance_push_source() - [%s]", __mv_err_to_str(ret));
+	/* Frames across the move are no noise sample */
+	if (reset || turn) {
+		controller_mv_noise_reset(mv_data->noise);
+		controller_mv_illumination_reset(mv_data->illumination);
+	}
 
-	mv_destroy_source(source);
+	/* The grid kept was of another view or mask, the next frame goes to the engine */
+	if (reset || turn || mask_changed)
+		controller_mv_activity_reset(mv_data->activity);
 }
 
-mv_source_h controller_mv_create_source(
-		unsigned char *buffer, unsigned int size,
-		unsigned int width, unsigned int height, mv_colorspace_e colorspace)
+/* Search range of one axis in luma pixels, the way the view is meant to go plus a margin */
+static void __turn_search_range(float remaining, unsigned int length, int *min_shift, int *max_shift)
 {
-	mv_source_h source = NULL;
-	int ret = 0;
+	int margin = MV_TURN_SEARCH_MARGIN * length / 100 + 1;
+	int expected = (int)(remaining * length / 100);
+
+	*min_shift = MIN(expected, 0) - margin;
+	*max_shift = MAX(expected, 0) + margin;
+}
 
-	retv_if(!buffer, NULL);
+/* Moves the scene the engine learnt along with the view, or has it relearnt when the shift is not clear */
+static void __follow_turn(struct __mv_data *mv_data, const controller_mv_luma_s *luma, long long int time_us)
+{
+	int min_dx = 0;
+	int max_dx = 0;
+	int min_dy = 0;
+	int max_dy = 0;
+	int dx = 0;
+	int dy = 0;
 
-	ret = mv_create_source(&source);
-	retvm_if(ret, NULL, "failed to mv_create_source - [%s]", __mv_err_to_str(ret));
+	/* Profiles of every frame, the first one of a turn is compared with the last still one */
+	controller_mv_ego_motion_push(mv_data->ego_motion, luma);
 
-	ret = mv_source_fill_by_buffer(source, buffer, size, width, height, colorspace);
-	if (ret) {
-		_E("failed to fill source - %d", ret);
+	if (mv_data->turn_until_us == 0)
+		return;
 
-		if (source)
-			mv_destroy_source(source);
+	if (mv_data->turn_until_us < 0)
+		mv_data->turn_until_us = time_us + MV_TURN_WINDOW_MS * 1000LL;
 
-		return NULL;
+	if (time_us > mv_data->turn_until_us) {
+		_D("stream %d - view settled", mv_data->video_stream_id);
+		mv_data->turn_until_us = 0;
+		mv_data->turn_remaining_x = 0.0f;
+		mv_data->turn_remaining_y = 0.0f;
+		controller_mv_noise_reset(mv_data->noise);
+		return;
+	}
+
+	__turn_search_range(mv_data->turn_remaining_x, luma->width, &min_dx, &max_dx);
+	__turn_search_range(mv_data->turn_remaining_y, luma->height, &min_dy, &max_dy);
+
+	if (controller_mv_ego_motion_estimate(mv_data->ego_motion, min_dx, max_dx, min_dy, max_dy, &dx, &dy)) {
+		_D("stream %d - lost the view while turning, relearning it", mv_data->video_stream_id);
+		if (mv_data->engine->reset)
+			mv_data->engine->reset(mv_data->engine_data);
+		mv_data->turn_until_us = 0;
+		mv_data->turn_remaining_x = 0.0f;
+		mv_data->turn_remaining_y = 0.0f;
+		mv_data->view_lost = 1;
+		return;
 	}
 
-	return source;
+	if (dx == 0 && dy == 0)
+		return;
+
+	mv_data->engine->shift(mv_data->engine_data, dx, dy);
+	mv_data->view_shift_x = dx * 100.0f / luma->width;
+	mv_data->view_shift_y = dy * 100.0f / luma->height;
+	mv_data->turn_remaining_x -= mv_data->view_shift_x;
+	mv_data->turn_remaining_y -= mv_data->view_shift_y;
 }
 
-int controller_mv_set_movement_detection_event_cb(movement_detected_cb movement_detected_cb, void *user_data)
+static void __update_threshold(struct __mv_data *mv_data)
 {
-	int ret = 0;
-	mv_engine_config_h engine_cfg = NULL;
+	unsigned int estimate = controller_mv_noise_get_threshold(mv_data->noise);
+	unsigned int drift = estimate > mv_data->threshold ? estimate - mv_data->threshold : mv_data->threshold - estimate;
 
-	if (movement_detected_cb == NULL)
-		return -1;
+	/* Small drifts are not worth a rebuild, media vision starts learning its scene over */
+	if (mv_data->threshold_measured && drift <= MV_THRESHOLD_DRIFT_MAX)
+		return;
+
+	if (mv_data->engine->set_threshold(mv_data->engine_data, estimate)) {
+		_E("stream %d - failed to set detection threshold %u", mv_data->video_stream_id, estimate);
+		return;
+	}
+
+	_I("stream %d - detection threshold %u -> %u from the measured noise", mv_data->video_stream_id,
+		mv_data->threshold, estimate);
+	mv_data->threshold = estimate;
+	mv_data->threshold_measured = 1;
+}
 
-	if (mv_data != NULL) {
-		mv_data->movement_detected_cb = movement_detected_cb;
-		mv_data->movement_detected_cb_data = user_data;
+/* The light changed over the whole frame, the engine starts from the new brightness and events are held for a while */
+static void __relight(struct __mv_data *mv_data, long long int time_us)
+{
+	if (time_us >= mv_data->relit_until_us)
+		_I("stream %d - brightness jumped, events held for %d ms", mv_data->video_stream_id, MV_ILLUMINATION_HOLD_MS);
+
+	/* Auto exposure keeps changing it for a while, every jump extends the hold */
+	mv_data->relit_until_us = time_us + MV_ILLUMINATION_HOLD_MS * 1000LL;
+
+	if (mv_data->engine->reset)
+		mv_data->engine->reset(mv_data->engine_data);
+	controller_mv_noise_reset(mv_data->noise);
+	controller_mv_activity_reset(mv_data->activity);
+}
+
+/* Frames that barely differ from the last analysed one are left out */
+static int __is_still(struct __mv_data *mv_data, const controller_mv_luma_s *luma, long long int time_us)
+{
+	int changed = 0;
+
+	if (!mv_data->activity || mv_data->activity_floor == 0)
 		return 0;
+
+	/* Measured on every frame, the grid of an analysed one is kept */
+	changed = controller_mv_activity_measure(mv_data->activity, luma, mv_data->threshold);
+
+	/* Movement still going on and a turning view are always analysed */
+	if (changed >= 0 && (unsigned int)changed < mv_data->activity_floor && !mv_data->engine_moving && mv_data->turn_until_us == 0
+			&& time_us - mv_data->analysed_us < MV_ACTIVITY_KEEP_ALIVE_MS * 1000LL)
+		return 1;
+
+	controller_mv_activity_keep(mv_data->activity);
+	mv_data->analysed_us = time_us;
+
+	return 0;
+}
+
+void controller_mv_push_source(controller_mv_h mv_data, const image_buffer_data_s *image_buffer)
+{
+	controller_mv_luma_s luma = {0, };
+
+	ret_if(!mv_data);
+	ret_if(!image_buffer || !image_buffer->buffer);
+
+	mv_data->view_shift_x = 0.0f;
+	mv_data->view_shift_y = 0.0f;
+	mv_data->view_lost = 0;
+
+	__take_requests(mv_data);
+
+	if (__prepare_luma(mv_data, image_buffer, &luma))
+		return;
+
+	/* Compiled again only when the luma size changes */
+	if (mv_data->mask && !controller_mv_mask_rasterize(mv_data->mask, luma.width, luma.height))
+		luma.mask = mv_data->mask;
+
+	if (mv_data->engine->shift)
+		__follow_turn(mv_data, &luma, image_buffer->timestamp_us);
+
+	/* A turning view changes brightness by itself, tracking starts over once it settles */
+	if (mv_data->turn_until_us != 0)
+		controller_mv_illumination_reset(mv_data->illumination);
+	else if (controller_mv_illumination_push(mv_data->illumination, &luma))
+		__relight(mv_data, image_buffer->timestamp_us);
+
+	/* A turning view is no noise sample */
+	if (mv_data->turn_until_us == 0 && controller_mv_noise_push(mv_data->noise, &luma, image_buffer->timestamp_us))
+		__update_threshold(mv_data);
+
+	/* Still frames count too, the heat map is a share of the frames seen */
+	if (mv_data->turn_until_us == 0)
+		controller_mv_heatmap_add_frame(mv_data->heatmap, image_buffer->timestamp_us);
+
+	if (__is_still(mv_data, &luma, image_buffer->timestamp_us)) {
+		pthread_mutex_lock(&mv_data->request_mutex);
+		mv_data->skipped_frames++;
+		pthread_mutex_unlock(&mv_data->request_mutex);
+		return;
+	}
+
+	pthread_mutex_lock(&mv_data->request_mutex);
+	mv_data->analysed_frames++;
+	pthread_mutex_unlock(&mv_data->request_mutex);
+
+	/* Regions are scaled back to source pixels, the event callback runs inside the push */
+	mv_data->frame_width = image_buffer->image_width;
+	mv_data->frame_height = image_buffer->image_height;
+	mv_data->push_us = image_buffer->timestamp_us;
+	mv_data->engine_moving = 0;
+
+	mv_data->engine->push(mv_data->engine_data, &luma);
+}
+
+void controller_mv_reset(controller_mv_h mv_data)
+{
+	ret_if(!mv_data);
+
+	pthread_mutex_lock(&mv_data->request_mutex);
+	mv_data->reset_requested = 1;
+	pthread_mutex_unlock(&mv_data->request_mutex);
+}
+
+void controller_mv_set_mask(controller_mv_h mv_data, controller_mv_mask_h mask)
+{
+	controller_mv_mask_h superseded = NULL;
+
+	if (!mv_data) {
+		controller_mv_mask_destroy(mask);
+		return;
 	}
 
+	pthread_mutex_lock(&mv_data->request_mutex);
+	superseded = mv_data->requested_mask;
+	mv_data->requested_mask = mask;
+	mv_data->mask_requested = 1;
+	pthread_mutex_unlock(&mv_data->request_mutex);
+
+	/* Never taken by a push, nobody else refers to it */
+	controller_mv_mask_destroy(superseded);
+}
+
+int controller_mv_set_decimation(controller_mv_h mv_data, unsigned int decimation)
+{
+	retv_if(!mv_data, -1);
+	retvm_if(decimation != 1 && decimation != 2 && decimation != 4, -1, "unsupported decimation : %u", decimation);
+
+	mv_data->decimation = decimation;
+
+	return 0;
+}
+
+void controller_mv_turn(controller_mv_h mv_data, float view_x, float view_y)
+{
+	ret_if(!mv_data);
+
+	pthread_mutex_lock(&mv_data->request_mutex);
+	mv_data->turn_requested = 1;
+	mv_data->requested_turn_x += view_x;
+	mv_data->requested_turn_y += view_y;
+	pthread_mutex_unlock(&mv_data->request_mutex);
+}
+
+int controller_mv_get_view_shift(controller_mv_h mv_data, float *view_x, float *view_y)
+{
+	retv_if(!mv_data, -1);
+	retv_if(!view_x || !view_y, -1);
+
+	*view_x = mv_data->view_shift_x;
+	*view_y = mv_data->view_shift_y;
+
+	return mv_data->view_lost ? -1 : 0;
+}
+
+char *controller_mv_get_heatmap(controller_mv_h mv_data)
+{
+	retv_if(!mv_data, NULL);
+
+	return controller_mv_heatmap_snapshot(mv_data->heatmap);
+}
+
+int controller_mv_load_heatmap(controller_mv_h mv_data, const char *json)
+{
+	retv_if(!mv_data, -1);
+
+	return controller_mv_heatmap_load(mv_data->heatmap, json);
+}
+
+int controller_mv_set_activity_floor(controller_mv_h mv_data, unsigned int floor)
+{
+	retv_if(!mv_data, -1);
+	retv_if(floor > 0 && !mv_data->activity, -1);
+
+	mv_data->activity_floor = floor;
+
+	return 0;
+}
+
+void controller_mv_get_activity_stats(controller_mv_h mv_data, unsigned int *analysed, unsigned int *skipped)
+{
+	ret_if(!mv_data);
+	ret_if(!analysed || !skipped);
+
+	pthread_mutex_lock(&mv_data->request_mutex);
+	*analysed = mv_data->analysed_frames;
+	*skipped = mv_data->skipped_frames;
+	mv_data->analysed_frames = 0;
+	mv_data->skipped_frames = 0;
+	pthread_mutex_unlock(&mv_data->request_mutex);
+}
+
+int controller_mv_set_merge(controller_mv_h mv_data, int gap, unsigned int iou)
+{
+	retv_if(!mv_data, -1);
+	retvm_if(gap > 100 || iou > 100, -1, "unsupported merge : gap %d, iou %u", gap, iou);
+
+	mv_data->merge_gap = gap;
+	mv_data->merge_iou = iou;
+
+	return 0;
+}
+
+int controller_mv_set_threshold(controller_mv_h mv_data, unsigned int threshold)
+{
+	retv_if(!mv_data, -1);
+	retvm_if(threshold > 255, -1, "unsupported threshold : %u", threshold);
+
+	if (threshold == 0) {
+		if (!mv_data->noise && mv_data->engine->set_threshold)
+			mv_data->noise = controller_mv_noise_create();
+		return 0;
+	}
+
+	controller_mv_noise_destroy(mv_data->noise);
+	mv_data->noise = NULL;
+
+	retv_if(!mv_data->engine->set_threshold, -1);
+	retv_if(mv_data->engine->set_threshold(mv_data->engine_data, threshold), -1);
+	mv_data->threshold = threshold;
+
+	return 0;
+}
+
+int controller_mv_engine_from_name(const char *name, controller_mv_engine_e *engine)
+{
+	retv_if(!name, -1);
+	retv_if(!engine, -1);
+
+	if (!g_strcmp0(name, "media_vision"))
+		*engine = CONTROLLER_MV_ENGINE_MEDIA_VISION;
+	else if (!g_strcmp0(name, "motion"))
+		*engine = CONTROLLER_MV_ENGINE_MOTION;
+	else
+		return -1;
+
+	return 0;
+}
+
+const char *controller_mv_get_engine_name(controller_mv_h mv_data)
+{
+	retv_if(!mv_data, NULL);
+
+	return mv_data->engine->name;
+}
+
+controller_mv_h controller_mv_create(int video_stream_id, controller_mv_engine_e engine,
+	movement_detected_cb movement_detected_cb, void *user_data)
+{
+	struct __mv_data *mv_data = NULL;
+
+	if (movement_detected_cb == NULL)
+		return NULL;
+
 	mv_data = malloc(sizeof(struct __mv_data));
 	if (mv_data == NULL) {
 		_E("Failed to allocate media vision data");
-		return -1;
+		return NULL;
 	}
 	memset(mv_data, 0, sizeof(struct __mv_data));
+	mv_data->video_stream_id = video_stream_id;
+	mv_data->decimation = MV_ANALYSIS_DECIMATION;
+	mv_data->unsupported_format = CAMERA_PIXEL_FORMAT_INVALID;
+	mv_data->merge_gap = MV_MERGE_GAP_DEFAULT;
+	mv_data->merge_iou = MV_MERGE_IOU_DEFAULT;
+	pthread_mutex_init(&mv_data->request_mutex, NULL);
+
+	mv_data->regions = malloc(sizeof(controller_mv_region_s) * MV_REGION_MAX);
+	goto_if(!mv_data->regions, ERROR);
+	mv_data->merge = controller_mv_merge_create();
+	goto_if(!mv_data->merge, ERROR);
+	mv_data->activity = controller_mv_activity_create();
+	goto_if(!mv_data->activity, ERROR);
+	mv_data->activity_floor = MV_ACTIVITY_FLOOR_DEFAULT;
+	mv_data->illumination = controller_mv_illumination_create();
+	goto_if(!mv_data->illumination, ERROR);
+	mv_data->heatmap = controller_mv_heatmap_create();
+	goto_if(!mv_data->heatmap, ERROR);
+
+	mv_data->engine = __get_engine(engine);
+	goto_if(!mv_data->engine, ERROR);
+
+	/* The callback is set before the engine starts, a stream may already be pushing */
+	mv_data->movement_detected_cb = movement_detected_cb;
+	mv_data->movement_detected_cb_data = user_data;
 
-	ret = mv_create_engine_config(&engine_cfg);
-	if (ret) {
-		_E("failed to subsmv_create_engine_configs() - %s", __mv_err_to_str(ret));
+	mv_data->engine_data = mv_data->engine->create(video_stream_id, __movement_detected_event_cb, mv_data);
+	if (!mv_data->engine_data) {
+		_E("failed to create %s engine for stream %d", mv_data->engine->name, video_stream_id);
 		goto ERROR;
 	}
 
-	mv_engine_config_set_int_attribute(engine_cfg, MV_SURVEILLANCE_MOVEMENT_DETECTION_THRESHOLD, 50); /* 10 is default value [0 ~ 255] */
-
-	ret = mv_surveillance_event_trigger_create(MV_SURVEILLANCE_EVENT_TYPE_MOVEMENT_DETECTED, &mv_data->mv_trigger_handle);
-	if (ret) {
-		_E("failed to mv_surveillance_event_trigger_create - [%s]", __mv_err_to_str(ret));
-		goto ERROR;
+	if (mv_data->engine->shift) {
+		mv_data->ego_motion = controller_mv_ego_motion_create();
+		goto_if(!mv_data->ego_motion, ERROR);
 	}
 
-	ret = mv_surveillance_subscribe_event_trigger(mv_data->mv_trigger_handle, VIDEO_STREAM_ID, engine_cfg, __movement_detected_event_cb, mv_data);
+	/* Engines start at MV_MOVEMENT_DETECTION_THRESHOLD, the noise calibration takes over after a few seconds */
+	mv_data->threshold = MV_MOVEMENT_DETECTION_THRESHOLD;
+	controller_mv_set_threshold(mv_data, 0);
 
-	if (ret) {
-		_E("failed to subscribe %s - %s", MV_SURVEILLANCE_EVENT_TYPE_MOVEMENT_DETECTED, __mv_err_to_str(ret));
-		goto ERROR;
-	}
+	return mv_data;
+
+ERROR:
+	if (mv_data->engine_data)
+		mv_data->engine->destroy(mv_data->engine_data);
+	controller_mv_merge_destroy(mv_data->merge);
+	controller_mv_activity_destroy(mv_data->activity);
+	controller_mv_illumination_destroy(mv_data->illumination);
+	controller_mv_heatmap_destroy(mv_data->heatmap);
+	free(mv_data->regions);
+	pthread_mutex_destroy(&mv_data->request_mutex);
+	free(mv_data);
 
-	if (engine_cfg)
-		mv_destroy_engine_config(engine_cfg);
+	return NULL;
+}
 
-	mv_data->movement_detected_cb = movement_detected_cb;
-	mv_data->movement_detected_cb_data = user_data;
+void controller_mv_destroy(controller_mv_h mv_data)
+{
+	if (mv_data == NULL)
+		return;
 
-	return 0;
+	if (mv_data->engine_data)
+		mv_data->engine->destroy(mv_data->engine_data);
+
+	controller_mv_mask_destroy(mv_data->mask);
+	controller_mv_mask_destroy(mv_data->requested_mask);
+	controller_mv_noise_destroy(mv_data->noise);
+	controller_mv_ego_motion_destroy(mv_data->ego_motion);
+	controller_mv_merge_destroy(mv_data->merge);
+	controller_mv_activity_destroy(mv_data->activity);
+	controller_mv_illumination_destroy(mv_data->illumination);
+	controller_mv_heatmap_destroy(mv_data->heatmap);
+	free(mv_data->regions);
+	pthread_mutex_destroy(&mv_data->request_mutex);
+	free(mv_data);
+}
 
-ERROR:
-	if (engine_cfg)
-		mv_destroy_engine_config(engine_cfg);
+#ifdef CONTROLLER_MV_BENCHMARK
+#define BENCHMARK_EVENTS 20000
+
+static void __benchmark_movement_detected_cb(int horizontal, int vertical, int result[], int result_count, void *user_data)
+{
+	*(int *)user_data += horizontal + vertical + result_count;
+}
 
-	if (mv_data->mv_trigger_handle)
-		mv_surveillance_event_trigger_destroy(mv_data->mv_trigger_handle);
+static long long int __benchmark_get_time_ns(void)
+{
+	struct timespec time_s;
 
-	free(mv_data);
-	mv_data = NULL;
+	clock_gettime(CLOCK_MONOTONIC, &time_s);
 
-	return -1;
+	return time_s.tv_sec * 1000000000LL + time_s.tv_nsec;
 }
 
-void controller_mv_unset_movement_detection_event_cb(void)
+void controller_mv_benchmark(void)
 {
-	if (mv_data == NULL)
+	const unsigned int region_counts[] = {1, 30, 300};
+	struct __mv_data mv_data;
+	controller_mv_region_s *regions = NULL;
+	unsigned int seed = 1;
+	int sink = 0;
+	unsigned int i, j;
+
+	regions = malloc(sizeof(controller_mv_region_s) * MV_REGION_MAX);
+	ret_if(!regions);
+
+	/* A 320 x 240 stream at decimation 1, no engine behind it */
+	memset(&mv_data, 0, sizeof(mv_data));
+	mv_data.frame_width = 320;
+	mv_data.frame_height = 240;
+	mv_data.decimation = 1;
+	mv_data.merge_gap = MV_MERGE_GAP_DEFAULT;
+	mv_data.merge_iou = MV_MERGE_IOU_DEFAULT;
+	mv_data.regions = malloc(sizeof(controller_mv_region_s) * MV_REGION_MAX);
+	mv_data.merge = controller_mv_merge_create();
+	mv_data.heatmap = controller_mv_heatmap_create();
+	if (!mv_data.regions || !mv_data.merge || !mv_data.heatmap) {
+		free(mv_data.regions);
+		controller_mv_merge_destroy(mv_data.merge);
+		controller_mv_heatmap_destroy(mv_data.heatmap);
+		free(regions);
 		return;
+	}
+	mv_data.movement_detected_cb = __benchmark_movement_detected_cb;
+	mv_data.movement_detected_cb_data = &sink;
+
+	for (i = 0; i < MV_REGION_MAX; i++) {
+		seed = seed * 1103515245 + 12345;
+		regions[i].x = (seed >> 8) % 280;
+		regions[i].y = (seed >> 16) % 200;
+		regions[i].width = 4 + (seed >> 4) % 36;
+		regions[i].height = 4 + (seed >> 12) % 36;
+	}
 
-	if (mv_data->mv_trigger_handle)
-		mv_surveillance_event_trigger_destroy(mv_data->mv_trigger_handle);
+	for (i = 0; i < G_N_ELEMENTS(region_counts); i++) {
+		long long int started = __benchmark_get_time_ns();
 
-	free(mv_data);
-	mv_data = NULL;
+		for (j = 0; j < BENCHMARK_EVENTS; j++)
+			__movement_detected_event_cb(regions, region_counts[i], &mv_data);
+
+		_I("region handling - %u regions : %lld ns per event", region_counts[i],
+			(__benchmark_get_time_ns() - started) / BENCHMARK_EVENTS);
+	}
+
+	_D("benchmark sink %d", sink);
+	controller_mv_merge_destroy(mv_data.merge);
+	controller_mv_heatmap_destroy(mv_data.heatmap);
+	free(mv_data.regions);
+	free(regions);
 }
+#endif /* CONTROLLER_MV_BENCHMARK */
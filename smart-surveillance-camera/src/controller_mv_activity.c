@@ -0,0 +1,147 @@
+ /*
+ * Copyright (c) 2018 Samsung Electronics Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <stdlib.h>
+#include <string.h>
+#include "log.h"
+#include "controller_mv_activity.h"
+
+#define ACTIVITY_GRID_STEP 2 // one pixel out of ACTIVITY_GRID_STEP x ACTIVITY_GRID_STEP, the smallest reported region spans a few
+
+struct __mv_activity_s {
+	unsigned int width; // of the luma the grids are sampled from
+	unsigned int height;
+	unsigned int columns;
+	unsigned int rows;
+	unsigned char *current; // grid of the last measure
+	unsigned char *kept; // grid of the last analysed frame
+	int kept_valid;
+};
+
+static int __alloc_grids(struct __mv_activity_s *activity, unsigned int width, unsigned int height)
+{
+	free(activity->current);
+	free(activity->kept);
+	activity->width = width;
+	activity->height = height;
+	activity->columns = (width + ACTIVITY_GRID_STEP - 1) / ACTIVITY_GRID_STEP;
+	activity->rows = (height + ACTIVITY_GRID_STEP - 1) / ACTIVITY_GRID_STEP;
+	activity->current = malloc(activity->columns * activity->rows);
+	activity->kept = malloc(activity->columns * activity->rows);
+	activity->kept_valid = 0;
+
+	if (!activity->current || !activity->kept) {
+		_E("failed to allocate activity grids for [%u x %u]", width, height);
+		free(activity->current);
+		free(activity->kept);
+		activity->current = NULL;
+		activity->kept = NULL;
+		activity->width = 0;
+		activity->height = 0;
+		return -1;
+	}
+
+	return 0;
+}
+
+int controller_mv_activity_measure(controller_mv_activity_h activity, const controller_mv_luma_s *luma, unsigned int threshold)
+{
+	const unsigned short *runs = NULL;
+	unsigned int run_count = 0;
+	unsigned int run = 0;
+	unsigned int row = 0;
+	unsigned int column = 0;
+	int changed = 0;
+
+	retv_if(!activity, -1);
+	retv_if(!luma || !luma->data, -1);
+
+	if (luma->width != activity->width || luma->height != activity->height) {
+		if (__alloc_grids(activity, luma->width, luma->height))
+			return -1;
+	}
+
+	for (row = 0; row < activity->rows; row++) {
+		const unsigned char *line = luma->data + row * ACTIVITY_GRID_STEP * luma->width;
+		const unsigned char *kept = activity->kept + row * activity->columns;
+		unsigned char *current = activity->current + row * activity->columns;
+
+		if (luma->mask)
+			run_count = controller_mv_mask_get_runs(luma->mask, row * ACTIVITY_GRID_STEP, &runs);
+		run = 0;
+
+		for (column = 0; column < activity->columns; column++) {
+			unsigned int x = column * ACTIVITY_GRID_STEP;
+
+			current[column] = line[x];
+
+			if (luma->mask) {
+				while (run < run_count && runs[2 * run + 1] <= x)
+					run++;
+				if (run == run_count || runs[2 * run] > x)
+					continue;
+			}
+
+			if (activity->kept_valid && (unsigned int)abs((int)current[column] - (int)kept[column]) > threshold)
+				changed++;
+		}
+	}
+
+	return activity->kept_valid ? changed : -1;
+}
+
+void controller_mv_activity_keep(controller_mv_activity_h activity)
+{
+	unsigned char *kept = NULL;
+
+	ret_if(!activity);
+
+	if (!activity->current)
+		return;
+
+	kept = activity->kept;
+	activity->kept = activity->current;
+	activity->current = kept;
+	activity->kept_valid = 1;
+}
+
+void controller_mv_activity_reset(controller_mv_activity_h activity)
+{
+	ret_if(!activity);
+
+	activity->kept_valid = 0;
+}
+
+controller_mv_activity_h controller_mv_activity_create(void)
+{
+	struct __mv_activity_s *activity = NULL;
+
+	activity = calloc(1, sizeof(struct __mv_activity_s));
+	retvm_if(!activity, NULL, "failed to allocate activity check");
+
+	return activity;
+}
+
+void controller_mv_activity_destroy(controller_mv_activity_h activity)
+{
+	if (!activity)
+		return;
+
+	free(activity->current);
+	free(activity->kept);
+	free(activity);
+}
@@ -0,0 +1,233 @@
+ /*
+ * Copyright (c) 2018 Samsung Electronics Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <glib.h>
+#include "log.h"
+#include "controller_mv_ego_motion.h"
+
+#define EGO_MOTION_OVERLAP_MIN 50 // percent of a profile two frames have to share
+#define EGO_MOTION_TEXTURE_MIN 2 // mean luma deviation of a profile, a flatter view cannot be matched
+#define EGO_MOTION_DISTINCT 80 // percent of the mean cost of the tried shifts the best one has to stay under
+
+struct __mv_ego_motion_s {
+	unsigned int width;
+	unsigned int height;
+
+	/* Mean luma of every column and row, zero mean, in 1/256 levels */
+	int *columns[2];
+	int *rows[2];
+	int texture[2]; // mean deviation of the flatter profile
+	int current; // index of the last pushed profiles
+	int pushed; // profiles of the same size, up to 2
+};
+
+static void __free_profiles(struct __mv_ego_motion_s *ego_motion)
+{
+	int i = 0;
+
+	for (i = 0; i < 2; i++) {
+		free(ego_motion->columns[i]);
+		free(ego_motion->rows[i]);
+		ego_motion->columns[i] = NULL;
+		ego_motion->rows[i] = NULL;
+	}
+	ego_motion->pushed = 0;
+}
+
+static int __alloc_profiles(struct __mv_ego_motion_s *ego_motion, unsigned int width, unsigned int height)
+{
+	int i = 0;
+
+	/* Kept on failure too, the next frame of the same size does not retry */
+	__free_profiles(ego_motion);
+	ego_motion->width = width;
+	ego_motion->height = height;
+
+	for (i = 0; i < 2; i++) {
+		ego_motion->columns[i] = malloc(sizeof(int) * width);
+		ego_motion->rows[i] = malloc(sizeof(int) * height);
+		goto_if(!ego_motion->columns[i] || !ego_motion->rows[i], ERROR);
+	}
+
+	return 0;
+
+ERROR:
+	_E("failed to allocate ego-motion profiles for [%u x %u]", width, height);
+	__free_profiles(ego_motion);
+	return -1;
+}
+
+/* Subtracts the mean, the exposure may follow the view as it turns. Returns the mean deviation */
+static int __center_profile(int *profile, unsigned int length)
+{
+	long long int sum = 0;
+	long long int deviation = 0;
+	int mean = 0;
+	unsigned int i = 0;
+
+	for (i = 0; i < length; i++)
+		sum += profile[i];
+	mean = (int)(sum / length);
+
+	for (i = 0; i < length; i++) {
+		profile[i] -= mean;
+		deviation += abs(profile[i]);
+	}
+
+	return (int)(deviation / length);
+}
+
+void controller_mv_ego_motion_push(controller_mv_ego_motion_h ego_motion, const controller_mv_luma_s *luma)
+{
+	const unsigned char *row = NULL;
+	int *columns = NULL;
+	int *rows = NULL;
+	unsigned int sum = 0;
+	unsigned int x = 0;
+	unsigned int y = 0;
+
+	ret_if(!ego_motion);
+	ret_if(!luma || !luma->data);
+
+	if (luma->width != ego_motion->width || luma->height != ego_motion->height) {
+		if (__alloc_profiles(ego_motion, luma->width, luma->height))
+			return;
+	}
+
+	if (!ego_motion->columns[0])
+		return;
+
+	ego_motion->current ^= 1;
+	columns = ego_motion->columns[ego_motion->current];
+	rows = ego_motion->rows[ego_motion->current];
+	memset(columns, 0, sizeof(int) * luma->width);
+
+	/* Sums fit, 4096 x 4096 x 255 is below 2^32 */
+	for (y = 0; y < luma->height; y++) {
+		row = luma->data + y * luma->width;
+		sum = 0;
+		for (x = 0; x < luma->width; x++) {
+			columns[x] += row[x];
+			sum += row[x];
+		}
+		rows[y] = (int)((sum << 8) / luma->width);
+	}
+
+	for (x = 0; x < luma->width; x++)
+		columns[x] = (int)(((unsigned int)columns[x] << 8) / luma->height);
+
+	ego_motion->texture[ego_motion->current] = MIN(__center_profile(columns, luma->width),
+		__center_profile(rows, luma->height));
+
+	if (ego_motion->pushed < 2)
+		ego_motion->pushed++;
+}
+
+/* Best shift of current against previous in [min_shift, max_shift], -1 when there is none to trust */
+static int __match_profiles(const int *current, const int *previous, unsigned int length,
+	int min_shift, int max_shift, int *shift)
+{
+	int overlap_min = length * EGO_MOTION_OVERLAP_MIN / 100;
+	long long int best_cost = -1;
+	long long int cost_sum = 0;
+	int tried = 0;
+	int best = 0;
+	int d = 0;
+	int i = 0;
+
+	min_shift = MAX(min_shift, -((int)length - overlap_min));
+	max_shift = MIN(max_shift, (int)length - overlap_min);
+
+	for (d = min_shift; d <= max_shift; d++) {
+		int start = MAX(0, d);
+		int end = MIN((int)length, (int)length + d);
+		long long int cost = 0;
+
+		for (i = start; i < end; i++)
+			cost += abs(current[i] - previous[i - d]);
+		cost /= end - start;
+
+		if (best_cost < 0 || cost < best_cost) {
+			best_cost = cost;
+			best = d;
+		}
+		cost_sum += cost;
+		tried++;
+	}
+
+	/* A lone candidate, or one barely better than the rest, is a guess */
+	if (tried < 3 || best_cost * 100 > cost_sum / tried * EGO_MOTION_DISTINCT) {
+		_D("ambiguous profile match, best cost %lld of mean %lld", best_cost, cost_sum / tried);
+		return -1;
+	}
+
+	*shift = best;
+
+	return 0;
+}
+
+int controller_mv_ego_motion_estimate(controller_mv_ego_motion_h ego_motion,
+	int min_dx, int max_dx, int min_dy, int max_dy, int *dx, int *dy)
+{
+	int current = 0;
+	int previous = 0;
+
+	retv_if(!ego_motion, -1);
+	retv_if(!dx || !dy, -1);
+
+	if (ego_motion->pushed < 2)
+		return -1;
+
+	current = ego_motion->current;
+	previous = current ^ 1;
+
+	/* Profiles are in 1/256 levels */
+	if (ego_motion->texture[current] < EGO_MOTION_TEXTURE_MIN << 8) {
+		_D("view too flat for ego-motion");
+		return -1;
+	}
+
+	if (__match_profiles(ego_motion->columns[current], ego_motion->columns[previous], ego_motion->width,
+			min_dx, max_dx, dx))
+		return -1;
+
+	if (__match_profiles(ego_motion->rows[current], ego_motion->rows[previous], ego_motion->height,
+			min_dy, max_dy, dy))
+		return -1;
+
+	return 0;
+}
+
+controller_mv_ego_motion_h controller_mv_ego_motion_create(void)
+{
+	struct __mv_ego_motion_s *ego_motion = NULL;
+
+	ego_motion = calloc(1, sizeof(struct __mv_ego_motion_s));
+	retvm_if(!ego_motion, NULL, "failed to allocate ego-motion");
+
+	return ego_motion;
+}
+
+void controller_mv_ego_motion_destroy(controller_mv_ego_motion_h ego_motion)
+{
+	if (!ego_motion)
+		return;
+
+	__free_profiles(ego_motion);
+	free(ego_motion);
+}
@@ -0,0 +1,316 @@
+ /*
+ * Copyright (c) 2018 Samsung Electronics Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <math.h>
+#include <pthread.h>
+#include <glib.h>
+#include "log.h"
+#include "controller_mv_heatmap.h"
+
+#define HEATMAP_ONE 256 // a frame in the 24.8 counts
+#define HEATMAP_HALF_LIFE_HOURS 24
+#define HEATMAP_DECAY_INTERVAL_SEC 600 // the difference grid is summed up this often at the latest, it cannot overflow in between
+#define HEATMAP_EXCLUDE_PERMILLE 300 // cells moving in this share of the frames are suggested for exclusion, foliage, screens, roads
+#define HEATMAP_EXCLUDE_FRAMES_MIN 36000 // analysed frames before anything is suggested, about an hour at idle rate
+
+struct __mv_heatmap_s {
+	pthread_mutex_t mutex;
+	unsigned int map[HEATMAP_ROWS][HEATMAP_COLUMNS];
+	unsigned int frames;
+
+	/* Regions since the last fold, a corner each: +, - right of it, - below it, + right and below */
+	int diff[HEATMAP_ROWS + 1][HEATMAP_COLUMNS + 1];
+	unsigned int pending_frames;
+
+	unsigned int decay; // per HEATMAP_DECAY_INTERVAL_SEC, 0.16 fixed point
+	long long int decayed_us; // 0 until the first frame
+};
+
+/* Sums the difference grid into the map, to mutex */
+static void __fold(struct __mv_heatmap_s *heatmap)
+{
+	int running[HEATMAP_COLUMNS + 1] = {0, };
+	int row = 0;
+	int column = 0;
+
+	for (row = 0; row < HEATMAP_ROWS; row++) {
+		int sum = 0;
+
+		for (column = 0; column < HEATMAP_COLUMNS; column++) {
+			sum += heatmap->diff[row][column];
+			running[column] += sum;
+			heatmap->map[row][column] += running[column];
+		}
+	}
+
+	memset(heatmap->diff, 0, sizeof(heatmap->diff));
+	heatmap->frames += heatmap->pending_frames;
+	heatmap->pending_frames = 0;
+}
+
+/* To mutex */
+static void __decay(struct __mv_heatmap_s *heatmap)
+{
+	int row = 0;
+	int column = 0;
+
+	for (row = 0; row < HEATMAP_ROWS; row++) {
+		for (column = 0; column < HEATMAP_COLUMNS; column++)
+			heatmap->map[row][column] = ((unsigned long long)heatmap->map[row][column] * heatmap->decay) >> 16;
+	}
+	heatmap->frames = ((unsigned long long)heatmap->frames * heatmap->decay) >> 16;
+}
+
+void controller_mv_heatmap_add_frame(controller_mv_heatmap_h heatmap, long long int time_us)
+{
+	ret_if(!heatmap);
+
+	pthread_mutex_lock(&heatmap->mutex);
+
+	if (heatmap->decayed_us == 0)
+		heatmap->decayed_us = time_us;
+
+	/* A late decay catches up all of its intervals */
+	while (time_us - heatmap->decayed_us >= HEATMAP_DECAY_INTERVAL_SEC * 1000000LL) {
+		__fold(heatmap);
+		__decay(heatmap);
+		heatmap->decayed_us += HEATMAP_DECAY_INTERVAL_SEC * 1000000LL;
+	}
+
+	heatmap->pending_frames += HEATMAP_ONE;
+
+	pthread_mutex_unlock(&heatmap->mutex);
+}
+
+void controller_mv_heatmap_add_region(controller_mv_heatmap_h heatmap, int x, int y, int w, int h,
+	unsigned int width, unsigned int height)
+{
+	int first_column = 0;
+	int last_column = 0;
+	int first_row = 0;
+	int last_row = 0;
+
+	ret_if(!heatmap);
+	ret_if(width == 0 || height == 0);
+
+	if (w <= 0 || h <= 0)
+		return;
+
+	first_column = CLAMP((long long)x * HEATMAP_COLUMNS / width, 0, HEATMAP_COLUMNS - 1);
+	last_column = CLAMP((long long)(x + w - 1) * HEATMAP_COLUMNS / width, 0, HEATMAP_COLUMNS - 1);
+	first_row = CLAMP((long long)y * HEATMAP_ROWS / height, 0, HEATMAP_ROWS - 1);
+	last_row = CLAMP((long long)(y + h - 1) * HEATMAP_ROWS / height, 0, HEATMAP_ROWS - 1);
+
+	pthread_mutex_lock(&heatmap->mutex);
+	heatmap->diff[first_row][first_column] += HEATMAP_ONE;
+	heatmap->diff[first_row][last_column + 1] -= HEATMAP_ONE;
+	heatmap->diff[last_row + 1][first_column] -= HEATMAP_ONE;
+	heatmap->diff[last_row + 1][last_column + 1] += HEATMAP_ONE;
+	pthread_mutex_unlock(&heatmap->mutex);
+}
+
+/* Rectangles of busy cells, a run grows down while the rows below are busy all along it, what is left beside becomes its own */
+static void __append_exclude(GString *json, unsigned short permille[HEATMAP_ROWS][HEATMAP_COLUMNS])
+{
+	unsigned char taken[HEATMAP_ROWS][HEATMAP_COLUMNS] = {{0, }, };
+	int first = 1;
+	int row = 0;
+	int column = 0;
+
+	for (row = 0; row < HEATMAP_ROWS; row++) {
+		for (column = 0; column < HEATMAP_COLUMNS; column++) {
+			int end = column;
+			int bottom = row + 1;
+			int i = 0;
+
+			if (taken[row][column] || permille[row][column] < HEATMAP_EXCLUDE_PERMILLE)
+				continue;
+
+			while (end < HEATMAP_COLUMNS && !taken[row][end] && permille[row][end] >= HEATMAP_EXCLUDE_PERMILLE)
+				end++;
+
+			for (; bottom < HEATMAP_ROWS; bottom++) {
+				for (i = column; i < end; i++) {
+					if (taken[bottom][i] || permille[bottom][i] < HEATMAP_EXCLUDE_PERMILLE)
+						break;
+				}
+				if (i < end)
+					break;
+			}
+
+			for (i = row; i < bottom; i++)
+				memset(&taken[i][column], 1, end - column);
+
+			g_string_append_printf(json, "%s%g,%g %g,%g %g,%g %g,%g", first ? "" : ";",
+				column * 100.0 / HEATMAP_COLUMNS, row * 100.0 / HEATMAP_ROWS,
+				end * 100.0 / HEATMAP_COLUMNS, row * 100.0 / HEATMAP_ROWS,
+				end * 100.0 / HEATMAP_COLUMNS, bottom * 100.0 / HEATMAP_ROWS,
+				column * 100.0 / HEATMAP_COLUMNS, bottom * 100.0 / HEATMAP_ROWS);
+			first = 0;
+			column = end - 1;
+		}
+	}
+}
+
+char *controller_mv_heatmap_snapshot(controller_mv_heatmap_h heatmap)
+{
+	unsigned short permille[HEATMAP_ROWS][HEATMAP_COLUMNS] = {{0, }, };
+	unsigned int frames = 0;
+	GString *json = NULL;
+	int row = 0;
+	int column = 0;
+
+	retv_if(!heatmap, NULL);
+
+	/* The cells are copied out, the analysis only waits for the fold */
+	pthread_mutex_lock(&heatmap->mutex);
+	__fold(heatmap);
+	frames = heatmap->frames;
+	for (row = 0; row < HEATMAP_ROWS; row++) {
+		for (column = 0; column < HEATMAP_COLUMNS; column++) {
+			/* Overlapping regions of one frame count twice, a cell still moves in every frame at most */
+			permille[row][column] = frames ?
+				MIN(1000ULL, (unsigned long long)heatmap->map[row][column] * 1000 / frames) : 0;
+		}
+	}
+	pthread_mutex_unlock(&heatmap->mutex);
+
+	json = g_string_new(NULL);
+	g_string_append_printf(json, "{\"columns\": %d, \"rows\": %d, \"half_life_hours\": %d, \"saved\": %lld, \"frames\": %u, \"cells\": [",
+		HEATMAP_COLUMNS, HEATMAP_ROWS, HEATMAP_HALF_LIFE_HOURS, (long long int)(g_get_real_time() / G_USEC_PER_SEC),
+		frames / HEATMAP_ONE);
+
+	for (row = 0; row < HEATMAP_ROWS; row++) {
+		for (column = 0; column < HEATMAP_COLUMNS; column++)
+			g_string_append_printf(json, "%s%u", row || column ? "," : "", permille[row][column]);
+	}
+
+	g_string_append(json, "], \"exclude\": \"");
+	if (frames / HEATMAP_ONE >= HEATMAP_EXCLUDE_FRAMES_MIN)
+		__append_exclude(json, permille);
+	g_string_append(json, "\"}\n");
+
+	return g_string_free(json, FALSE);
+}
+
+/* The value after "key": in a snapshot, only what controller_mv_heatmap_snapshot() writes is read back */
+static const char *__find_value(const char *json, const char *key)
+{
+	gchar *quoted = g_strdup_printf("\"%s\": ", key);
+	const char *value = strstr(json, quoted);
+
+	if (value)
+		value += strlen(quoted);
+	g_free(quoted);
+
+	return value;
+}
+
+static int __read_number(const char *json, const char *key, long long int *number)
+{
+	const char *value = __find_value(json, key);
+	char *end = NULL;
+
+	if (!value)
+		return -1;
+
+	*number = strtoll(value, &end, 10);
+
+	return end == value ? -1 : 0;
+}
+
+int controller_mv_heatmap_load(controller_mv_heatmap_h heatmap, const char *json)
+{
+	unsigned short permille[HEATMAP_ROWS][HEATMAP_COLUMNS] = {{0, }, };
+	long long int columns = 0;
+	long long int rows = 0;
+	long long int saved = 0;
+	long long int frames = 0;
+	long long int age = 0;
+	const char *value = NULL;
+	char *end = NULL;
+	double fade = 1.0;
+	int row = 0;
+	int column = 0;
+
+	retv_if(!heatmap, -1);
+	retv_if(!json, -1);
+
+	retvm_if(__read_number(json, "columns", &columns) || __read_number(json, "rows", &rows)
+		|| columns != HEATMAP_COLUMNS || rows != HEATMAP_ROWS, -1, "heat map is not of a %d x %d grid",
+		HEATMAP_COLUMNS, HEATMAP_ROWS);
+	retvm_if(__read_number(json, "saved", &saved) || __read_number(json, "frames", &frames)
+		|| frames < 0 || frames > UINT_MAX / HEATMAP_ONE, -1, "heat map without its frames");
+
+	value = __find_value(json, "cells");
+	retvm_if(!value || *value != '[', -1, "heat map without its cells");
+
+	for (row = 0; row < HEATMAP_ROWS; row++) {
+		for (column = 0; column < HEATMAP_COLUMNS; column++) {
+			unsigned long cell = strtoul(++value, &end, 10);
+
+			retvm_if(end == value || cell > 1000, -1, "heat map cell %d,%d is broken", column, row);
+			permille[row][column] = cell;
+			value = end;
+		}
+	}
+
+	/* The map went on fading while the app was down */
+	age = g_get_real_time() / G_USEC_PER_SEC - saved;
+	if (age > 0)
+		fade = exp2(-(double)age / (HEATMAP_HALF_LIFE_HOURS * 3600));
+	frames = llround(frames * HEATMAP_ONE * fade);
+
+	pthread_mutex_lock(&heatmap->mutex);
+	heatmap->frames = frames;
+	for (row = 0; row < HEATMAP_ROWS; row++) {
+		/* The middle of the per mille step, a snapshot of the restored map reads the same */
+		for (column = 0; column < HEATMAP_COLUMNS; column++)
+			heatmap->map[row][column] = permille[row][column] ?
+				(unsigned long long)(2 * permille[row][column] + 1) * frames / 2000 : 0;
+	}
+	pthread_mutex_unlock(&heatmap->mutex);
+
+	_I("heat map of %lld frames restored, saved %lld s ago", frames / HEATMAP_ONE, age);
+
+	return 0;
+}
+
+controller_mv_heatmap_h controller_mv_heatmap_create(void)
+{
+	struct __mv_heatmap_s *heatmap = NULL;
+
+	heatmap = calloc(1, sizeof(struct __mv_heatmap_s));
+	retvm_if(!heatmap, NULL, "failed to allocate heat map");
+	pthread_mutex_init(&heatmap->mutex, NULL);
+
+	heatmap->decay = (unsigned int)lround(65536.0 * exp2(-(double)HEATMAP_DECAY_INTERVAL_SEC / (HEATMAP_HALF_LIFE_HOURS * 3600)));
+
+	return heatmap;
+}
+
+void controller_mv_heatmap_destroy(controller_mv_heatmap_h heatmap)
+{
+	if (!heatmap)
+		return;
+
+	pthread_mutex_destroy(&heatmap->mutex);
+	free(heatmap);
+}
@@ -0,0 +1,164 @@
+ /*
+ * Copyright (c) 2018 Samsung Electronics Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "log.h"
+#include "controller_mv_illumination.h"
+
+#define ILLUMINATION_GRID_STEP 4 // one pixel out of ILLUMINATION_GRID_STEP x ILLUMINATION_GRID_STEP is sampled
+#define ILLUMINATION_PERCENTILE_COUNT 3
+#define ILLUMINATION_TRACK_RATE 0.0625f // share of the new frame in the tracked brightness, clouds take longer than 16 frames
+#define ILLUMINATION_MEAN_JUMP 12.0f // luma levels off the tracked mean
+#define ILLUMINATION_PERCENTILE_JUMP 4.0f // luma levels every percentile moved the same way, the bright end may be clipped
+#define ILLUMINATION_SAMPLES_MIN 100 // a mask leaving fewer samples is not measured
+
+static const unsigned int percentiles[ILLUMINATION_PERCENTILE_COUNT] = {20, 50, 80};
+
+struct __mv_illumination_s {
+	unsigned int histogram[256];
+	float mean; // tracked
+	float levels[ILLUMINATION_PERCENTILE_COUNT]; // tracked
+	int tracking;
+};
+
+/* Mean and percentiles of the unmasked grid, returns the number of samples */
+static unsigned int __measure(struct __mv_illumination_s *illumination, const controller_mv_luma_s *luma,
+	float *mean, float *levels)
+{
+	const unsigned short *runs = NULL;
+	unsigned int run_count = 0;
+	unsigned int run = 0;
+	unsigned int samples = 0;
+	unsigned long long int sum = 0;
+	unsigned int seen = 0;
+	unsigned int row = 0;
+	unsigned int x = 0;
+	int level = 0;
+	int i = 0;
+
+	memset(illumination->histogram, 0, sizeof(illumination->histogram));
+
+	for (row = 0; row < luma->height; row += ILLUMINATION_GRID_STEP) {
+		const unsigned char *line = luma->data + row * luma->width;
+
+		if (luma->mask)
+			run_count = controller_mv_mask_get_runs(luma->mask, row, &runs);
+		run = 0;
+
+		for (x = 0; x < luma->width; x += ILLUMINATION_GRID_STEP) {
+			if (luma->mask) {
+				while (run < run_count && runs[2 * run + 1] <= x)
+					run++;
+				if (run == run_count || runs[2 * run] > x)
+					continue;
+			}
+
+			illumination->histogram[line[x]]++;
+			sum += line[x];
+			samples++;
+		}
+	}
+
+	if (samples < ILLUMINATION_SAMPLES_MIN)
+		return samples;
+
+	*mean = (float)sum / samples;
+
+	for (level = 0, i = 0; level < 256 && i < ILLUMINATION_PERCENTILE_COUNT; level++) {
+		seen += illumination->histogram[level];
+		while (i < ILLUMINATION_PERCENTILE_COUNT && seen * 100ULL >= (unsigned long long)samples * percentiles[i])
+			levels[i++] = level;
+	}
+
+	return samples;
+}
+
+/* Every percentile moved at least ILLUMINATION_PERCENTILE_JUMP the way the mean did */
+static int __is_jump(const struct __mv_illumination_s *illumination, float mean, const float *levels)
+{
+	float direction = mean > illumination->mean ? 1.0f : -1.0f;
+	int i = 0;
+
+	if (fabsf(mean - illumination->mean) < ILLUMINATION_MEAN_JUMP)
+		return 0;
+
+	for (i = 0; i < ILLUMINATION_PERCENTILE_COUNT; i++) {
+		if ((levels[i] - illumination->levels[i]) * direction < ILLUMINATION_PERCENTILE_JUMP)
+			return 0;
+	}
+
+	return 1;
+}
+
+int controller_mv_illumination_push(controller_mv_illumination_h illumination, const controller_mv_luma_s *luma)
+{
+	float levels[ILLUMINATION_PERCENTILE_COUNT] = {0.0f, };
+	float mean = 0.0f;
+	int jump = 0;
+	int i = 0;
+
+	retv_if(!illumination, 0);
+	retv_if(!luma || !luma->data, 0);
+
+	if (__measure(illumination, luma, &mean, levels) < ILLUMINATION_SAMPLES_MIN)
+		return 0;
+
+	jump = illumination->tracking && __is_jump(illumination, mean, levels);
+	if (jump)
+		_D("brightness jumped, mean %.1f -> %.1f", illumination->mean, mean);
+
+	/* A jump is taken over at once, the engine is told to start from the new brightness */
+	if (!illumination->tracking || jump) {
+		illumination->mean = mean;
+		memcpy(illumination->levels, levels, sizeof(levels));
+		illumination->tracking = 1;
+		return jump;
+	}
+
+	illumination->mean += (mean - illumination->mean) * ILLUMINATION_TRACK_RATE;
+	for (i = 0; i < ILLUMINATION_PERCENTILE_COUNT; i++)
+		illumination->levels[i] += (levels[i] - illumination->levels[i]) * ILLUMINATION_TRACK_RATE;
+
+	return 0;
+}
+
+void controller_mv_illumination_reset(controller_mv_illumination_h illumination)
+{
+	ret_if(!illumination);
+
+	illumination->tracking = 0;
+}
+
+controller_mv_illumination_h controller_mv_illumination_create(void)
+{
+	struct __mv_illumination_s *illumination = NULL;
+
+	illumination = calloc(1, sizeof(struct __mv_illumination_s));
+	retvm_if(!illumination, NULL, "failed to allocate illumination tracker");
+
+	return illumination;
+}
+
+void controller_mv_illumination_destroy(controller_mv_illumination_h illumination)
+{
+	if (!illumination)
+		return;
+
+	free(illumination);
+}
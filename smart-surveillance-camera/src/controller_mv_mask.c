@@ -0,0 +1,294 @@
+ /*
+ * Copyright (c) 2018 Samsung Electronics Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <glib.h>
+#include "log.h"
+#include "controller_mv_mask.h"
+
+#define MASK_POLYGON_POINTS_MAX 32
+#define MASK_POLYGON_MAX 16 // include and exclude together
+
+typedef struct {
+	int exclude;
+	unsigned int point_count;
+	double x[MASK_POLYGON_POINTS_MAX]; // percent of the frame
+	double y[MASK_POLYGON_POINTS_MAX];
+} mask_polygon_s;
+
+struct __mv_mask_s {
+	mask_polygon_s polygons[MASK_POLYGON_MAX];
+	unsigned int polygon_count;
+	int has_include;
+
+	/* Compiled for width x height, runs of row r are runs[row_start[r]] ~ runs[row_start[r + 1]] pairs */
+	unsigned int width;
+	unsigned int height;
+	unsigned int *row_start;
+	unsigned short *runs;
+};
+
+static int __parse_polygon(const char *text, int exclude, mask_polygon_s *polygon)
+{
+	gchar **points = NULL;
+	int i = 0;
+
+	memset(polygon, 0, sizeof(mask_polygon_s));
+	polygon->exclude = exclude;
+
+	points = g_strsplit(text, " ", -1);
+	for (i = 0; points[i]; i++) {
+		double x = 0.0;
+		double y = 0.0;
+
+		if (points[i][0] == '\0')
+			continue;
+
+		if (sscanf(points[i], "%lf,%lf", &x, &y) != 2 || polygon->point_count >= MASK_POLYGON_POINTS_MAX) {
+			_E("invalid polygon point [%s] in [%s]", points[i], text);
+			g_strfreev(points);
+			return -1;
+		}
+
+		polygon->x[polygon->point_count] = CLAMP(x, 0.0, 100.0);
+		polygon->y[polygon->point_count] = CLAMP(y, 0.0, 100.0);
+		polygon->point_count++;
+	}
+	g_strfreev(points);
+
+	retvm_if(polygon->point_count < 3, -1, "polygon [%s] needs 3 points at least", text);
+
+	return 0;
+}
+
+static int __add_polygons(struct __mv_mask_s *mask, const char *const *polygons, int exclude)
+{
+	int i = 0;
+
+	if (!polygons)
+		return 0;
+
+	for (i = 0; polygons[i]; i++) {
+		if (polygons[i][0] == '\0')
+			continue;
+
+		retvm_if(mask->polygon_count >= MASK_POLYGON_MAX, -1, "more than %d polygons", MASK_POLYGON_MAX);
+
+		if (__parse_polygon(polygons[i], exclude, &mask->polygons[mask->polygon_count]))
+			return -1;
+
+		if (!exclude)
+			mask->has_include = 1;
+		mask->polygon_count++;
+	}
+
+	return 0;
+}
+
+static int __compare_double(const void *a, const void *b)
+{
+	double left = *(const double *)a;
+	double right = *(const double *)b;
+
+	return (left > right) - (left < right);
+}
+
+/* Even-odd fill of the pixels whose centre is inside the polygon on row */
+static void __fill_row(const mask_polygon_s *polygon, unsigned int row,
+	unsigned int width, unsigned int height, unsigned char *line, unsigned char value)
+{
+	double crossings[MASK_POLYGON_POINTS_MAX];
+	double center_y = (row + 0.5) * 100.0 / height;
+	unsigned int count = 0;
+	unsigned int i = 0;
+	unsigned int j = 0;
+
+	for (i = 0, j = polygon->point_count - 1; i < polygon->point_count; j = i++) {
+		double y0 = polygon->y[j];
+		double y1 = polygon->y[i];
+
+		if ((y0 <= center_y) == (y1 <= center_y))
+			continue;
+
+		crossings[count++] = polygon->x[j] + (center_y - y0) * (polygon->x[i] - polygon->x[j]) / (y1 - y0);
+	}
+
+	qsort(crossings, count, sizeof(double), __compare_double);
+
+	for (i = 0; i + 1 < count; i += 2) {
+		/* Pixel x is in when its centre, x + 0.5, is in [start, end) */
+		int first = (int)ceil(crossings[i] * width / 100.0 - 0.5);
+		int last = (int)ceil(crossings[i + 1] * width / 100.0 - 0.5) - 1;
+
+		if (first < 0)
+			first = 0;
+		if (last >= (int)width)
+			last = width - 1;
+		if (first <= last)
+			memset(line + first, value, last - first + 1);
+	}
+}
+
+static void __free_runs(struct __mv_mask_s *mask)
+{
+	free(mask->row_start);
+	free(mask->runs);
+	mask->row_start = NULL;
+	mask->runs = NULL;
+	mask->width = 0;
+	mask->height = 0;
+}
+
+int controller_mv_mask_rasterize(controller_mv_mask_h mask, unsigned int width, unsigned int height)
+{
+	unsigned char *line = NULL;
+	unsigned int run_count = 0;
+	unsigned int run_capacity = 0;
+	unsigned int row = 0;
+	unsigned int x = 0;
+	unsigned int i = 0;
+
+	retv_if(!mask, -1);
+	retv_if(width == 0 || height == 0 || width > 0xffff, -1);
+
+	if (mask->width == width && mask->height == height)
+		return 0;
+
+	__free_runs(mask);
+
+	line = malloc(width);
+	mask->row_start = malloc(sizeof(unsigned int) * (height + 1));
+	/* One run per row covers most masks, grown below for busier ones */
+	run_capacity = height;
+	mask->runs = malloc(sizeof(unsigned short) * 2 * run_capacity);
+	goto_if(!line || !mask->row_start || !mask->runs, ERROR);
+
+	for (row = 0; row < height; row++) {
+		memset(line, mask->has_include ? 0 : 1, width);
+
+		/* Every include is filled before any exclude, exclusion always wins */
+		for (i = 0; i < mask->polygon_count; i++) {
+			if (!mask->polygons[i].exclude)
+				__fill_row(&mask->polygons[i], row, width, height, line, 1);
+		}
+		for (i = 0; i < mask->polygon_count; i++) {
+			if (mask->polygons[i].exclude)
+				__fill_row(&mask->polygons[i], row, width, height, line, 0);
+		}
+
+		mask->row_start[row] = run_count;
+
+		for (x = 0; x < width; x++) {
+			unsigned int start = x;
+
+			if (!line[x])
+				continue;
+
+			while (x < width && line[x])
+				x++;
+
+			if (run_count == run_capacity) {
+				unsigned short *runs = realloc(mask->runs, sizeof(unsigned short) * 2 * run_capacity * 2);
+				goto_if(!runs, ERROR);
+				mask->runs = runs;
+				run_capacity *= 2;
+			}
+
+			mask->runs[2 * run_count] = start;
+			mask->runs[2 * run_count + 1] = x;
+			run_count++;
+		}
+	}
+	mask->row_start[height] = run_count;
+
+	mask->width = width;
+	mask->height = height;
+	free(line);
+
+	_D("mask compiled for [%u x %u], %u runs", width, height, run_count);
+
+	return 0;
+
+ERROR:
+	_E("failed to compile mask for [%u x %u]", width, height);
+	free(line);
+	__free_runs(mask);
+	return -1;
+}
+
+unsigned int controller_mv_mask_get_runs(controller_mv_mask_h mask, unsigned int row, const unsigned short **runs)
+{
+	if (!mask || !mask->row_start || row >= mask->height) {
+		*runs = NULL;
+		return 0;
+	}
+
+	*runs = mask->runs + 2 * mask->row_start[row];
+
+	return mask->row_start[row + 1] - mask->row_start[row];
+}
+
+unsigned int controller_mv_mask_get_coverage(controller_mv_mask_h mask, int x, int y, int width, int height)
+{
+	long long int covered = 0;
+	int row = 0;
+
+	retv_if(!mask || !mask->row_start, 100);
+	retv_if(width <= 0 || height <= 0, 0);
+
+	for (row = MAX(y, 0); row < MIN(y + height, (int)mask->height); row++) {
+		const unsigned short *runs = NULL;
+		unsigned int count = controller_mv_mask_get_runs(mask, row, &runs);
+		unsigned int i = 0;
+
+		for (i = 0; i < count; i++) {
+			int start = MAX((int)runs[2 * i], x);
+			int end = MIN((int)runs[2 * i + 1], x + width);
+
+			if (end > start)
+				covered += end - start;
+		}
+	}
+
+	return (unsigned int)(covered * 100 / ((long long int)width * height));
+}
+
+controller_mv_mask_h controller_mv_mask_create(const char *const *include, const char *const *exclude)
+{
+	struct __mv_mask_s *mask = NULL;
+
+	mask = calloc(1, sizeof(struct __mv_mask_s));
+	retvm_if(!mask, NULL, "failed to allocate mask");
+
+	if (__add_polygons(mask, include, 0) || __add_polygons(mask, exclude, 1)) {
+		free(mask);
+		return NULL;
+	}
+
+	return mask;
+}
+
+void controller_mv_mask_destroy(controller_mv_mask_h mask)
+{
+	if (!mask)
+		return;
+
+	__free_runs(mask);
+	free(mask);
+}
@@ -0,0 +1,327 @@
+ /*
+ * Copyright (c) 2018 Samsung Electronics Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "log.h"
+#include "controller.h"
+#include "controller_mv_engine.h"
+
+#ifndef CONTROLLER_MV_NO_MEDIA_VISION
+
+#include <mv_common.h>
+#include <mv_surveillance.h>
+
+/* mv_surveillance movement detection, regions come back through an event trigger */
+struct __mv_media_vision_s {
+	int video_stream_id;
+	mv_surveillance_event_trigger_h mv_trigger_handle;
+	unsigned int threshold; // of the subscribed trigger
+	controller_mv_regions_cb regions_cb;
+	void *regions_cb_data;
+
+	/* Scratch of MV_REGION_MAX regions, events never allocate */
+	mv_rectangle_s *mv_regions;
+	controller_mv_region_s *regions;
+
+	unsigned char *masked; // luma with the masked pixels blanked, masked_size bytes
+	unsigned int masked_size;
+};
+
+static const char *__mv_err_to_str(mv_error_e err)
+{
+	const char *err_str;
+	switch (err) {
+	case MEDIA_VISION_ERROR_NONE:
+		err_str = "MEDIA_VISION_ERROR_NONE";
+		break;
+	case MEDIA_VISION_ERROR_NOT_SUPPORTED:
+		err_str = "MEDIA_VISION_ERROR_NOT_SUPPORTED";
+		break;
+	case MEDIA_VISION_ERROR_MSG_TOO_LONG:
+		err_str = "MEDIA_VISION_ERROR_MSG_TOO_LONG";
+		break;
+	case MEDIA_VISION_ERROR_NO_DATA:
+		err_str = "MEDIA_VISION_ERROR_NO_DATA";
+		break;
+	case MEDIA_VISION_ERROR_KEY_NOT_AVAILABLE:
+		err_str = "MEDIA_VISION_ERROR_KEY_NOT_AVAILABLE";
+		break;
+	case MEDIA_VISION_ERROR_OUT_OF_MEMORY:
+		err_str = "MEDIA_VISION_ERROR_OUT_OF_MEMORY";
+		break;
+	case MEDIA_VISION_ERROR_INVALID_PARAMETER:
+		err_str = "MEDIA_VISION_ERROR_INVALID_PARAMETER";
+		break;
+	case MEDIA_VISION_ERROR_INVALID_OPERATION:
+		err_str = "MEDIA_VISION_ERROR_INVALID_OPERATION";
+		break;
+	case MEDIA_VISION_ERROR_PERMISSION_DENIED:
+		err_str = "MEDIA_VISION_ERROR_PERMISSION_DENIED";
+		break;
+	case MEDIA_VISION_ERROR_NOT_SUPPORTED_FORMAT:
+		err_str = "MEDIA_VISION_ERROR_NOT_SUPPORTED_FORMAT";
+		break;
+	case MEDIA_VISION_ERROR_INTERNAL:
+		err_str = "MEDIA_VISION_ERROR_INTERNAL";
+		break;
+	case MEDIA_VISION_ERROR_INVALID_DATA:
+		err_str = "MEDIA_VISION_ERROR_INVALID_DATA";
+		break;
+	case MEDIA_VISION_ERROR_INVALID_PATH:
+		err_str = "MEDIA_VISION_ERROR_INVALID_PATH";
+		break;
+	default:
+		err_str = "Unknown Error";
+		break;
+	}
+
+	return err_str;
+}
+
+static void __movement_detected_event_cb(mv_surveillance_event_trigger_h trigger, mv_source_h source, int video_stream_id, mv_surveillance_result_h event_result, void *data)
+{
+	struct __mv_media_vision_s *engine = data;
+	int ret = 0;
+	size_t i;
+	size_t move_regions_num = 0;
+
+	ret_if(!trigger);
+	ret_if(!event_result);
+	ret_if(!engine);
+
+	ret = mv_surveillance_get_result_value(event_result, MV_SURVEILLANCE_MOVEMENT_NUMBER_OF_REGIONS, &move_regions_num);
+	retm_if(ret, "failed to mv_surveillance_get_result_value for %s - [%s]", MV_SURVEILLANCE_MOVEMENT_NUMBER_OF_REGIONS, __mv_err_to_str(ret));
+
+	if (move_regions_num == 0)
+		return;
+
+	/* mv writes every region, an event that does not fit the scratch is dropped as a whole */
+	retm_if(move_regions_num > MV_REGION_MAX, "%zu regions, more than MV_REGION_MAX", move_regions_num);
+
+	ret = mv_surveillance_get_result_value(event_result, MV_SURVEILLANCE_MOVEMENT_REGIONS, engine->mv_regions);
+	retm_if(ret, "failed to mv_surveillance_get_result_value for %s - [%s]", MV_SURVEILLANCE_MOVEMENT_REGIONS, __mv_err_to_str(ret));
+
+	for (i = 0; i < move_regions_num; i++) {
+		engine->regions[i].x = engine->mv_regions[i].point.x;
+		engine->regions[i].y = engine->mv_regions[i].point.y;
+		engine->regions[i].width = engine->mv_regions[i].width;
+		engine->regions[i].height = engine->mv_regions[i].height;
+	}
+
+	engine->regions_cb(engine->regions, move_regions_num, engine->regions_cb_data);
+}
+
+/* mv cannot skip pixels, masked ones are blanked so they never change */
+static const unsigned char *__media_vision_apply_mask(struct __mv_media_vision_s *engine, const controller_mv_luma_s *luma)
+{
+	unsigned int size = luma->width * luma->height;
+	const unsigned short *runs = NULL;
+	unsigned int count = 0;
+	unsigned int row = 0;
+	unsigned int i = 0;
+
+	if (engine->masked_size != size) {
+		free(engine->masked);
+		engine->masked_size = 0;
+		engine->masked = malloc(size);
+		retvm_if(!engine->masked, NULL, "failed to allocate masked luma");
+		engine->masked_size = size;
+	}
+
+	memset(engine->masked, 0, size);
+
+	for (row = 0; row < luma->height; row++) {
+		unsigned int offset = row * luma->width;
+
+		count = controller_mv_mask_get_runs(luma->mask, row, &runs);
+		for (i = 0; i < count; i++)
+			memcpy(engine->masked + offset + runs[2 * i], luma->data + offset + runs[2 * i], runs[2 * i + 1] - runs[2 * i]);
+	}
+
+	return engine->masked;
+}
+
+static int __media_vision_push(void *data, const controller_mv_luma_s *luma)
+{
+	struct __mv_media_vision_s *engine = data;
+	const unsigned char *pixels = luma->data;
+	mv_source_h source = NULL;
+	int ret = 0;
+
+	/* A trigger that could not be rebuilt, controller_mv tries again with the next threshold */
+	if (!engine->mv_trigger_handle)
+		return -1;
+
+	if (luma->mask) {
+		pixels = __media_vision_apply_mask(engine, luma);
+		retv_if(!pixels, -1);
+	}
+
+	ret = mv_create_source(&source);
+	retvm_if(ret, -1, "failed to mv_create_source - [%s]", __mv_err_to_str(ret));
+
+	/* Movement detection only looks at luma, Y800 skips the chroma conversion inside mv */
+	ret = mv_source_fill_by_buffer(source, (unsigned char *)pixels, luma->width * luma->height,
+			luma->width, luma->height, MEDIA_VISION_COLORSPACE_Y800);
+	if (ret) {
+		_E("failed to fill source - %d", ret);
+		mv_destroy_source(source);
+		return -1;
+	}
+
+	/* The event callback runs inside the push */
+	ret = mv_surveillance_push_source(source, engine->video_stream_id);
+	if (ret)
+		_E("failed to mv_surveillance_push_source() - [%s]", __mv_err_to_str(ret));
+
+	mv_destroy_source(source);
+
+	return ret ? -1 : 0;
+}
+
+static void __media_vision_unsubscribe(struct __mv_media_vision_s *engine)
+{
+	if (!engine->mv_trigger_handle)
+		return;
+
+	mv_surveillance_unsubscribe_event_trigger(engine->mv_trigger_handle, engine->video_stream_id);
+	mv_surveillance_event_trigger_destroy(engine->mv_trigger_handle);
+	engine->mv_trigger_handle = NULL;
+}
+
+/* The threshold is part of the engine config, a new one takes a new trigger */
+static int __media_vision_subscribe(struct __mv_media_vision_s *engine, unsigned int threshold)
+{
+	int ret = 0;
+	mv_engine_config_h engine_cfg = NULL;
+
+	ret = mv_create_engine_config(&engine_cfg);
+	if (ret) {
+		_E("failed to subsmv_create_engine_configs() - %s", __mv_err_to_str(ret));
+		return -1;
+	}
+
+	mv_engine_config_set_int_attribute(engine_cfg, MV_SURVEILLANCE_MOVEMENT_DETECTION_THRESHOLD, threshold);
+
+	ret = mv_surveillance_event_trigger_create(MV_SURVEILLANCE_EVENT_TYPE_MOVEMENT_DETECTED, &engine->mv_trigger_handle);
+	if (ret) {
+		_E("failed to mv_surveillance_event_trigger_create - [%s]", __mv_err_to_str(ret));
+		goto ERROR;
+	}
+
+	ret = mv_surveillance_subscribe_event_trigger(engine->mv_trigger_handle, engine->video_stream_id, engine_cfg, __movement_detected_event_cb, engine);
+	if (ret) {
+		_E("failed to subscribe %s - %s", MV_SURVEILLANCE_EVENT_TYPE_MOVEMENT_DETECTED, __mv_err_to_str(ret));
+		goto ERROR;
+	}
+
+	mv_destroy_engine_config(engine_cfg);
+	engine->threshold = threshold;
+
+	return 0;
+
+ERROR:
+	mv_destroy_engine_config(engine_cfg);
+
+	if (engine->mv_trigger_handle) {
+		mv_surveillance_event_trigger_destroy(engine->mv_trigger_handle);
+		engine->mv_trigger_handle = NULL;
+	}
+
+	return -1;
+}
+
+static int __media_vision_set_threshold(void *data, unsigned int threshold)
+{
+	struct __mv_media_vision_s *engine = data;
+
+	retv_if(!engine, -1);
+
+	/* Pushes come from this thread only, none is in flight. mv learns the scene again */
+	__media_vision_unsubscribe(engine);
+
+	if (!__media_vision_subscribe(engine, threshold))
+		return 0;
+
+	/* Without a trigger every push fails, detection goes on with the old threshold */
+	if (__media_vision_subscribe(engine, engine->threshold))
+		_E("failed to restore threshold %u, detection is off", engine->threshold);
+
+	return -1;
+}
+
+static void __media_vision_destroy(void *data)
+{
+	struct __mv_media_vision_s *engine = data;
+
+	if (engine == NULL)
+		return;
+
+	__media_vision_unsubscribe(engine);
+
+	free(engine->mv_regions);
+	free(engine->regions);
+	free(engine->masked);
+	free(engine);
+}
+
+static void *__media_vision_create(int video_stream_id, controller_mv_regions_cb regions_cb, void *user_data)
+{
+	struct __mv_media_vision_s *engine = NULL;
+
+	engine = malloc(sizeof(struct __mv_media_vision_s));
+	if (engine == NULL) {
+		_E("Failed to allocate media vision data");
+		return NULL;
+	}
+	memset(engine, 0, sizeof(struct __mv_media_vision_s));
+	engine->video_stream_id = video_stream_id;
+
+	engine->mv_regions = malloc(sizeof(mv_rectangle_s) * MV_REGION_MAX);
+	engine->regions = malloc(sizeof(controller_mv_region_s) * MV_REGION_MAX);
+	if (!engine->mv_regions || !engine->regions) {
+		_E("Failed to allocate region scratch");
+		goto ERROR;
+	}
+
+	/* The callback is set before subscribing, a stream may already be pushing */
+	engine->regions_cb = regions_cb;
+	engine->regions_cb_data = user_data;
+
+	if (__media_vision_subscribe(engine, MV_MOVEMENT_DETECTION_THRESHOLD))
+		goto ERROR;
+
+	return engine;
+
+ERROR:
+	free(engine->mv_regions);
+	free(engine->regions);
+	free(engine);
+
+	return NULL;
+}
+
+const controller_mv_engine_s controller_mv_engine_media_vision = {
+	.name = "media_vision",
+	.create = __media_vision_create,
+	.push = __media_vision_push,
+	.destroy = __media_vision_destroy,
+	.reset = NULL, // mv keeps its own model
+	.set_threshold = __media_vision_set_threshold,
+};
+
+#endif /* !CONTROLLER_MV_NO_MEDIA_VISION */
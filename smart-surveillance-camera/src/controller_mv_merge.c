@@ -0,0 +1,174 @@
+ /*
+ * Copyright (c) 2018 Samsung Electronics Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <stdlib.h>
+#include <glib.h>
+#include "log.h"
+#include "controller.h"
+#include "controller_mv_merge.h"
+
+typedef struct {
+	int x;
+	unsigned short index;
+} merge_key_s;
+
+struct __mv_merge_s {
+	merge_key_s *keys; // regions in x order
+	unsigned short *parent; // union-find forest over the region indices
+	short *cluster; // output slot of every root, -1 for none yet
+	controller_mv_region_s *merged;
+};
+
+static int __compare_key(const void *a, const void *b)
+{
+	return ((const merge_key_s *)a)->x - ((const merge_key_s *)b)->x;
+}
+
+static unsigned short __find_root(unsigned short *parent, unsigned short index)
+{
+	/* Path halving, trees stay flat without recursion */
+	while (parent[index] != index) {
+		parent[index] = parent[parent[index]];
+		index = parent[index];
+	}
+
+	return index;
+}
+
+/* Gap between two spans, minus the overlap when they overlap */
+static int __span_gap(int start, int length, int other_start, int other_length)
+{
+	return MAX(start, other_start) - MIN(start + length, other_start + other_length);
+}
+
+static int __is_together(const controller_mv_region_s *a, const controller_mv_region_s *b, int gap, unsigned int iou)
+{
+	int gap_x = __span_gap(a->x, a->width, b->x, b->width);
+	int gap_y = __span_gap(a->y, a->height, b->y, b->height);
+	long long int intersection = 0;
+	long long int sum = 0;
+
+	if (gap >= 0 && gap_x <= gap && gap_y <= gap)
+		return 1;
+
+	if (iou == 0 || gap_x >= 0 || gap_y >= 0)
+		return 0;
+
+	/* intersection / (area a + area b - intersection) >= iou percent, without dividing */
+	intersection = (long long int)gap_x * gap_y;
+	sum = (long long int)a->width * a->height + (long long int)b->width * b->height;
+
+	return intersection * (100 + iou) >= sum * iou;
+}
+
+unsigned int controller_mv_merge_regions(controller_mv_merge_h merge, controller_mv_region_s *regions, unsigned int count,
+	int gap, unsigned int iou)
+{
+	unsigned int cluster_count = 0;
+	unsigned int i = 0;
+	unsigned int j = 0;
+
+	retv_if(!regions, 0);
+
+	if (!merge || count < 2 || (gap < 0 && iou == 0))
+		return count;
+
+	count = MIN(count, MV_REGION_MAX);
+	for (i = 0; i < count; i++) {
+		merge->keys[i].x = regions[i].x;
+		merge->keys[i].index = i;
+		merge->parent[i] = i;
+		merge->cluster[i] = -1;
+	}
+	qsort(merge->keys, count, sizeof(merge_key_s), __compare_key);
+
+	/* Every region only looks right, up to where its gap ends */
+	for (i = 0; i < count; i++) {
+		const controller_mv_region_s *region = &regions[merge->keys[i].index];
+		int reach = region->x + region->width + MAX(gap, 0);
+
+		for (j = i + 1; j < count && merge->keys[j].x <= reach; j++) {
+			unsigned short root = 0;
+			unsigned short other_root = 0;
+
+			if (!__is_together(region, &regions[merge->keys[j].index], gap, iou))
+				continue;
+
+			root = __find_root(merge->parent, merge->keys[i].index);
+			other_root = __find_root(merge->parent, merge->keys[j].index);
+			if (root != other_root)
+				merge->parent[other_root] = root;
+		}
+	}
+
+	/* Bounding box of every cluster, in the order the clusters first show up */
+	for (i = 0; i < count; i++) {
+		unsigned short root = __find_root(merge->parent, i);
+		controller_mv_region_s *box = NULL;
+		int right = 0;
+		int bottom = 0;
+
+		if (merge->cluster[root] < 0) {
+			merge->cluster[root] = cluster_count;
+			merge->merged[cluster_count++] = regions[i];
+			continue;
+		}
+
+		box = &merge->merged[merge->cluster[root]];
+		right = MAX(box->x + box->width, regions[i].x + regions[i].width);
+		bottom = MAX(box->y + box->height, regions[i].y + regions[i].height);
+		box->x = MIN(box->x, regions[i].x);
+		box->y = MIN(box->y, regions[i].y);
+		box->width = right - box->x;
+		box->height = bottom - box->y;
+	}
+
+	for (i = 0; i < cluster_count; i++)
+		regions[i] = merge->merged[i];
+
+	return cluster_count;
+}
+
+controller_mv_merge_h controller_mv_merge_create(void)
+{
+	struct __mv_merge_s *merge = NULL;
+
+	merge = calloc(1, sizeof(struct __mv_merge_s));
+	retvm_if(!merge, NULL, "failed to allocate region merge");
+
+	merge->keys = malloc(sizeof(merge_key_s) * MV_REGION_MAX);
+	merge->parent = malloc(sizeof(unsigned short) * MV_REGION_MAX);
+	merge->cluster = malloc(sizeof(short) * MV_REGION_MAX);
+	merge->merged = malloc(sizeof(controller_mv_region_s) * MV_REGION_MAX);
+	if (!merge->keys || !merge->parent || !merge->cluster || !merge->merged) {
+		_E("failed to allocate region merge scratch");
+		controller_mv_merge_destroy(merge);
+		return NULL;
+	}
+
+	return merge;
+}
+
+void controller_mv_merge_destroy(controller_mv_merge_h merge)
+{
+	if (!merge)
+		return;
+
+	free(merge->keys);
+	free(merge->parent);
+	free(merge->cluster);
+	free(merge->merged);
+	free(merge);
+}
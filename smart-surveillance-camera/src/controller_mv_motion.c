@@ -0,0 +1,531 @@
+ /*
+ * Copyright (c) 2018 Samsung Electronics Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "log.h"
+#include "controller.h"
+#include "controller_mv_engine.h"
+#include "image_kernel.h"
+
+/*
+ * Background subtraction on the luma plane:
+ * |frame - background| > threshold, opened with a 3 x 3 erode + dilate,
+ * then grouped into blobs of 8-connected cells.
+ * The background is a running average in 8.8 fixed point. It learns slower when the scene is busy
+ * and much slower under moving pixels, so a walker does not melt into it. It is relearnt after a reset
+ * and moved along with the view while the camera turns.
+ * A moving pixel that keeps its value for MOTION_STILL_FRAMES is no movement: the ghost of an object
+ * that was in the background and left, or one that stopped. It is not reported and learnt at the background rate,
+ * the frame to frame change tells it from the inside of an object that is still moving.
+ */
+
+#define MOTION_LEARNING_SHIFT_CALM 5 // background moves 1/2^shift of the way to every frame
+#define MOTION_LEARNING_SHIFT_BUSY 7
+#define MOTION_ACTIVITY_CALM 10 // moving pixels per mille, averaged over frames
+#define MOTION_ACTIVITY_BUSY 100
+#define MOTION_FOREGROUND_SHIFT_EXTRA 2 // moving pixels learn 2^extra times slower
+#define MOTION_STILL_FRAMES 15 // frames a moving pixel keeps its value before it counts as background
+#define MOTION_WARMUP_FRAMES 8 // frames after a reset that learn at 1/2, nothing is reported meanwhile
+#define MOTION_CELL_SIZE 8 // blobs are found on a grid of MOTION_CELL_SIZE x MOTION_CELL_SIZE pixel cells
+#define MOTION_CELL_MIN_PIXELS 16 // moving pixels that make a cell part of a blob
+
+struct __mv_motion_s {
+	controller_mv_regions_cb regions_cb;
+	void *regions_cb_data;
+	controller_mv_region_s *regions; // MV_REGION_MAX, filled by every push
+
+	/* Everything below is sized for width x height, reallocated when the frame size changes */
+	unsigned int width;
+	unsigned int height;
+	int background_valid;
+	unsigned int warmup_frames;
+	unsigned int activity; // moving pixels per mille of the analysed ones
+	unsigned char threshold;
+	int shift_x; // view shift for the next push
+	int shift_y;
+
+	unsigned short *background; // 8.8 fixed point
+	unsigned char *mask;
+	unsigned char *morph;
+	unsigned char *tmp;
+	unsigned char *previous; // luma of the previous push
+	unsigned char *still; // frames a pixel has been moving with the same value, up to MOTION_STILL_FRAMES
+
+	unsigned int cell_columns;
+	unsigned int cell_rows;
+	unsigned char *cells; // moving pixels per cell
+	unsigned int *stack; // flood fill, one entry per cell at most
+};
+
+static void __motion_free_buffers(struct __mv_motion_s *engine)
+{
+	free(engine->background);
+	free(engine->mask);
+	free(engine->morph);
+	free(engine->tmp);
+	free(engine->previous);
+	free(engine->still);
+	free(engine->cells);
+	free(engine->stack);
+
+	engine->background = NULL;
+	engine->mask = NULL;
+	engine->morph = NULL;
+	engine->tmp = NULL;
+	engine->previous = NULL;
+	engine->still = NULL;
+	engine->cells = NULL;
+	engine->stack = NULL;
+	engine->background_valid = 0;
+}
+
+static int __motion_alloc_buffers(struct __mv_motion_s *engine, unsigned int width, unsigned int height)
+{
+	unsigned int pixels = width * height;
+
+	/* Kept on failure too, the next frame of the same size does not retry */
+	__motion_free_buffers(engine);
+	engine->width = width;
+	engine->height = height;
+
+	engine->cell_columns = (width + MOTION_CELL_SIZE - 1) / MOTION_CELL_SIZE;
+	engine->cell_rows = (height + MOTION_CELL_SIZE - 1) / MOTION_CELL_SIZE;
+
+	engine->background = malloc(sizeof(unsigned short) * pixels);
+	engine->mask = malloc(pixels);
+	engine->morph = malloc(pixels);
+	engine->tmp = malloc(pixels);
+	engine->previous = malloc(pixels);
+	engine->still = malloc(pixels);
+	engine->cells = malloc(engine->cell_columns * engine->cell_rows);
+	engine->stack = malloc(sizeof(unsigned int) * engine->cell_columns * engine->cell_rows);
+	goto_if(!engine->background || !engine->mask || !engine->morph || !engine->tmp, ERROR);
+	goto_if(!engine->previous || !engine->still, ERROR);
+	goto_if(!engine->cells || !engine->stack, ERROR);
+
+	_D("motion analysis at [%u x %u], %s kernels", width, height, image_kernel_get_backend());
+
+	return 0;
+
+ERROR:
+	_E("failed to allocate motion buffers for [%u x %u]", width, height);
+	__motion_free_buffers(engine);
+	return -1;
+}
+
+/* Moving pixels that stopped changing are taken out of the mask, restart after the view moved */
+static void __motion_drop_still(struct __mv_motion_s *engine, const controller_mv_luma_s *luma, int restart)
+{
+	unsigned int pixels = engine->width * engine->height;
+	unsigned int i = 0;
+
+	if (restart) {
+		memset(engine->still, 0, pixels);
+	} else {
+		for (i = 0; i < pixels; i++) {
+			int change = luma->data[i] - engine->previous[i];
+
+			if (!engine->mask[i] || abs(change) > engine->threshold)
+				engine->still[i] = 0;
+			else if (engine->still[i] < MOTION_STILL_FRAMES)
+				engine->still[i]++;
+			else
+				engine->mask[i] = 0;
+		}
+	}
+
+	memcpy(engine->previous, luma->data, pixels);
+}
+
+/* Returns the moving pixels of the frame */
+static unsigned int __motion_count_cells(struct __mv_motion_s *engine)
+{
+	const unsigned char *row = engine->mask;
+	unsigned char *cell_row = NULL;
+	unsigned int total = 0;
+	unsigned int x, y;
+
+	memset(engine->cells, 0, engine->cell_columns * engine->cell_rows);
+
+	for (y = 0; y < engine->height; y++) {
+		cell_row = engine->cells + (y / MOTION_CELL_SIZE) * engine->cell_columns;
+		for (x = 0; x < engine->width; x++)
+			cell_row[x / MOTION_CELL_SIZE] += row[x] & 1;
+		row += engine->width;
+	}
+
+	for (x = 0; x < engine->cell_columns * engine->cell_rows; x++)
+		total += engine->cells[x];
+
+	return total;
+}
+
+/* Bounding boxes of 8-connected groups of moving cells, cells are cleared as they are taken */
+static unsigned int __motion_extract_blobs(struct __mv_motion_s *engine,
+	controller_mv_region_s *regions, unsigned int regions_max)
+{
+	unsigned int columns = engine->cell_columns;
+	unsigned int rows = engine->cell_rows;
+	unsigned int count = 0;
+	unsigned int start, top, cell;
+	unsigned int cx, cy, min_x, min_y, max_x, max_y;
+	int dx, dy;
+
+	for (start = 0; start < columns * rows && count < regions_max; start++) {
+		if (engine->cells[start] < MOTION_CELL_MIN_PIXELS)
+			continue;
+
+		engine->cells[start] = 0;
+		engine->stack[0] = start;
+		top = 1;
+		min_x = max_x = start % columns;
+		min_y = max_y = start / columns;
+
+		while (top > 0) {
+			cell = engine->stack[--top];
+			cx = cell % columns;
+			cy = cell / columns;
+
+			if (cx < min_x)
+				min_x = cx;
+			if (cx > max_x)
+				max_x = cx;
+			if (cy < min_y)
+				min_y = cy;
+			if (cy > max_y)
+				max_y = cy;
+
+			for (dy = -1; dy <= 1; dy++) {
+				for (dx = -1; dx <= 1; dx++) {
+					int nx = (int)cx + dx;
+					int ny = (int)cy + dy;
+					unsigned int neighbour;
+
+					if (nx < 0 || ny < 0 || nx >= (int)columns || ny >= (int)rows)
+						continue;
+
+					neighbour = ny * columns + nx;
+					if (engine->cells[neighbour] < MOTION_CELL_MIN_PIXELS)
+						continue;
+
+					/* Cleared on push, so a cell is on the stack once at most */
+					engine->cells[neighbour] = 0;
+					engine->stack[top++] = neighbour;
+				}
+			}
+		}
+
+		regions[count].x = min_x * MOTION_CELL_SIZE;
+		regions[count].y = min_y * MOTION_CELL_SIZE;
+		regions[count].width = (max_x + 1) * MOTION_CELL_SIZE - regions[count].x;
+		regions[count].height = (max_y + 1) * MOTION_CELL_SIZE - regions[count].y;
+
+		/* The last column and row of cells may hang over the frame */
+		if (regions[count].x + regions[count].width > (int)engine->width)
+			regions[count].width = engine->width - regions[count].x;
+		if (regions[count].y + regions[count].height > (int)engine->height)
+			regions[count].height = engine->height - regions[count].y;
+
+		count++;
+	}
+
+	return count;
+}
+
+/* Only the runs of the mask are differenced, masked pixels never move */
+static void __motion_difference_masked(struct __mv_motion_s *engine, const controller_mv_luma_s *luma)
+{
+	const unsigned short *runs = NULL;
+	unsigned int offset = 0;
+	unsigned int count = 0;
+	unsigned int row = 0;
+	unsigned int i = 0;
+
+	memset(engine->mask, 0, engine->width * engine->height);
+
+	for (row = 0; row < engine->height; row++) {
+		count = controller_mv_mask_get_runs(luma->mask, row, &runs);
+		for (i = 0; i < count; i++) {
+			offset = row * engine->width + runs[2 * i];
+			image_kernel_background_diff(luma->data + offset, engine->background + offset, engine->mask + offset,
+				runs[2 * i + 1] - runs[2 * i], engine->threshold);
+		}
+	}
+}
+
+/* The background of masked pixels is left as it is */
+static void __motion_update_masked(struct __mv_motion_s *engine, const controller_mv_luma_s *luma,
+	unsigned int background_shift, unsigned int foreground_shift)
+{
+	const unsigned short *runs = NULL;
+	unsigned int offset = 0;
+	unsigned int count = 0;
+	unsigned int row = 0;
+	unsigned int i = 0;
+
+	for (row = 0; row < engine->height; row++) {
+		count = controller_mv_mask_get_runs(luma->mask, row, &runs);
+		for (i = 0; i < count; i++) {
+			offset = row * engine->width + runs[2 * i];
+			image_kernel_background_update(engine->background + offset, luma->data + offset, engine->mask + offset,
+				runs[2 * i + 1] - runs[2 * i], background_shift, foreground_shift);
+		}
+	}
+}
+
+static unsigned int __motion_count_analysed(const controller_mv_luma_s *luma)
+{
+	const unsigned short *runs = NULL;
+	unsigned int analysed = 0;
+	unsigned int count = 0;
+	unsigned int row = 0;
+	unsigned int i = 0;
+
+	if (!luma->mask)
+		return luma->width * luma->height;
+
+	for (row = 0; row < luma->height; row++) {
+		count = controller_mv_mask_get_runs(luma->mask, row, &runs);
+		for (i = 0; i < count; i++)
+			analysed += runs[2 * i + 1] - runs[2 * i];
+	}
+
+	return analysed;
+}
+
+/* Learning slows down as the scene gets busier */
+static unsigned int __motion_learning_shift(struct __mv_motion_s *engine, const controller_mv_luma_s *luma,
+	unsigned int moving)
+{
+	unsigned int analysed = __motion_count_analysed(luma);
+	unsigned int current = 0;
+
+	if (analysed > 0)
+		current = (unsigned int)((unsigned long long int)moving * 1000 / analysed);
+	engine->activity = (engine->activity * 7 + current) / 8;
+
+	if (engine->activity < MOTION_ACTIVITY_CALM)
+		return MOTION_LEARNING_SHIFT_CALM;
+	if (engine->activity < MOTION_ACTIVITY_BUSY)
+		return MOTION_LEARNING_SHIFT_CALM + 1;
+
+	return MOTION_LEARNING_SHIFT_BUSY;
+}
+
+/* background(x, y) = background(x - dx, y - dy), what comes into view is taken from luma as it is */
+static void __motion_shift_background(struct __mv_motion_s *engine, const controller_mv_luma_s *luma)
+{
+	int width = engine->width;
+	int height = engine->height;
+	int dx = engine->shift_x;
+	int dy = engine->shift_y;
+	int y = 0;
+	int i = 0;
+
+	engine->shift_x = 0;
+	engine->shift_y = 0;
+
+	if (dx == 0 && dy == 0)
+		return;
+
+	/* Rows are moved in the order that never overwrites a source row still to come */
+	for (i = 0; i < height; i++) {
+		unsigned short *row = NULL;
+		const unsigned char *data = NULL;
+		int x = 0;
+
+		y = dy > 0 ? height - 1 - i : i;
+		row = engine->background + y * width;
+		data = luma->data + y * width;
+
+		if (y - dy < 0 || y - dy >= height || abs(dx) >= width) {
+			for (x = 0; x < width; x++)
+				row[x] = data[x] << 8;
+			continue;
+		}
+
+		if (dx >= 0) {
+			memmove(row + dx, engine->background + (y - dy) * width, sizeof(unsigned short) * (width - dx));
+			for (x = 0; x < dx; x++)
+				row[x] = data[x] << 8;
+		} else {
+			memmove(row, engine->background + (y - dy) * width - dx, sizeof(unsigned short) * (width + dx));
+			for (x = width + dx; x < width; x++)
+				row[x] = data[x] << 8;
+		}
+	}
+}
+
+static int __motion_push(void *data, const controller_mv_luma_s *luma)
+{
+	struct __mv_motion_s *engine = data;
+	unsigned int region_count = 0;
+	unsigned int pixels = 0;
+	unsigned int moving = 0;
+	unsigned int background_shift = 0;
+	unsigned int foreground_shift = 0;
+	unsigned int i = 0;
+	int turned = 0;
+
+	retv_if(!engine, -1);
+	retv_if(!luma || !luma->data, -1);
+
+	if (luma->width != engine->width || luma->height != engine->height) {
+		if (__motion_alloc_buffers(engine, luma->width, luma->height))
+			return -1;
+	}
+
+	if (!engine->background)
+		return -1;
+
+	pixels = engine->width * engine->height;
+
+	if (!engine->background_valid) {
+		for (i = 0; i < pixels; i++)
+			engine->background[i] = luma->data[i] << 8;
+		memcpy(engine->previous, luma->data, pixels);
+		memset(engine->still, 0, pixels);
+		engine->background_valid = 1;
+		engine->activity = 0;
+		engine->shift_x = 0;
+		engine->shift_y = 0;
+		return 0;
+	}
+
+	turned = engine->shift_x || engine->shift_y;
+	__motion_shift_background(engine, luma);
+
+	if (luma->mask)
+		__motion_difference_masked(engine, luma);
+	else
+		image_kernel_background_diff(luma->data, engine->background, engine->mask, pixels, engine->threshold);
+
+	/* Opening drops sensor noise and thin edges of slow lighting changes */
+	image_kernel_erode_3x3(engine->mask, engine->morph, engine->tmp, engine->width, engine->height);
+	image_kernel_dilate_3x3(engine->morph, engine->mask, engine->tmp, engine->width, engine->height);
+
+	__motion_drop_still(engine, luma, turned);
+
+	moving = __motion_count_cells(engine);
+
+	if (engine->warmup_frames > 0) {
+		/* A fresh scene after a reset, learnt quickly and not reported */
+		background_shift = 1;
+		foreground_shift = 1;
+		engine->warmup_frames--;
+	} else {
+		background_shift = __motion_learning_shift(engine, luma, moving);
+		foreground_shift = background_shift + MOTION_FOREGROUND_SHIFT_EXTRA;
+		if (foreground_shift > 8)
+			foreground_shift = 8;
+	}
+
+	if (luma->mask)
+		__motion_update_masked(engine, luma, background_shift, foreground_shift);
+	else
+		image_kernel_background_update(engine->background, luma->data, engine->mask, pixels, background_shift, foreground_shift);
+
+	if (background_shift == 1)
+		return 0;
+
+	region_count = __motion_extract_blobs(engine, engine->regions, MV_REGION_MAX);
+
+	if (region_count > 0)
+		engine->regions_cb(engine->regions, region_count, engine->regions_cb_data);
+
+	return 0;
+}
+
+static void __motion_destroy(void *data)
+{
+	struct __mv_motion_s *engine = data;
+
+	if (engine == NULL)
+		return;
+
+	__motion_free_buffers(engine);
+	free(engine->regions);
+	free(engine);
+}
+
+static void __motion_reset(void *data)
+{
+	struct __mv_motion_s *engine = data;
+
+	ret_if(!engine);
+
+	/* The next frame seeds the background */
+	engine->background_valid = 0;
+	engine->shift_x = 0;
+	engine->shift_y = 0;
+	engine->warmup_frames = MOTION_WARMUP_FRAMES;
+}
+
+static int __motion_set_threshold(void *data, unsigned int threshold)
+{
+	struct __mv_motion_s *engine = data;
+
+	retv_if(!engine, -1);
+	retv_if(threshold > 255, -1);
+
+	engine->threshold = threshold;
+
+	return 0;
+}
+
+static void __motion_shift(void *data, int dx, int dy)
+{
+	struct __mv_motion_s *engine = data;
+
+	ret_if(!engine);
+
+	/* Applied by the next push, it has the luma of what comes into view */
+	engine->shift_x += dx;
+	engine->shift_y += dy;
+}
+
+static void *__motion_create(int video_stream_id, controller_mv_regions_cb regions_cb, void *user_data)
+{
+	struct __mv_motion_s *engine = NULL;
+
+	engine = calloc(1, sizeof(struct __mv_motion_s));
+	retvm_if(!engine, NULL, "failed to allocate motion engine");
+
+	engine->regions = malloc(sizeof(controller_mv_region_s) * MV_REGION_MAX);
+	if (!engine->regions) {
+		_E("failed to allocate motion regions");
+		free(engine);
+		return NULL;
+	}
+
+	/* Buffers follow the first frame, the stream id has no meaning here */
+	engine->regions_cb = regions_cb;
+	engine->regions_cb_data = user_data;
+	engine->threshold = MV_MOVEMENT_DETECTION_THRESHOLD;
+
+	return engine;
+}
+
+const controller_mv_engine_s controller_mv_engine_motion = {
+	.name = "motion",
+	.create = __motion_create,
+	.push = __motion_push,
+	.destroy = __motion_destroy,
+	.reset = __motion_reset,
+	.set_threshold = __motion_set_threshold,
+	.shift = __motion_shift,
+};
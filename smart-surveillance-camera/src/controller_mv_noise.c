@@ -0,0 +1,245 @@
+ /*
+ * Copyright (c) 2018 Samsung Electronics Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <glib.h>
+#include "log.h"
+#include "controller_mv_noise.h"
+
+#define NOISE_GRID_STEP 4 // one pixel out of NOISE_GRID_STEP x NOISE_GRID_STEP is sampled
+#define NOISE_BAND_SHIFT 5 // brightness bands of 32 levels
+#define NOISE_BAND_COUNT (256 >> NOISE_BAND_SHIFT)
+#define NOISE_DIFF_BINS 64 // larger differences share the last bin, they are motion anyway
+#define NOISE_BAND_SAMPLES_MIN 500 // a band with fewer samples in a window is left out
+#define NOISE_BAND_SHARE_MIN 5 // percent of the window, a band only a moving object fills is no noise sample
+#define NOISE_CALIBRATION_MS 3000
+#define NOISE_WINDOW_MS 30000
+#define NOISE_THRESHOLD_SIGMAS 5.0 // a moving pixel is this many noise sigmas off
+#define NOISE_THRESHOLD_MIN 8
+#define NOISE_THRESHOLD_MAX 100
+
+struct __mv_noise_s {
+	unsigned int histograms[NOISE_BAND_COUNT][NOISE_DIFF_BINS]; // |frame - previous| per band of previous
+	unsigned int band_samples[NOISE_BAND_COUNT];
+	long long int window_started_us; // 0 until a frame was compared
+	int calibrated;
+	unsigned int threshold;
+
+	/* Grid of the previous frame, reallocated when the luma size changes */
+	unsigned int width;
+	unsigned int height;
+	unsigned int columns;
+	unsigned int rows;
+	unsigned char *previous;
+	int previous_valid;
+};
+
+static void __clear_window(struct __mv_noise_s *noise)
+{
+	memset(noise->histograms, 0, sizeof(noise->histograms));
+	memset(noise->band_samples, 0, sizeof(noise->band_samples));
+	noise->window_started_us = 0;
+}
+
+static double __band_median(const unsigned int *histogram, unsigned int samples)
+{
+	double half = samples / 2.0;
+	double seen = 0.0;
+	int bin = 0;
+
+	for (bin = 0; bin < NOISE_DIFF_BINS; bin++) {
+		if (seen + histogram[bin] >= half) {
+			/* Bin b stands for [b - 0.5, b + 0.5), 0 for [0, 0.5) */
+			double fraction = (half - seen) / histogram[bin];
+
+			return bin == 0 ? fraction * 0.5 : bin - 0.5 + fraction;
+		}
+		seen += histogram[bin];
+	}
+
+	return NOISE_DIFF_BINS;
+}
+
+/* Returns 0 when no band has enough samples */
+static unsigned int __estimate_threshold(struct __mv_noise_s *noise)
+{
+	double median = -1.0;
+	double sigma = 0.0;
+	unsigned int samples = 0;
+	int band = 0;
+
+	for (band = 0; band < NOISE_BAND_COUNT; band++)
+		samples += noise->band_samples[band];
+
+	for (band = 0; band < NOISE_BAND_COUNT; band++) {
+		double band_median = 0.0;
+
+		if (noise->band_samples[band] < NOISE_BAND_SAMPLES_MIN
+				|| noise->band_samples[band] * 100ULL < samples * (unsigned long long)NOISE_BAND_SHARE_MIN)
+			continue;
+
+		band_median = __band_median(noise->histograms[band], noise->band_samples[band]);
+		if (band_median > median)
+			median = band_median;
+	}
+
+	if (median < 0.0)
+		return 0;
+
+	/* A frame difference has sqrt(2) sigma, its absolute value a median of 0.6745 times that */
+	sigma = median / (0.6745 * M_SQRT2);
+
+	return (unsigned int)CLAMP(ceil(NOISE_THRESHOLD_SIGMAS * sigma), NOISE_THRESHOLD_MIN, NOISE_THRESHOLD_MAX);
+}
+
+static int __alloc_grid(struct __mv_noise_s *noise, unsigned int width, unsigned int height)
+{
+	free(noise->previous);
+	noise->width = width;
+	noise->height = height;
+	noise->columns = (width + NOISE_GRID_STEP - 1) / NOISE_GRID_STEP;
+	noise->rows = (height + NOISE_GRID_STEP - 1) / NOISE_GRID_STEP;
+	noise->previous = malloc(noise->columns * noise->rows);
+	noise->previous_valid = 0;
+	__clear_window(noise);
+
+	retvm_if(!noise->previous, -1, "failed to allocate noise grid for [%u x %u]", width, height);
+
+	return 0;
+}
+
+/* Compares the grid of luma with the previous one, only the pixels the mask lets through are counted */
+static void __sample(struct __mv_noise_s *noise, const controller_mv_luma_s *luma)
+{
+	const unsigned short *runs = NULL;
+	unsigned int run_count = 0;
+	unsigned int run = 0;
+	unsigned int row = 0;
+	unsigned int column = 0;
+
+	for (row = 0; row < noise->rows; row++) {
+		const unsigned char *line = luma->data + row * NOISE_GRID_STEP * luma->width;
+		unsigned char *previous = noise->previous + row * noise->columns;
+
+		if (luma->mask)
+			run_count = controller_mv_mask_get_runs(luma->mask, row * NOISE_GRID_STEP, &runs);
+		run = 0;
+
+		for (column = 0; column < noise->columns; column++) {
+			unsigned int x = column * NOISE_GRID_STEP;
+			unsigned char value = line[x];
+
+			if (luma->mask) {
+				while (run < run_count && runs[2 * run + 1] <= x)
+					run++;
+			}
+
+			if (noise->previous_valid && (!luma->mask || (run < run_count && runs[2 * run] <= x))) {
+				unsigned int band = previous[column] >> NOISE_BAND_SHIFT;
+				unsigned int diff = abs((int)value - (int)previous[column]);
+
+				noise->histograms[band][MIN(diff, NOISE_DIFF_BINS - 1)]++;
+				noise->band_samples[band]++;
+			}
+
+			previous[column] = value;
+		}
+	}
+}
+
+int controller_mv_noise_push(controller_mv_noise_h noise, const controller_mv_luma_s *luma, long long int time_us)
+{
+	long long int window_ms = 0;
+	unsigned int threshold = 0;
+
+	/* NULL for a fixed threshold */
+	if (!noise)
+		return 0;
+	retv_if(!luma || !luma->data, 0);
+
+	if (luma->width != noise->width || luma->height != noise->height) {
+		if (__alloc_grid(noise, luma->width, luma->height))
+			return 0;
+	}
+
+	if (!noise->previous)
+		return 0;
+
+	__sample(noise, luma);
+
+	if (!noise->previous_valid) {
+		noise->previous_valid = 1;
+		return 0;
+	}
+
+	if (noise->window_started_us == 0)
+		noise->window_started_us = time_us;
+
+	window_ms = noise->calibrated ? NOISE_WINDOW_MS : NOISE_CALIBRATION_MS;
+	if (time_us - noise->window_started_us < window_ms * 1000)
+		return 0;
+
+	threshold = __estimate_threshold(noise);
+	__clear_window(noise);
+
+	if (threshold == 0) {
+		_D("too few samples for a noise estimate");
+		return 0;
+	}
+
+	noise->threshold = threshold;
+	noise->calibrated = 1;
+
+	return 1;
+}
+
+unsigned int controller_mv_noise_get_threshold(controller_mv_noise_h noise)
+{
+	retv_if(!noise, 0);
+
+	return noise->threshold;
+}
+
+void controller_mv_noise_reset(controller_mv_noise_h noise)
+{
+	if (!noise)
+		return;
+
+	/* The estimate so far stays, the sensor did not change */
+	noise->previous_valid = 0;
+	__clear_window(noise);
+}
+
+controller_mv_noise_h controller_mv_noise_create(void)
+{
+	struct __mv_noise_s *noise = NULL;
+
+	noise = calloc(1, sizeof(struct __mv_noise_s));
+	retvm_if(!noise, NULL, "failed to allocate noise estimate");
+
+	return noise;
+}
+
+void controller_mv_noise_destroy(controller_mv_noise_h noise)
+{
+	if (!noise)
+		return;
+
+	free(noise->previous);
+	free(noise);
+}
@@ -0,0 +1,385 @@
+ /*
+ * Copyright (c) 2018 Samsung Electronics Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <glib.h>
+#include "log.h"
+#include "controller.h"
+#include "controller_tracker.h"
+#include "controller_classifier.h"
+
+#define TRACK_ID_MAX 99 // ids fit two digits of the image info
+#define TRACK_LOST_MS 1000 // a track not matched for this long is dropped
+#define TRACK_CONFIRM_AGE 2 // matches before a track may become the primary one
+#define TRACK_GATE_MIN 10.0f // percent, plus half the size of the track
+#define TRACK_POSITION_GAIN 0.6f // share of the prediction error taken into the position
+#define TRACK_VELOCITY_GAIN 0.3f // and into the velocity
+#define TRACK_SPEED_MAX 200.0f // percent per second, faster is a mismatch rather than an object
+
+typedef struct {
+	float x; // centre
+	float y;
+	float width;
+	float height;
+	int verdict;
+	int matched;
+} tracker_detection_s;
+
+typedef struct {
+	float cost; // squared distance to the prediction
+	unsigned char track;
+	unsigned char detection;
+} tracker_pair_s;
+
+struct __tracker_data {
+	controller_tracker_track_s tracks[MV_TRACK_MAX];
+	int track_count;
+	unsigned int next_id;
+	unsigned int primary_id; // 0 for none
+
+	/* Scratch of every update */
+	tracker_detection_s detections[MV_RESULT_COUNT_MAX];
+	tracker_pair_s pairs[MV_TRACK_MAX * MV_RESULT_COUNT_MAX];
+	int track_matched[MV_TRACK_MAX];
+};
+
+static int __compare_detection(const void *a, const void *b)
+{
+	float left = ((const tracker_detection_s *)a)->x;
+	float right = ((const tracker_detection_s *)b)->x;
+
+	return (left > right) - (left < right);
+}
+
+static int __compare_pair(const void *a, const void *b)
+{
+	float left = ((const tracker_pair_s *)a)->cost;
+	float right = ((const tracker_pair_s *)b)->cost;
+
+	return (left > right) - (left < right);
+}
+
+/* First detection whose x is not below x, detections are sorted by x */
+static int __lower_bound(const tracker_detection_s *detections, int count, float x)
+{
+	int low = 0;
+	int high = count;
+
+	while (low < high) {
+		int middle = (low + high) / 2;
+
+		if (detections[middle].x < x)
+			low = middle + 1;
+		else
+			high = middle;
+	}
+
+	return low;
+}
+
+void controller_tracker_predict(const controller_tracker_track_s *track, long long int at_ms, float *x, float *y)
+{
+	float elapsed = (at_ms - track->last_seen_ms) / 1000.0f;
+
+	*x = track->x + track->velocity_x * elapsed;
+	*y = track->y + track->velocity_y * elapsed;
+}
+
+static void __tracker_correct(controller_tracker_track_s *track, const tracker_detection_s *detection, long long int now_ms)
+{
+	float elapsed = (now_ms - track->last_seen_ms) / 1000.0f;
+	float predicted_x = 0.0f;
+	float predicted_y = 0.0f;
+	float error_x = 0.0f;
+	float error_y = 0.0f;
+
+	controller_tracker_predict(track, now_ms, &predicted_x, &predicted_y);
+	error_x = detection->x - predicted_x;
+	error_y = detection->y - predicted_y;
+
+	/* Alpha-beta filter, events of the same frame time only move the position */
+	track->x = predicted_x + TRACK_POSITION_GAIN * error_x;
+	track->y = predicted_y + TRACK_POSITION_GAIN * error_y;
+	if (elapsed > 0.001f) {
+		track->velocity_x += TRACK_VELOCITY_GAIN * error_x / elapsed;
+		track->velocity_y += TRACK_VELOCITY_GAIN * error_y / elapsed;
+		track->velocity_x = CLAMP(track->velocity_x, -TRACK_SPEED_MAX, TRACK_SPEED_MAX);
+		track->velocity_y = CLAMP(track->velocity_y, -TRACK_SPEED_MAX, TRACK_SPEED_MAX);
+	}
+
+	track->width = (track->width + detection->width) / 2;
+	track->height = (track->height + detection->height) / 2;
+	track->age++;
+	track->last_seen_ms = now_ms;
+
+	/* Regions not classified this time keep the verdict the track has */
+	if (detection->verdict != CONTROLLER_CLASSIFIER_VERDICT_NONE) {
+		track->verdict = detection->verdict;
+		track->classified_ms = now_ms;
+	}
+}
+
+static void __tracker_drop_lost(controller_tracker_h tracker, long long int now_ms)
+{
+	int kept = 0;
+	int i = 0;
+
+	for (i = 0; i < tracker->track_count; i++) {
+		if (now_ms - tracker->tracks[i].last_seen_ms > TRACK_LOST_MS) {
+			_D("track[%u] lost after %u events", tracker->tracks[i].id, tracker->tracks[i].age);
+			if (tracker->tracks[i].id == tracker->primary_id)
+				tracker->primary_id = 0;
+			continue;
+		}
+
+		if (kept != i)
+			tracker->tracks[kept] = tracker->tracks[i];
+		kept++;
+	}
+
+	tracker->track_count = kept;
+}
+
+/* Matches are taken nearest first, only detections inside the gate of a track are looked at */
+static int __tracker_collect_pairs(controller_tracker_h tracker, int detection_count, long long int now_ms)
+{
+	tracker_detection_s *detections = tracker->detections;
+	int pair_count = 0;
+	int i = 0;
+	int j = 0;
+
+	for (i = 0; i < tracker->track_count; i++) {
+		const controller_tracker_track_s *track = &tracker->tracks[i];
+		float gate = TRACK_GATE_MIN + MAX(track->width, track->height) / 2;
+		float predicted_x = 0.0f;
+		float predicted_y = 0.0f;
+
+		controller_tracker_predict(track, now_ms, &predicted_x, &predicted_y);
+
+		for (j = __lower_bound(detections, detection_count, predicted_x - gate);
+				j < detection_count && detections[j].x <= predicted_x + gate; j++) {
+			float dx = detections[j].x - predicted_x;
+			float dy = detections[j].y - predicted_y;
+			float cost = dx * dx + dy * dy;
+
+			if (cost > gate * gate)
+				continue;
+
+			tracker->pairs[pair_count].cost = cost;
+			tracker->pairs[pair_count].track = i;
+			tracker->pairs[pair_count].detection = j;
+			pair_count++;
+		}
+	}
+
+	qsort(tracker->pairs, pair_count, sizeof(tracker_pair_s), __compare_pair);
+
+	return pair_count;
+}
+
+static int __tracker_id_in_use(controller_tracker_h tracker, unsigned int id)
+{
+	int i = 0;
+
+	for (i = 0; i < tracker->track_count; i++) {
+		if (tracker->tracks[i].id == id)
+			return 1;
+	}
+
+	return 0;
+}
+
+static void __tracker_add(controller_tracker_h tracker, const tracker_detection_s *detection, long long int now_ms)
+{
+	controller_tracker_track_s *track = NULL;
+
+	if (tracker->track_count >= MV_TRACK_MAX) {
+		_D("no room for a new track, %d tracks", tracker->track_count);
+		return;
+	}
+
+	/* A long lived track may still hold the id the counter wrapped to, the primary and the verdicts follow ids */
+	while (__tracker_id_in_use(tracker, tracker->next_id))
+		tracker->next_id = tracker->next_id % TRACK_ID_MAX + 1;
+
+	track = &tracker->tracks[tracker->track_count++];
+	memset(track, 0, sizeof(controller_tracker_track_s));
+	track->id = tracker->next_id;
+	track->x = detection->x;
+	track->y = detection->y;
+	track->width = detection->width;
+	track->height = detection->height;
+	track->age = 1;
+	track->last_seen_ms = now_ms;
+	track->verdict = detection->verdict;
+	if (detection->verdict != CONTROLLER_CLASSIFIER_VERDICT_NONE)
+		track->classified_ms = now_ms;
+
+	tracker->next_id = tracker->next_id % TRACK_ID_MAX + 1;
+}
+
+/* Persons first, then the oldest, then the largest */
+static int __tracker_is_better(const controller_tracker_track_s *track, const controller_tracker_track_s *best)
+{
+	int person = track->verdict == CONTROLLER_CLASSIFIER_VERDICT_PERSON;
+	int best_person = best->verdict == CONTROLLER_CLASSIFIER_VERDICT_PERSON;
+
+	if (person != best_person)
+		return person;
+
+	if (track->age != best->age)
+		return track->age > best->age;
+
+	return track->width * track->height > best->width * best->height;
+}
+
+/* The primary track is kept while it lives, the camera does not jump between objects, unless a person shows up */
+static void __tracker_select_primary(controller_tracker_h tracker)
+{
+	const controller_tracker_track_s *primary = NULL;
+	const controller_tracker_track_s *best = NULL;
+	int i = 0;
+
+	for (i = 0; i < tracker->track_count; i++) {
+		const controller_tracker_track_s *track = &tracker->tracks[i];
+
+		if (track->id == tracker->primary_id)
+			primary = track;
+
+		if (track->age < TRACK_CONFIRM_AGE)
+			continue;
+
+		if (!best || __tracker_is_better(track, best))
+			best = track;
+	}
+
+	if (primary && (primary->verdict == CONTROLLER_CLASSIFIER_VERDICT_PERSON
+			|| !best || best->verdict != CONTROLLER_CLASSIFIER_VERDICT_PERSON))
+		return;
+
+	tracker->primary_id = best ? best->id : 0;
+	if (best)
+		_D("track[%u] is the primary one", best->id);
+}
+
+void controller_tracker_update(controller_tracker_h tracker, const int result[], const int verdicts[], int result_count,
+	long long int now_ms)
+{
+	int detection_count = 0;
+	int pair_count = 0;
+	int i = 0;
+
+	ret_if(!tracker);
+	ret_if(result_count > 0 && !result);
+
+	__tracker_drop_lost(tracker, now_ms);
+
+	detection_count = MIN(result_count, MV_RESULT_COUNT_MAX);
+	for (i = 0; i < detection_count; i++) {
+		tracker->detections[i].width = result[i * 4 + 2];
+		tracker->detections[i].height = result[i * 4 + 3];
+		tracker->detections[i].x = result[i * 4] + tracker->detections[i].width / 2;
+		tracker->detections[i].y = result[i * 4 + 1] + tracker->detections[i].height / 2;
+		tracker->detections[i].verdict = verdicts ? verdicts[i] : CONTROLLER_CLASSIFIER_VERDICT_NONE;
+		tracker->detections[i].matched = 0;
+	}
+	qsort(tracker->detections, detection_count, sizeof(tracker_detection_s), __compare_detection);
+
+	pair_count = __tracker_collect_pairs(tracker, detection_count, now_ms);
+
+	memset(tracker->track_matched, 0, sizeof(tracker->track_matched));
+	for (i = 0; i < pair_count; i++) {
+		const tracker_pair_s *pair = &tracker->pairs[i];
+
+		if (tracker->track_matched[pair->track] || tracker->detections[pair->detection].matched)
+			continue;
+
+		tracker->track_matched[pair->track] = 1;
+		tracker->detections[pair->detection].matched = 1;
+		__tracker_correct(&tracker->tracks[pair->track], &tracker->detections[pair->detection], now_ms);
+	}
+
+	for (i = 0; i < detection_count; i++) {
+		if (!tracker->detections[i].matched)
+			__tracker_add(tracker, &tracker->detections[i], now_ms);
+	}
+
+	__tracker_select_primary(tracker);
+}
+
+void controller_tracker_shift(controller_tracker_h tracker, float dx, float dy)
+{
+	int i = 0;
+
+	ret_if(!tracker);
+
+	for (i = 0; i < tracker->track_count; i++) {
+		tracker->tracks[i].x += dx;
+		tracker->tracks[i].y += dy;
+	}
+}
+
+void controller_tracker_reset(controller_tracker_h tracker)
+{
+	ret_if(!tracker);
+
+	tracker->track_count = 0;
+	tracker->primary_id = 0;
+}
+
+int controller_tracker_get_tracks(controller_tracker_h tracker, const controller_tracker_track_s **tracks)
+{
+	if (!tracker) {
+		*tracks = NULL;
+		return 0;
+	}
+
+	*tracks = tracker->tracks;
+
+	return tracker->track_count;
+}
+
+const controller_tracker_track_s *controller_tracker_get_primary(controller_tracker_h tracker)
+{
+	int i = 0;
+
+	retv_if(!tracker, NULL);
+
+	for (i = 0; i < tracker->track_count; i++) {
+		if (tracker->tracks[i].id == tracker->primary_id)
+			return &tracker->tracks[i];
+	}
+
+	return NULL;
+}
+
+controller_tracker_h controller_tracker_create(void)
+{
+	struct __tracker_data *tracker = NULL;
+
+	tracker = calloc(1, sizeof(struct __tracker_data));
+	retvm_if(!tracker, NULL, "failed to allocate tracker");
+
+	tracker->next_id = 1;
+
+	return tracker;
+}
+
+void controller_tracker_destroy(controller_tracker_h tracker)
+{
+	free(tracker);
+}
@@ -18,12 +18,14 @@
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <time.h>
 #include <libexif/exif-loader.h>
 #include <libexif/exif-utils.h>
 #include <libexif/exif-data.h>
 #include "log.h"
 
 #define ASCII_COMMENT_HEADER "ASCII\0\0\0"
+#define EXIF_DATE_TIME_LENGTH 20 // "YYYY:MM:DD HH:MM:SS" and the terminating NUL
 // #define CHECK_EXIF_BEFOR_CREATE
 
 static int check_exif_from_data(const unsigned char *img, unsigned int size)
@@ -146,10 +148,52 @@ add_tag_user_comment(ExifData *exif, const char *comment, unsigned int length)
 	return entry;
 }
 
+static ExifEntry *
+add_tag_ascii(ExifData *exif, ExifIfd ifd, ExifTag tag, const char *value)
+{
+	ExifEntry *entry = NULL;
+	unsigned int size = 0;
+
+	retv_if(!exif, NULL);
+	retv_if(!value, NULL);
+
+	size = strlen(value) + 1;
+
+	entry = add_tag_by_malloc(exif, ifd, tag, size);
+	retv_if(!entry, NULL);
+
+	entry->format = EXIF_FORMAT_ASCII;
+	memcpy(entry->data, value, size);
+
+	return entry;
+}
+
+static int
+add_tag_capture_time(ExifData *exif, long long int capture_time_ms)
+{
+	char date_time[EXIF_DATE_TIME_LENGTH] = {'\0', };
+	char sub_sec_time[4] = {'\0', };
+	time_t seconds = capture_time_ms / 1000;
+	struct tm tm_s;
+
+	retv_if(!exif, -1);
+	retv_if(!gmtime_r(&seconds, &tm_s), -1);
+
+	/* UTC rather than local time, the dashboard compares it with its own clock */
+	strftime(date_time, sizeof(date_time), "%Y:%m:%d %H:%M:%S", &tm_s);
+	snprintf(sub_sec_time, sizeof(sub_sec_time), "%03lld", capture_time_ms % 1000);
+
+	retv_if(!add_tag_ascii(exif, EXIF_IFD_EXIF, EXIF_TAG_DATE_TIME_ORIGINAL, date_time), -1);
+	retv_if(!add_tag_ascii(exif, EXIF_IFD_EXIF, EXIF_TAG_SUB_SEC_TIME_ORIGINAL, sub_sec_time), -1);
+
+	return 0;
+}
+
 static int
 create_exif_data(const unsigned char *jpg_data, unsigned int jpg_size,
 		unsigned int jpg_width, unsigned int jpg_height,
 		const char *user_comment, unsigned int comment_len,
+		long long int capture_time_ms,
 		unsigned char **exif_data, unsigned int *exif_size)
 {
 
@@ -180,7 +224,11 @@ create_exif_data(const unsigned char *jpg_data, unsigned int jpg_size,
 	ee = add_tag_by_init(exif, EXIF_IFD_EXIF, EXIF_TAG_PIXEL_Y_DIMENSION);
 	exif_set_long(ee->data, EXIF_BYTE_ORDER_INTEL, jpg_height);
 
-	ee = add_tag_user_comment(exif, user_comment, comment_len);
+	if (user_comment && comment_len > 0)
+		ee = add_tag_user_comment(exif, user_comment, comment_len);
+
+	if (capture_time_ms > 0 && add_tag_capture_time(exif, capture_time_ms))
+		_W("failed to add capture time");
 
 	exif_data_save_data(exif, &data, &data_len);
 	if (!data) {
@@ -279,19 +327,20 @@ ERROR:
 int exif_write_jpg_file_with_comment(const char *output_file,
 		const unsigned char *jpg_data, unsigned int jpg_size,
 		unsigned int jpg_width, unsigned int jpg_height,
-		const char *comment, unsigned int comment_len)
+		const char *comment, unsigned int comment_len,
+		long long int capture_time_ms)
 {
 	int ret = 0;
 	unsigned char *exif_data  = NULL;
 	unsigned int exif_size = 0;
 
-	if (!comment || (comment_len ==  0)) {
+	if ((!comment || (comment_len ==  0)) && capture_time_ms <= 0) {
 		_W("There is no comment");
 		return save_jpeg_file(output_file, jpg_data, jpg_size);
 	}
 
 	ret = create_exif_data(jpg_data, jpg_size, jpg_width, jpg_height,
-			comment, comment_len, &exif_data, &exif_size);
+			comment, comment_len, capture_time_ms, &exif_data, &exif_size);
 	if (ret) {
 		_E("failed to create_exif_data(), save jpg data only");
 		return save_jpeg_file(output_file, jpg_data, jpg_size);
@@ -0,0 +1,196 @@
+ /*
+ * Copyright (c) 2018 Samsung Electronics Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdlib.h>
+#include <time.h>
+#include <pthread.h>
+#include "log.h"
+#include "frame_governor.h"
+
+#define COST_AVERAGE_WEIGHT 0.125 // weight of the newest sample in the cost average
+#define PIPELINE_BUSY_RATIO 0.7 // share of wall time the pipeline may spend on frames
+#define STEP_DOWN_INTERVAL_MS 1000
+#define STEP_UP_MARGIN_PERCENT 20
+
+struct __frame_governor_s {
+	unsigned int max_fps;
+	unsigned int idle_fps;
+	unsigned int idle_timeout_ms;
+
+	unsigned int current_fps;
+	unsigned int target_fps;
+
+	double cost_ms[FRAME_GOVERNOR_STAGE_MAX];
+
+	long long int last_accepted_time;
+	long long int last_active_time;
+	long long int last_step_down_time;
+
+	pthread_mutex_t mutex;
+};
+
+static long long int __get_monotonic_ms(void)
+{
+	long long int ret_time = 0;
+	struct timespec time_s;
+
+	if (0 == clock_gettime(CLOCK_MONOTONIC, &time_s))
+		ret_time = time_s.tv_sec* 1000 + time_s.tv_nsec / 1000000;
+	else
+		_E("Failed to get time");
+
+	return ret_time;
+}
+
+static unsigned int __get_cost_limited_fps(struct __frame_governor_s *governor)
+{
+	double cost_ms = 0.0;
+	int i = 0;
+
+	for (i = 0; i < FRAME_GOVERNOR_STAGE_MAX; i++)
+		cost_ms += governor->cost_ms[i];
+
+	if (cost_ms < 1.0)
+		return governor->max_fps;
+
+	return (unsigned int)(1000.0 * PIPELINE_BUSY_RATIO / cost_ms);
+}
+
+/* Called with the mutex held */
+static void __update_fps(struct __frame_governor_s *governor, long long int now)
+{
+	unsigned int cost_fps = __get_cost_limited_fps(governor);
+	unsigned int target = 0;
+	bool active = (now - governor->last_active_time < governor->idle_timeout_ms);
+
+	target = active ? governor->max_fps : governor->idle_fps;
+	if (cost_fps < target)
+		target = cost_fps;
+	if (target < governor->idle_fps)
+		target = governor->idle_fps;
+
+	governor->target_fps = target;
+
+	if (target > governor->current_fps) {
+		/* Go up at once for motion, a cheaper pipeline has to clear the margin first */
+		if (active || target * 100 >= governor->current_fps * (100 + STEP_UP_MARGIN_PERCENT)) {
+			_D("fps up [%u -> %u]", governor->current_fps, target);
+			governor->current_fps = target;
+		}
+	} else if (target < governor->current_fps) {
+		if (cost_fps < governor->current_fps) {
+			/* The pipeline can not keep up, back off at once */
+			_D("fps down by cost [%u -> %u]", governor->current_fps, target);
+			governor->current_fps = target;
+			governor->last_step_down_time = now;
+		} else if (now - governor->last_step_down_time >= STEP_DOWN_INTERVAL_MS) {
+			/* The scene went idle, halve the rate step by step */
+			unsigned int next = governor->current_fps / 2;
+			if (next < target)
+				next = target;
+			_D("fps down by idle [%u -> %u]", governor->current_fps, next);
+			governor->current_fps = next;
+			governor->last_step_down_time = now;
+		}
+	}
+}
+
+frame_governor_h frame_governor_create(unsigned int max_fps, unsigned int idle_fps, unsigned int idle_timeout_ms)
+{
+	struct __frame_governor_s *governor = NULL;
+
+	retv_if(max_fps == 0, NULL);
+	retv_if(idle_fps == 0, NULL);
+	retv_if(idle_fps > max_fps, NULL);
+
+	governor = calloc(1, sizeof(struct __frame_governor_s));
+	retv_if(!governor, NULL);
+
+	pthread_mutex_init(&governor->mutex, NULL);
+
+	governor->max_fps = max_fps;
+	governor->idle_fps = idle_fps;
+	governor->idle_timeout_ms = idle_timeout_ms;
+
+	/* Start at full rate, as if something had just moved */
+	governor->current_fps = max_fps;
+	governor->target_fps = max_fps;
+	governor->last_active_time = __get_monotonic_ms();
+	governor->last_step_down_time = governor->last_active_time;
+
+	return governor;
+}
+
+void frame_governor_destroy(frame_governor_h governor)
+{
+	ret_if(!governor);
+
+	pthread_mutex_destroy(&governor->mutex);
+	free(governor);
+}
+
+bool frame_governor_accept_frame(frame_governor_h governor)
+{
+	long long int now = __get_monotonic_ms();
+	bool accepted = false;
+
+	retv_if(!governor, false);
+
+	pthread_mutex_lock(&governor->mutex);
+	__update_fps(governor, now);
+
+	if (now - governor->last_accepted_time >= 1000 / governor->current_fps) {
+		governor->last_accepted_time = now;
+		accepted = true;
+	}
+	pthread_mutex_unlock(&governor->mutex);
+
+	return accepted;
+}
+
+void frame_governor_report_cost(frame_governor_h governor, frame_governor_stage_e stage, unsigned int cost_ms)
+{
+	ret_if(!governor);
+	ret_if(stage >= FRAME_GOVERNOR_STAGE_MAX);
+
+	pthread_mutex_lock(&governor->mutex);
+	governor->cost_ms[stage] += (cost_ms - governor->cost_ms[stage]) * COST_AVERAGE_WEIGHT;
+	pthread_mutex_unlock(&governor->mutex);
+}
+
+void frame_governor_report_activity(frame_governor_h governor)
+{
+	long long int now = __get_monotonic_ms();
+
+	ret_if(!governor);
+
+	pthread_mutex_lock(&governor->mutex);
+	governor->last_active_time = now;
+	__update_fps(governor, now);
+	pthread_mutex_unlock(&governor->mutex);
+}
+
+void frame_governor_get_fps(frame_governor_h governor, unsigned int *current_fps, unsigned int *target_fps)
+{
+	ret_if(!governor);
+
+	pthread_mutex_lock(&governor->mutex);
+	if (current_fps)
+		*current_fps = governor->current_fps;
+	if (target_fps)
+		*target_fps = governor->target_fps;
+	pthread_mutex_unlock(&governor->mutex);
+}
@@ -0,0 +1,244 @@
+ /*
+ * Copyright (c) 2018 Samsung Electronics Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <glib.h>
+#include <media_packet.h>
+#include "log.h"
+#include "frame_pool.h"
+#include "frame_trace.h"
+#include "frame_pyramid.h"
+
+#define FRAME_ALIGN 64
+
+struct __frame_pool_s {
+	unsigned char *memory;
+	image_buffer_data_s *frames;
+	image_buffer_data_s **free_list;
+	unsigned int free_count;
+
+	unsigned int capacity;
+	unsigned int frame_size;
+	unsigned int frame_stride;
+	unsigned int high_water;
+	unsigned int exhausted;
+	unsigned int sequence;
+	bool destroyed;
+
+	pthread_mutex_t mutex;
+};
+
+static inline unsigned char *__frame_memory(struct __frame_pool_s *pool, image_buffer_data_s *image_buffer)
+{
+	return pool->memory + (size_t)pool->frame_stride * (image_buffer - pool->frames);
+}
+
+static void __free_pool(struct __frame_pool_s *pool)
+{
+	unsigned int i = 0;
+
+	pthread_mutex_destroy(&pool->mutex);
+	free(pool->free_list);
+	for (i = 0; pool->frames && i < pool->capacity; i++)
+		frame_pyramid_destroy(pool->frames[i].pyramid);
+	free(pool->frames);
+	free(pool->memory);
+	free(pool);
+}
+
+unsigned int frame_pool_get_frame_size(camera_pixel_format_e format, unsigned int width, unsigned int height)
+{
+	unsigned int pixels = width * height;
+
+	switch (format) {
+	case CAMERA_PIXEL_FORMAT_NV12:
+	case CAMERA_PIXEL_FORMAT_NV12T:
+	case CAMERA_PIXEL_FORMAT_NV21:
+	case CAMERA_PIXEL_FORMAT_I420:
+	case CAMERA_PIXEL_FORMAT_YV12:
+		return pixels + pixels / 2;
+	case CAMERA_PIXEL_FORMAT_NV16:
+	case CAMERA_PIXEL_FORMAT_YUYV:
+	case CAMERA_PIXEL_FORMAT_UYVY:
+	case CAMERA_PIXEL_FORMAT_422P:
+	case CAMERA_PIXEL_FORMAT_RGB565:
+		return pixels * 2;
+	case CAMERA_PIXEL_FORMAT_RGB888:
+		return pixels * 3;
+	case CAMERA_PIXEL_FORMAT_RGBA:
+	case CAMERA_PIXEL_FORMAT_ARGB:
+		return pixels * 4;
+	default:
+		_E("unsupported format : %d", format);
+		return 0;
+	}
+}
+
+frame_pool_h frame_pool_create(unsigned int frame_count, unsigned int frame_size)
+{
+	struct __frame_pool_s *pool = NULL;
+	unsigned int stride = 0;
+	unsigned int i = 0;
+	void *memory = NULL;
+
+	retv_if(frame_count == 0, NULL);
+	retv_if(frame_size == 0, NULL);
+
+	pool = calloc(1, sizeof(struct __frame_pool_s));
+	retv_if(!pool, NULL);
+
+	pthread_mutex_init(&pool->mutex, NULL);
+
+	/* Keep every frame on its own cache lines */
+	stride = (frame_size + FRAME_ALIGN - 1) & ~(FRAME_ALIGN - 1);
+	if (posix_memalign(&memory, FRAME_ALIGN, (size_t)stride * frame_count)) {
+		_E("Failed to allocate frame memory [%u x %u]", frame_count, stride);
+		goto ERROR;
+	}
+	pool->memory = memory;
+
+	pool->frames = calloc(frame_count, sizeof(image_buffer_data_s));
+	goto_if(!pool->frames, ERROR);
+
+	pool->free_list = calloc(frame_count, sizeof(image_buffer_data_s *));
+	goto_if(!pool->free_list, ERROR);
+
+	/* Levels are only allocated once a consumer asks for them */
+	pool->capacity = frame_count;
+	for (i = 0; i < frame_count; i++) {
+		pool->frames[i].pyramid = frame_pyramid_create();
+		goto_if(!pool->frames[i].pyramid, ERROR);
+	}
+
+	pool->free_count = frame_count;
+	pool->frame_size = frame_size;
+	pool->frame_stride = stride;
+
+	for (i = 0; i < frame_count; i++) {
+		pool->frames[i].pool = pool;
+		pool->frames[i].buffer = __frame_memory(pool, &pool->frames[i]);
+		pool->free_list[i] = &pool->frames[i];
+	}
+
+	_I("frame pool created [%u x %u bytes]", frame_count, frame_size);
+
+	return pool;
+
+ERROR:
+	__free_pool(pool);
+	return NULL;
+}
+
+void frame_pool_destroy(frame_pool_h pool)
+{
+	bool release = false;
+
+	ret_if(!pool);
+
+	pthread_mutex_lock(&pool->mutex);
+	_I("frame pool - capacity[%u], in use[%u], high water[%u], exhausted[%u]",
+		pool->capacity, pool->capacity - pool->free_count, pool->high_water, pool->exhausted);
+	pool->destroyed = true;
+	release = (pool->free_count == pool->capacity);
+	pthread_mutex_unlock(&pool->mutex);
+
+	if (release)
+		__free_pool(pool);
+}
+
+image_buffer_data_s *frame_pool_acquire(frame_pool_h pool)
+{
+	image_buffer_data_s *image_buffer = NULL;
+	unsigned int in_use = 0;
+
+	retv_if(!pool, NULL);
+
+	pthread_mutex_lock(&pool->mutex);
+	if (pool->destroyed || pool->free_count == 0) {
+		pool->exhausted++;
+		pthread_mutex_unlock(&pool->mutex);
+		return NULL;
+	}
+
+	image_buffer = pool->free_list[--pool->free_count];
+	image_buffer->sequence = pool->sequence++;
+	in_use = pool->capacity - pool->free_count;
+	if (in_use > pool->high_water)
+		pool->high_water = in_use;
+	pthread_mutex_unlock(&pool->mutex);
+
+	image_buffer->buffer_size = pool->frame_size;
+	image_buffer->user_data = NULL;
+	image_buffer->timestamp_us = frame_trace_get_time_us();
+	image_buffer->trace_time_us = image_buffer->timestamp_us;
+	image_buffer->ref_count = 1;
+
+	return image_buffer;
+}
+
+void frame_pool_get_stats(frame_pool_h pool, frame_pool_stats_s *stats)
+{
+	ret_if(!pool);
+	ret_if(!stats);
+
+	pthread_mutex_lock(&pool->mutex);
+	stats->capacity = pool->capacity;
+	stats->frame_size = pool->frame_size;
+	stats->in_use = pool->capacity - pool->free_count;
+	stats->high_water = pool->high_water;
+	stats->exhausted = pool->exhausted;
+	pthread_mutex_unlock(&pool->mutex);
+}
+
+image_buffer_data_s *image_buffer_ref(image_buffer_data_s *image_buffer)
+{
+	retv_if(!image_buffer, NULL);
+
+	g_atomic_int_inc(&image_buffer->ref_count);
+
+	return image_buffer;
+}
+
+void image_buffer_unref(image_buffer_data_s *image_buffer)
+{
+	struct __frame_pool_s *pool = NULL;
+	bool release = false;
+
+	ret_if(!image_buffer);
+
+	if (!g_atomic_int_dec_and_test(&image_buffer->ref_count))
+		return;
+
+	/* A wrapped camera packet goes back to the camera, the frame gets its own memory back */
+	if (image_buffer->packet) {
+		media_packet_destroy(image_buffer->packet);
+		image_buffer->packet = NULL;
+	}
+
+	pool = image_buffer->pool;
+	image_buffer->buffer = __frame_memory(pool, image_buffer);
+	frame_pyramid_release(image_buffer->pyramid);
+
+	pthread_mutex_lock(&pool->mutex);
+	pool->free_list[pool->free_count++] = image_buffer;
+	release = (pool->destroyed && pool->free_count == pool->capacity);
+	pthread_mutex_unlock(&pool->mutex);
+
+	if (release)
+		__free_pool(pool);
+}
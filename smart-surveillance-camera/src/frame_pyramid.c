@@ -0,0 +1,201 @@
+ /*
+ * Copyright (c) 2018 Samsung Electronics Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "log.h"
+#include "image_kernel.h"
+#include "frame_pyramid.h"
+
+#define PYRAMID_ALIGN 64
+
+struct __frame_pyramid_s {
+	pthread_mutex_t mutex;
+
+	/* Every level on its own cache lines, laid out for the size and format of the frame */
+	unsigned char *memory;
+	size_t memory_size;
+	unsigned int width;
+	unsigned int height;
+	camera_pixel_format_e format;
+
+	unsigned char *levels[FRAME_PYRAMID_LEVEL_MAX + 1]; // level 0 is the frame itself unless it is packed
+	unsigned int built; // a bit per level, to mutex
+};
+
+static int __is_packed_yuv(camera_pixel_format_e format)
+{
+	return format == CAMERA_PIXEL_FORMAT_YUYV || format == CAMERA_PIXEL_FORMAT_UYVY;
+}
+
+static int __has_luma(camera_pixel_format_e format)
+{
+	switch (format) {
+	case CAMERA_PIXEL_FORMAT_NV12:
+	case CAMERA_PIXEL_FORMAT_NV21:
+	case CAMERA_PIXEL_FORMAT_NV16:
+	case CAMERA_PIXEL_FORMAT_I420:
+	case CAMERA_PIXEL_FORMAT_YV12:
+	case CAMERA_PIXEL_FORMAT_422P:
+	case CAMERA_PIXEL_FORMAT_YUYV:
+	case CAMERA_PIXEL_FORMAT_UYVY:
+		return 1;
+	default:
+		return 0;
+	}
+}
+
+static size_t __aligned(size_t size)
+{
+	return (size + PYRAMID_ALIGN - 1) & ~(size_t)(PYRAMID_ALIGN - 1);
+}
+
+/* Lays the levels out for the frame, the memory is only reallocated when it has to grow */
+static int __layout(struct __frame_pyramid_s *pyramid, const image_buffer_data_s *image_buffer)
+{
+	unsigned int width = image_buffer->image_width;
+	unsigned int height = image_buffer->image_height;
+	size_t offsets[FRAME_PYRAMID_LEVEL_MAX + 1] = {0, };
+	size_t size = 0;
+	void *memory = NULL;
+	int level = 0;
+
+	if (pyramid->memory && width == pyramid->width && height == pyramid->height
+			&& image_buffer->format == pyramid->format)
+		return 0;
+
+	for (level = 0; level <= FRAME_PYRAMID_LEVEL_MAX; level++) {
+		offsets[level] = size;
+		/* Packed frames need a Y plane of their own, the planar ones are read in place */
+		if (level > 0 || __is_packed_yuv(image_buffer->format))
+			size += __aligned((size_t)(width >> level) * (height >> level));
+	}
+
+	if (size > pyramid->memory_size) {
+		free(pyramid->memory);
+		pyramid->memory = NULL;
+		pyramid->memory_size = 0;
+		if (posix_memalign(&memory, PYRAMID_ALIGN, size)) {
+			_E("failed to allocate frame pyramid for [%u x %u]", width, height);
+			return -1;
+		}
+		pyramid->memory = memory;
+		pyramid->memory_size = size;
+	}
+
+	for (level = 0; level <= FRAME_PYRAMID_LEVEL_MAX; level++)
+		pyramid->levels[level] = pyramid->memory + offsets[level];
+
+	pyramid->width = width;
+	pyramid->height = height;
+	pyramid->format = image_buffer->format;
+
+	return 0;
+}
+
+static void __build(struct __frame_pyramid_s *pyramid, const image_buffer_data_s *image_buffer, unsigned int level)
+{
+	unsigned int width = pyramid->width >> level;
+	unsigned int height = pyramid->height >> level;
+
+	if (level > 0) {
+		unsigned int above_width = pyramid->width >> (level - 1);
+		unsigned int above_height = pyramid->height >> (level - 1);
+
+		image_kernel_downscale_luma_2x(pyramid->levels[level - 1], above_width,
+			pyramid->levels[level], width, above_width, above_height);
+	} else if (__is_packed_yuv(pyramid->format)) {
+		image_kernel_yuv422_to_luma(pyramid->format, image_buffer->buffer, width * 2,
+			pyramid->levels[0], width, height);
+	} else {
+		/* Frames are tightly packed, Y is the first plane. A wrapped camera packet moves it with every frame */
+		pyramid->levels[0] = image_buffer->buffer;
+	}
+
+	pyramid->built |= 1U << level;
+}
+
+const unsigned char *frame_pyramid_get_level(const image_buffer_data_s *image_buffer, unsigned int level,
+	unsigned int *width, unsigned int *height)
+{
+	struct __frame_pyramid_s *pyramid = NULL;
+	const unsigned char *data = NULL;
+	unsigned int i = 0;
+
+	retv_if(!image_buffer || !image_buffer->buffer, NULL);
+	retv_if(!image_buffer->pyramid, NULL);
+	retvm_if(level > FRAME_PYRAMID_LEVEL_MAX, NULL, "unsupported pyramid level : %u", level);
+
+	if (!__has_luma(image_buffer->format))
+		return NULL;
+
+	pyramid = image_buffer->pyramid;
+
+	pthread_mutex_lock(&pyramid->mutex);
+
+	if (pyramid->built == 0 && __layout(pyramid, image_buffer)) {
+		pthread_mutex_unlock(&pyramid->mutex);
+		return NULL;
+	}
+
+	/* Each level is filtered from the one above, what another stage asked for is reused */
+	for (i = 0; i <= level; i++) {
+		if (!(pyramid->built & (1U << i)))
+			__build(pyramid, image_buffer, i);
+	}
+	data = pyramid->levels[level];
+
+	pthread_mutex_unlock(&pyramid->mutex);
+
+	if (width)
+		*width = image_buffer->image_width >> level;
+	if (height)
+		*height = image_buffer->image_height >> level;
+
+	return data;
+}
+
+void frame_pyramid_release(frame_pyramid_h pyramid)
+{
+	ret_if(!pyramid);
+
+	/* The last reference is gone, nobody else reads the levels */
+	pyramid->built = 0;
+}
+
+frame_pyramid_h frame_pyramid_create(void)
+{
+	struct __frame_pyramid_s *pyramid = NULL;
+
+	pyramid = calloc(1, sizeof(struct __frame_pyramid_s));
+	retvm_if(!pyramid, NULL, "failed to allocate frame pyramid");
+	pthread_mutex_init(&pyramid->mutex, NULL);
+	pyramid->format = CAMERA_PIXEL_FORMAT_INVALID;
+
+	return pyramid;
+}
+
+void frame_pyramid_destroy(frame_pyramid_h pyramid)
+{
+	if (!pyramid)
+		return;
+
+	pthread_mutex_destroy(&pyramid->mutex);
+	free(pyramid->memory);
+	free(pyramid);
+}
@@ -0,0 +1,209 @@
+ /*
+ * Copyright (c) 2018 Samsung Electronics Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdlib.h>
+#include <glib.h>
+#include <Ecore.h>
+#include "log.h"
+#include "frame_pool.h"
+#include "frame_queue.h"
+
+struct __frame_queue_s {
+	image_buffer_data_s **slots;
+	unsigned int capacity;
+	unsigned int mask;
+
+	/* head is advanced by the consumer, and by the producer when it drops the oldest frame */
+	volatile gint head;
+	volatile gint tail;
+	volatile gint wakeup_pending;
+
+	volatile gint enqueued;
+	volatile gint dropped;
+	volatile gint max_depth;
+
+	frame_queue_overflow_policy_e policy;
+	unsigned int batch_size;
+	frame_queue_consume_cb consume_cb;
+	void *user_data;
+
+	bool closed;
+};
+
+static image_buffer_data_s *__pop(struct __frame_queue_s *queue)
+{
+	image_buffer_data_s *image_buffer = NULL;
+	guint head = 0;
+
+	do {
+		head = g_atomic_int_get(&queue->head);
+		if (head == (guint)g_atomic_int_get(&queue->tail))
+			return NULL;
+
+		image_buffer = g_atomic_pointer_get(&queue->slots[head & queue->mask]);
+	} while (!g_atomic_int_compare_and_exchange(&queue->head, head, head + 1));
+
+	return image_buffer;
+}
+
+static void __free_queue(struct __frame_queue_s *queue)
+{
+	image_buffer_data_s *image_buffer = NULL;
+
+	while ((image_buffer = __pop(queue)))
+		image_buffer_unref(image_buffer);
+
+	free(queue->slots);
+	free(queue);
+}
+
+static void __drain_cb(void *data)
+{
+	struct __frame_queue_s *queue = data;
+	image_buffer_data_s *image_buffer = NULL;
+	unsigned int count = 0;
+
+	if (queue->closed) {
+		__free_queue(queue);
+		return;
+	}
+
+	/* Clear before draining, so a frame pushed from now on schedules another pass */
+	g_atomic_int_set(&queue->wakeup_pending, 0);
+
+	for (count = 0; count < queue->batch_size; count++) {
+		image_buffer = __pop(queue);
+		if (!image_buffer)
+			break;
+
+		queue->consume_cb(image_buffer, queue->user_data);
+	}
+
+	/* Leftovers are handled on the next iteration, other main loop sources run in between */
+	if (g_atomic_int_get(&queue->head) != g_atomic_int_get(&queue->tail)
+		&& g_atomic_int_compare_and_exchange(&queue->wakeup_pending, 0, 1))
+		ecore_main_loop_thread_safe_call_async(__drain_cb, queue);
+}
+
+frame_queue_h frame_queue_create(unsigned int capacity, frame_queue_overflow_policy_e policy,
+	unsigned int batch_size, frame_queue_consume_cb consume_cb, void *user_data)
+{
+	struct __frame_queue_s *queue = NULL;
+	unsigned int size = 1;
+
+	retv_if(capacity == 0, NULL);
+	retv_if(batch_size == 0, NULL);
+	retv_if(!consume_cb, NULL);
+
+	while (size < capacity)
+		size <<= 1;
+
+	queue = calloc(1, sizeof(struct __frame_queue_s));
+	retv_if(!queue, NULL);
+
+	queue->slots = calloc(size, sizeof(image_buffer_data_s *));
+	if (!queue->slots) {
+		_E("Failed to allocate queue slots");
+		free(queue);
+		return NULL;
+	}
+
+	queue->capacity = size;
+	queue->mask = size - 1;
+	queue->policy = policy;
+	queue->batch_size = batch_size;
+	queue->consume_cb = consume_cb;
+	queue->user_data = user_data;
+
+	return queue;
+}
+
+void frame_queue_destroy(frame_queue_h queue)
+{
+	image_buffer_data_s *image_buffer = NULL;
+
+	ret_if(!queue);
+
+	_I("frame queue - enqueued[%d], dropped[%d], max depth[%d]",
+		g_atomic_int_get(&queue->enqueued), g_atomic_int_get(&queue->dropped),
+		g_atomic_int_get(&queue->max_depth));
+
+	queue->closed = true;
+
+	/* Queued frames are released now, they may wrap packets of a camera about to be destroyed */
+	while ((image_buffer = __pop(queue)))
+		image_buffer_unref(image_buffer);
+
+	/* A scheduled drain owns the release, otherwise nothing can wake up any more */
+	if (g_atomic_int_compare_and_exchange(&queue->wakeup_pending, 0, 1))
+		__free_queue(queue);
+}
+
+int frame_queue_push(frame_queue_h queue, image_buffer_data_s *image_buffer)
+{
+	image_buffer_data_s *oldest = NULL;
+	guint head = 0;
+	guint tail = 0;
+	guint depth = 0;
+
+	retv_if(!queue, -1);
+	retv_if(!image_buffer, -1);
+
+	tail = g_atomic_int_get(&queue->tail);
+
+	while (1) {
+		head = g_atomic_int_get(&queue->head);
+		if (tail - head < queue->capacity)
+			break;
+
+		if (queue->policy == FRAME_QUEUE_DROP_NEWEST) {
+			g_atomic_int_inc(&queue->dropped);
+			image_buffer_unref(image_buffer);
+			return -1;
+		}
+
+		oldest = g_atomic_pointer_get(&queue->slots[head & queue->mask]);
+		if (g_atomic_int_compare_and_exchange(&queue->head, head, head + 1)) {
+			g_atomic_int_inc(&queue->dropped);
+			image_buffer_unref(oldest);
+		}
+	}
+
+	g_atomic_pointer_set(&queue->slots[tail & queue->mask], image_buffer);
+	g_atomic_int_set(&queue->tail, tail + 1);
+	g_atomic_int_inc(&queue->enqueued);
+
+	depth = tail + 1 - head;
+	if (depth > (guint)g_atomic_int_get(&queue->max_depth))
+		g_atomic_int_set(&queue->max_depth, depth);
+
+	if (g_atomic_int_compare_and_exchange(&queue->wakeup_pending, 0, 1))
+		ecore_main_loop_thread_safe_call_async(__drain_cb, queue);
+
+	return 0;
+}
+
+void frame_queue_get_stats(frame_queue_h queue, frame_queue_stats_s *stats)
+{
+	ret_if(!queue);
+	ret_if(!stats);
+
+	stats->capacity = queue->capacity;
+	stats->depth = (guint)g_atomic_int_get(&queue->tail) - (guint)g_atomic_int_get(&queue->head);
+	stats->max_depth = g_atomic_int_get(&queue->max_depth);
+	stats->enqueued = g_atomic_int_get(&queue->enqueued);
+	stats->dropped = g_atomic_int_get(&queue->dropped);
+}
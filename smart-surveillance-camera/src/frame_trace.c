@@ -0,0 +1,410 @@
+ /*
+ * Copyright (c) 2018 Samsung Electronics Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <glib.h>
+#include <Ecore.h>
+#include "log.h"
+#include "controller.h"
+#include "frame_trace.h"
+
+#define TRACE_RING_SIZE 512 // records per thread between two drains, power of 2
+#define TRACE_DRAIN_INTERVAL_SEC 1.0
+#define TRACE_LAG_PROBE_INTERVAL_SEC 0.1 // everything else on the main loop delays this timer
+
+/* Below HISTOGRAM_LINEAR_BUCKETS us one bucket per us, above 8 buckets per power of 2 (12.5% wide) */
+#define HISTOGRAM_LINEAR_BUCKETS 16
+#define HISTOGRAM_LINEAR_BITS 4
+#define HISTOGRAM_SUB_BUCKET_BITS 3
+#define HISTOGRAM_MAX_BITS 36 // ~19 hours, longer ones land in the last bucket
+#define HISTOGRAM_BUCKET_COUNT (HISTOGRAM_LINEAR_BUCKETS + \
+	((HISTOGRAM_MAX_BITS - HISTOGRAM_LINEAR_BITS) << HISTOGRAM_SUB_BUCKET_BITS))
+
+typedef struct {
+	frame_trace_stage_e stage;
+	int camera_index;
+	unsigned int sequence;
+	long long int enter_us;
+	long long int exit_us;
+} __trace_record_s;
+
+/* Written by its own thread only, read by the main loop */
+typedef struct __trace_ring_s {
+	__trace_record_s records[TRACE_RING_SIZE];
+	volatile gint head;
+	volatile gint tail;
+	volatile gint dropped;
+	volatile gint orphaned; // the thread has exited, freed once drained
+	struct __trace_ring_s *next;
+} __trace_ring_s;
+
+typedef struct {
+	unsigned int buckets[HISTOGRAM_BUCKET_COUNT];
+	unsigned int count;
+	long long int sum_us;
+	long long int max_us;
+} __histogram_s;
+
+static const char *stage_names[FRAME_TRACE_STAGE_MAX] = {
+	"capture", "queue", "analysis", "event", "encode", "rename", "total", "snapshot", "preview_gap",
+	"handoff", "result", "main_loop_lag", "classify",
+};
+
+static volatile gint trace_initialized = 0;
+static pthread_key_t ring_key;
+static pthread_mutex_t ring_mutex = PTHREAD_MUTEX_INITIALIZER;
+static __trace_ring_s *rings = NULL;
+
+/* Main loop only */
+static Ecore_Timer *drain_timer = NULL;
+static Ecore_Timer *lag_probe_timer = NULL;
+static long long int lag_probe_due_us = 0;
+static __histogram_s histograms[CAMERA_COUNT][FRAME_TRACE_STAGE_MAX];
+static unsigned int dropped_records = 0;
+static long long int report_started_us = 0;
+
+long long int frame_trace_get_time_us(void)
+{
+	long long int ret_time = 0;
+	struct timespec time_s;
+
+	if (0 == clock_gettime(CLOCK_MONOTONIC, &time_s))
+		ret_time = time_s.tv_sec * 1000000LL + time_s.tv_nsec / 1000;
+	else
+		_E("Failed to get time");
+
+	return ret_time;
+}
+
+long long int frame_trace_get_wall_clock_ms(long long int time_us)
+{
+	struct timespec time_s;
+	long long int now_ms = 0;
+
+	if (0 != clock_gettime(CLOCK_REALTIME, &time_s)) {
+		_E("Failed to get time");
+		return 0;
+	}
+	now_ms = time_s.tv_sec * 1000LL + time_s.tv_nsec / 1000000;
+
+	return now_ms - (frame_trace_get_time_us() - time_us) / 1000;
+}
+
+static unsigned int __bucket_index(long long int value_us)
+{
+	unsigned int exponent = 0;
+
+	if (value_us < HISTOGRAM_LINEAR_BUCKETS)
+		return value_us > 0 ? value_us : 0;
+	if (value_us >= (1LL << HISTOGRAM_MAX_BITS))
+		return HISTOGRAM_BUCKET_COUNT - 1;
+
+	exponent = 63 - __builtin_clzll(value_us);
+
+	return HISTOGRAM_LINEAR_BUCKETS
+		+ ((exponent - HISTOGRAM_LINEAR_BITS) << HISTOGRAM_SUB_BUCKET_BITS)
+		+ ((value_us >> (exponent - HISTOGRAM_SUB_BUCKET_BITS)) & ((1 << HISTOGRAM_SUB_BUCKET_BITS) - 1));
+}
+
+static long long int __bucket_upper_bound(unsigned int index)
+{
+	unsigned int exponent = 0;
+	unsigned int sub_bucket = 0;
+
+	if (index < HISTOGRAM_LINEAR_BUCKETS)
+		return index;
+
+	index -= HISTOGRAM_LINEAR_BUCKETS;
+	exponent = HISTOGRAM_LINEAR_BITS + (index >> HISTOGRAM_SUB_BUCKET_BITS);
+	sub_bucket = index & ((1 << HISTOGRAM_SUB_BUCKET_BITS) - 1);
+
+	return (((1LL << HISTOGRAM_SUB_BUCKET_BITS) + sub_bucket + 1) << (exponent - HISTOGRAM_SUB_BUCKET_BITS)) - 1;
+}
+
+static long long int __histogram_percentile(const __histogram_s *histogram, unsigned int percent)
+{
+	unsigned long long target = ((unsigned long long)histogram->count * percent + 99) / 100;
+	unsigned long long seen = 0;
+	long long int value = 0;
+	unsigned int i = 0;
+
+	for (i = 0; i < HISTOGRAM_BUCKET_COUNT; i++) {
+		seen += histogram->buckets[i];
+		if (seen >= target)
+			break;
+	}
+
+	value = __bucket_upper_bound(i);
+
+	return value < histogram->max_us ? value : histogram->max_us;
+}
+
+static void __ring_destructor(void *data)
+{
+	__trace_ring_s *ring = data;
+
+	g_atomic_int_set(&ring->orphaned, 1);
+}
+
+static __trace_ring_s *__get_ring(void)
+{
+	__trace_ring_s *ring = pthread_getspecific(ring_key);
+
+	if (ring)
+		return ring;
+
+	ring = calloc(1, sizeof(__trace_ring_s));
+	retv_if(!ring, NULL);
+
+	pthread_mutex_lock(&ring_mutex);
+	ring->next = rings;
+	rings = ring;
+	pthread_mutex_unlock(&ring_mutex);
+
+	pthread_setspecific(ring_key, ring);
+
+	return ring;
+}
+
+void frame_trace_record(frame_trace_stage_e stage, int camera_index, unsigned int sequence,
+	long long int enter_us, long long int exit_us)
+{
+	__trace_ring_s *ring = NULL;
+	__trace_record_s *record = NULL;
+	guint tail = 0;
+
+	if (!g_atomic_int_get(&trace_initialized))
+		return;
+
+	ring = __get_ring();
+	if (!ring)
+		return;
+
+	tail = g_atomic_int_get(&ring->tail);
+	if (tail - (guint)g_atomic_int_get(&ring->head) >= TRACE_RING_SIZE) {
+		g_atomic_int_inc(&ring->dropped);
+		return;
+	}
+
+	record = &ring->records[tail & (TRACE_RING_SIZE - 1)];
+	record->stage = stage;
+	record->camera_index = camera_index;
+	record->sequence = sequence;
+	record->enter_us = enter_us;
+	record->exit_us = exit_us;
+
+	/* Publishes the record to the main loop */
+	g_atomic_int_set(&ring->tail, tail + 1);
+}
+
+static void __add_record(const __trace_record_s *record)
+{
+	__histogram_s *histogram = NULL;
+	long long int duration_us = record->exit_us - record->enter_us;
+
+	if (record->camera_index < 0 || record->camera_index >= CAMERA_COUNT)
+		return;
+	if ((unsigned int)record->stage >= FRAME_TRACE_STAGE_MAX)
+		return;
+
+	histogram = &histograms[record->camera_index][record->stage];
+	histogram->buckets[__bucket_index(duration_us)]++;
+	histogram->count++;
+	histogram->sum_us += duration_us;
+	if (duration_us > histogram->max_us)
+		histogram->max_us = duration_us;
+}
+
+static void __drain_rings(void)
+{
+	__trace_ring_s **link = NULL;
+	__trace_ring_s *ring = NULL;
+	guint head = 0;
+	guint tail = 0;
+	gint orphaned = 0;
+
+	pthread_mutex_lock(&ring_mutex);
+
+	link = &rings;
+	while ((ring = *link)) {
+		/* Read before draining, an exited thread has nothing left to publish */
+		orphaned = g_atomic_int_get(&ring->orphaned);
+
+		head = g_atomic_int_get(&ring->head);
+		tail = g_atomic_int_get(&ring->tail);
+		for (; head != tail; head++)
+			__add_record(&ring->records[head & (TRACE_RING_SIZE - 1)]);
+		g_atomic_int_set(&ring->head, head);
+
+		dropped_records += g_atomic_int_and(&ring->dropped, 0);
+
+		if (orphaned) {
+			*link = ring->next;
+			free(ring);
+		} else {
+			link = &ring->next;
+		}
+	}
+
+	pthread_mutex_unlock(&ring_mutex);
+}
+
+static Eina_Bool __drain_timer_cb(void *data)
+{
+	__drain_rings();
+
+	return ECORE_CALLBACK_RENEW;
+}
+
+static Eina_Bool __lag_probe_timer_cb(void *data)
+{
+	long long int now = frame_trace_get_time_us();
+
+	/* A timer never fires early, everything past the due time was spent on other main loop work */
+	if (now >= lag_probe_due_us)
+		frame_trace_record(FRAME_TRACE_STAGE_MAIN_LOOP_LAG, 0, 0, lag_probe_due_us, now);
+	lag_probe_due_us = now + TRACE_LAG_PROBE_INTERVAL_SEC * 1000000;
+
+	return ECORE_CALLBACK_RENEW;
+}
+
+int frame_trace_init(void)
+{
+	if (g_atomic_int_get(&trace_initialized))
+		return 0;
+
+	if (pthread_key_create(&ring_key, __ring_destructor)) {
+		_E("Failed to create trace ring key");
+		return -1;
+	}
+
+	memset(histograms, 0, sizeof(histograms));
+	dropped_records = 0;
+	report_started_us = frame_trace_get_time_us();
+
+	drain_timer = ecore_timer_add(TRACE_DRAIN_INTERVAL_SEC, __drain_timer_cb, NULL);
+	if (!drain_timer) {
+		_E("Failed to add trace drain timer");
+		pthread_key_delete(ring_key);
+		return -1;
+	}
+
+	lag_probe_due_us = frame_trace_get_time_us() + TRACE_LAG_PROBE_INTERVAL_SEC * 1000000;
+	lag_probe_timer = ecore_timer_add(TRACE_LAG_PROBE_INTERVAL_SEC, __lag_probe_timer_cb, NULL);
+	if (!lag_probe_timer)
+		_W("Failed to add main loop lag probe, main_loop_lag stays empty");
+
+	g_atomic_int_set(&trace_initialized, 1);
+
+	return 0;
+}
+
+void frame_trace_fini(void)
+{
+	__trace_ring_s *ring = NULL;
+
+	if (!g_atomic_int_get(&trace_initialized))
+		return;
+
+	g_atomic_int_set(&trace_initialized, 0);
+
+	ecore_timer_del(drain_timer);
+	drain_timer = NULL;
+	if (lag_probe_timer) {
+		ecore_timer_del(lag_probe_timer);
+		lag_probe_timer = NULL;
+	}
+
+	/* Threads still alive would only run the destructor on a freed ring */
+	pthread_key_delete(ring_key);
+
+	pthread_mutex_lock(&ring_mutex);
+	while ((ring = rings)) {
+		rings = ring->next;
+		free(ring);
+	}
+	pthread_mutex_unlock(&ring_mutex);
+}
+
+static void __append_json_histogram(GString *json, const __histogram_s *histogram)
+{
+	g_string_append_printf(json,
+		"{\"count\": %u, \"avg_us\": %lld, \"p50_us\": %lld, \"p90_us\": %lld, \"p99_us\": %lld, \"max_us\": %lld}",
+		histogram->count, histogram->sum_us / histogram->count,
+		__histogram_percentile(histogram, 50), __histogram_percentile(histogram, 90),
+		__histogram_percentile(histogram, 99), histogram->max_us);
+}
+
+void frame_trace_report(const char *path)
+{
+	GString *json = NULL;
+	GError *error = NULL;
+	const __histogram_s *histogram = NULL;
+	long long int now = frame_trace_get_time_us();
+	bool first_stage = true;
+	int camera = 0;
+	int stage = 0;
+
+	if (!g_atomic_int_get(&trace_initialized))
+		return;
+
+	__drain_rings();
+
+	if (dropped_records)
+		_W("frame trace - %u records dropped, rings are full between drains", dropped_records);
+
+	json = g_string_new(NULL);
+	g_string_append_printf(json, "{\"interval_ms\": %lld, \"dropped_records\": %u, \"cameras\": [",
+		(now - report_started_us) / 1000, dropped_records);
+
+	for (camera = 0; camera < CAMERA_COUNT; camera++) {
+		g_string_append_printf(json, "%s{\"index\": %d, \"stages\": {", camera ? ", " : "", camera);
+		first_stage = true;
+
+		for (stage = 0; stage < FRAME_TRACE_STAGE_MAX; stage++) {
+			histogram = &histograms[camera][stage];
+			if (histogram->count == 0)
+				continue;
+
+			_I("camera%d %s - count[%u], p50[%.1f ms], p90[%.1f ms], p99[%.1f ms], max[%.1f ms]",
+				camera, stage_names[stage], histogram->count,
+				__histogram_percentile(histogram, 50) / 1000.0, __histogram_percentile(histogram, 90) / 1000.0,
+				__histogram_percentile(histogram, 99) / 1000.0, histogram->max_us / 1000.0);
+
+			g_string_append_printf(json, "%s\"%s\": ", first_stage ? "" : ", ", stage_names[stage]);
+			__append_json_histogram(json, histogram);
+			first_stage = false;
+		}
+
+		g_string_append(json, "}}");
+	}
+	g_string_append(json, "]}\n");
+
+	/* Written to a temporary file and renamed, a reader never sees half a report */
+	if (path && !g_file_set_contents(path, json->str, json->len, &error)) {
+		_E("Failed to write frame trace report [%s]", error ? error->message : path);
+		g_clear_error(&error);
+	}
+
+	g_string_free(json, TRUE);
+
+	memset(histograms, 0, sizeof(histograms));
+	dropped_records = 0;
+	report_started_us = now;
+}
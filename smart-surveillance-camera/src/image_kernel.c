@@ -0,0 +1,569 @@
+ /*
+ * Copyright (c) 2018 Samsung Electronics Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+#include "log.h"
+#include "controller.h"
+#include "image_kernel.h"
+
+#if !defined(IMAGE_KERNEL_NO_SIMD) && (defined(__ARM_NEON) || defined(__ARM_NEON__))
+#include <arm_neon.h>
+#define IMAGE_KERNEL_NEON
+#elif !defined(IMAGE_KERNEL_NO_SIMD) && defined(__SSE2__)
+#include <emmintrin.h>
+#define IMAGE_KERNEL_SSE2
+#endif
+
+/*
+ * Every kernel handles 16 (or 32 source bytes) per step and finishes
+ * the remainder of the row in scalar code, rows never have to be padded.
+ */
+
+const char *image_kernel_get_backend(void)
+{
+#if defined(IMAGE_KERNEL_NEON)
+	return "neon";
+#elif defined(IMAGE_KERNEL_SSE2)
+	return "sse2";
+#else
+	return "scalar";
+#endif
+}
+
+int image_kernel_get_plane_geometry(camera_pixel_format_e format, int plane,
+	unsigned int width, unsigned int height, unsigned int *row_size, unsigned int *rows)
+{
+	*row_size = width;
+	*rows = height;
+
+	switch (format) {
+	case CAMERA_PIXEL_FORMAT_NV12:
+	case CAMERA_PIXEL_FORMAT_NV21:
+		if (plane > 0)
+			*rows = height / 2;
+		break;
+	case CAMERA_PIXEL_FORMAT_I420:
+	case CAMERA_PIXEL_FORMAT_YV12:
+		if (plane > 0) {
+			*row_size = width / 2;
+			*rows = height / 2;
+		}
+		break;
+	case CAMERA_PIXEL_FORMAT_422P:
+		if (plane > 0)
+			*row_size = width / 2;
+		break;
+	case CAMERA_PIXEL_FORMAT_NV16:
+		break;
+	case CAMERA_PIXEL_FORMAT_YUYV:
+	case CAMERA_PIXEL_FORMAT_UYVY:
+	case CAMERA_PIXEL_FORMAT_RGB565:
+		*row_size = width * 2;
+		break;
+	case CAMERA_PIXEL_FORMAT_RGB888:
+		*row_size = width * 3;
+		break;
+	case CAMERA_PIXEL_FORMAT_RGBA:
+	case CAMERA_PIXEL_FORMAT_ARGB:
+		*row_size = width * 4;
+		break;
+	default:
+		_E("unsupported format : %d", format);
+		return -1;
+	}
+
+	return 0;
+}
+
+void image_kernel_copy_plane(unsigned char *dst, unsigned int dst_stride,
+	const unsigned char *src, unsigned int src_stride, unsigned int row_size, unsigned int rows)
+{
+	unsigned int row = 0;
+
+	if (dst_stride == row_size && src_stride == row_size) {
+		memcpy(dst, src, (size_t)row_size * rows);
+		return;
+	}
+
+	for (row = 0; row < rows; row++)
+		memcpy(dst + (size_t)dst_stride * row, src + (size_t)src_stride * row, row_size);
+}
+
+static void __deinterleave_uv_row(const unsigned char *uv, unsigned char *u, unsigned char *v, unsigned int count)
+{
+	unsigned int i = 0;
+
+#if defined(IMAGE_KERNEL_NEON)
+	for (; i + 16 <= count; i += 16) {
+		uint8x16x2_t pixels = vld2q_u8(uv + 2 * i);
+		vst1q_u8(u + i, pixels.val[0]);
+		vst1q_u8(v + i, pixels.val[1]);
+	}
+#elif defined(IMAGE_KERNEL_SSE2)
+	const __m128i low_mask = _mm_set1_epi16(0x00ff);
+
+	for (; i + 16 <= count; i += 16) {
+		__m128i first = _mm_loadu_si128((const __m128i *)(uv + 2 * i));
+		__m128i second = _mm_loadu_si128((const __m128i *)(uv + 2 * i + 16));
+		__m128i even = _mm_packus_epi16(_mm_and_si128(first, low_mask), _mm_and_si128(second, low_mask));
+		__m128i odd = _mm_packus_epi16(_mm_srli_epi16(first, 8), _mm_srli_epi16(second, 8));
+		_mm_storeu_si128((__m128i *)(u + i), even);
+		_mm_storeu_si128((__m128i *)(v + i), odd);
+	}
+#endif
+
+	for (; i < count; i++) {
+		u[i] = uv[2 * i];
+		v[i] = uv[2 * i + 1];
+	}
+}
+
+static void __interleave_uv_row(const unsigned char *u, const unsigned char *v, unsigned char *uv, unsigned int count)
+{
+	unsigned int i = 0;
+
+#if defined(IMAGE_KERNEL_NEON)
+	for (; i + 16 <= count; i += 16) {
+		uint8x16x2_t pixels;
+		pixels.val[0] = vld1q_u8(u + i);
+		pixels.val[1] = vld1q_u8(v + i);
+		vst2q_u8(uv + 2 * i, pixels);
+	}
+#elif defined(IMAGE_KERNEL_SSE2)
+	for (; i + 16 <= count; i += 16) {
+		__m128i u_pixels = _mm_loadu_si128((const __m128i *)(u + i));
+		__m128i v_pixels = _mm_loadu_si128((const __m128i *)(v + i));
+		_mm_storeu_si128((__m128i *)(uv + 2 * i), _mm_unpacklo_epi8(u_pixels, v_pixels));
+		_mm_storeu_si128((__m128i *)(uv + 2 * i + 16), _mm_unpackhi_epi8(u_pixels, v_pixels));
+	}
+#endif
+
+	for (; i < count; i++) {
+		uv[2 * i] = u[i];
+		uv[2 * i + 1] = v[i];
+	}
+}
+
+void image_kernel_nv12_to_i420(const unsigned char *src_y, unsigned int src_y_stride,
+	const unsigned char *src_uv, unsigned int src_uv_stride,
+	unsigned char *dst_y, unsigned char *dst_u, unsigned char *dst_v,
+	unsigned int width, unsigned int height)
+{
+	unsigned int row = 0;
+
+	image_kernel_copy_plane(dst_y, width, src_y, src_y_stride, width, height);
+
+	for (row = 0; row < height / 2; row++)
+		__deinterleave_uv_row(src_uv + (size_t)src_uv_stride * row,
+			dst_u + (size_t)(width / 2) * row, dst_v + (size_t)(width / 2) * row, width / 2);
+}
+
+void image_kernel_i420_to_nv12(const unsigned char *src_y, const unsigned char *src_u, const unsigned char *src_v,
+	unsigned char *dst_y, unsigned char *dst_uv, unsigned int width, unsigned int height)
+{
+	unsigned int row = 0;
+
+	image_kernel_copy_plane(dst_y, width, src_y, width, width, height);
+
+	for (row = 0; row < height / 2; row++)
+		__interleave_uv_row(src_u + (size_t)(width / 2) * row, src_v + (size_t)(width / 2) * row,
+			dst_uv + (size_t)width * row, width / 2);
+}
+
+/* Two source rows to two luma rows and one row of each chroma */
+static void __yuv422_rows_to_i420(const unsigned char *src0, const unsigned char *src1, int y_offset,
+	unsigned char *dst_y0, unsigned char *dst_y1, unsigned char *dst_u, unsigned char *dst_v, unsigned int width)
+{
+	unsigned int i = 0; // pixel pairs
+	int c_offset = 1 - y_offset;
+
+#if defined(IMAGE_KERNEL_NEON)
+	for (; i + 16 <= width / 2; i += 16) {
+		uint8x16x4_t row0 = vld4q_u8(src0 + 4 * i);
+		uint8x16x4_t row1 = vld4q_u8(src1 + 4 * i);
+		uint8x16x2_t luma;
+
+		luma.val[0] = row0.val[y_offset];
+		luma.val[1] = row0.val[y_offset + 2];
+		vst2q_u8(dst_y0 + 2 * i, luma);
+		luma.val[0] = row1.val[y_offset];
+		luma.val[1] = row1.val[y_offset + 2];
+		vst2q_u8(dst_y1 + 2 * i, luma);
+
+		vst1q_u8(dst_u + i, vrhaddq_u8(row0.val[c_offset], row1.val[c_offset]));
+		vst1q_u8(dst_v + i, vrhaddq_u8(row0.val[c_offset + 2], row1.val[c_offset + 2]));
+	}
+#elif defined(IMAGE_KERNEL_SSE2)
+	const __m128i low_mask = _mm_set1_epi16(0x00ff);
+
+	for (; i + 8 <= width / 2; i += 8) {
+		__m128i row0_a = _mm_loadu_si128((const __m128i *)(src0 + 4 * i));
+		__m128i row0_b = _mm_loadu_si128((const __m128i *)(src0 + 4 * i + 16));
+		__m128i row1_a = _mm_loadu_si128((const __m128i *)(src1 + 4 * i));
+		__m128i row1_b = _mm_loadu_si128((const __m128i *)(src1 + 4 * i + 16));
+		__m128i luma0, luma1, chroma0, chroma1, chroma;
+
+		if (y_offset == 0) {
+			luma0 = _mm_packus_epi16(_mm_and_si128(row0_a, low_mask), _mm_and_si128(row0_b, low_mask));
+			luma1 = _mm_packus_epi16(_mm_and_si128(row1_a, low_mask), _mm_and_si128(row1_b, low_mask));
+			chroma0 = _mm_packus_epi16(_mm_srli_epi16(row0_a, 8), _mm_srli_epi16(row0_b, 8));
+			chroma1 = _mm_packus_epi16(_mm_srli_epi16(row1_a, 8), _mm_srli_epi16(row1_b, 8));
+		} else {
+			luma0 = _mm_packus_epi16(_mm_srli_epi16(row0_a, 8), _mm_srli_epi16(row0_b, 8));
+			luma1 = _mm_packus_epi16(_mm_srli_epi16(row1_a, 8), _mm_srli_epi16(row1_b, 8));
+			chroma0 = _mm_packus_epi16(_mm_and_si128(row0_a, low_mask), _mm_and_si128(row0_b, low_mask));
+			chroma1 = _mm_packus_epi16(_mm_and_si128(row1_a, low_mask), _mm_and_si128(row1_b, low_mask));
+		}
+		_mm_storeu_si128((__m128i *)(dst_y0 + 2 * i), luma0);
+		_mm_storeu_si128((__m128i *)(dst_y1 + 2 * i), luma1);
+
+		/* 8 UV pairs left, U in the even bytes */
+		chroma = _mm_avg_epu8(chroma0, chroma1);
+		chroma = _mm_packus_epi16(_mm_and_si128(chroma, low_mask), _mm_srli_epi16(chroma, 8));
+		_mm_storel_epi64((__m128i *)(dst_u + i), chroma);
+		_mm_storel_epi64((__m128i *)(dst_v + i), _mm_srli_si128(chroma, 8));
+	}
+#endif
+
+	for (; i < width / 2; i++) {
+		dst_y0[2 * i] = src0[4 * i + y_offset];
+		dst_y0[2 * i + 1] = src0[4 * i + y_offset + 2];
+		dst_y1[2 * i] = src1[4 * i + y_offset];
+		dst_y1[2 * i + 1] = src1[4 * i + y_offset + 2];
+		dst_u[i] = (src0[4 * i + c_offset] + src1[4 * i + c_offset] + 1) >> 1;
+		dst_v[i] = (src0[4 * i + c_offset + 2] + src1[4 * i + c_offset + 2] + 1) >> 1;
+	}
+}
+
+void image_kernel_yuv422_to_i420(camera_pixel_format_e format, const unsigned char *src, unsigned int src_stride,
+	unsigned char *dst_y, unsigned char *dst_u, unsigned char *dst_v,
+	unsigned int width, unsigned int height)
+{
+	int y_offset = (format == CAMERA_PIXEL_FORMAT_UYVY) ? 1 : 0;
+	unsigned int row = 0;
+
+	for (row = 0; row + 1 < height; row += 2)
+		__yuv422_rows_to_i420(src + (size_t)src_stride * row, src + (size_t)src_stride * (row + 1), y_offset,
+			dst_y + (size_t)width * row, dst_y + (size_t)width * (row + 1),
+			dst_u + (size_t)(width / 2) * (row / 2), dst_v + (size_t)(width / 2) * (row / 2), width);
+}
+
+void image_kernel_downscale_luma_2x(const unsigned char *src, unsigned int src_stride,
+	unsigned char *dst, unsigned int dst_stride, unsigned int width, unsigned int height)
+{
+	unsigned int row = 0;
+
+	for (row = 0; row < height / 2; row++) {
+		const unsigned char *src0 = src + (size_t)src_stride * (2 * row);
+		const unsigned char *src1 = src0 + src_stride;
+		unsigned char *out = dst + (size_t)dst_stride * row;
+		unsigned int i = 0; // output pixels
+
+#if defined(IMAGE_KERNEL_NEON)
+		for (; i + 8 <= width / 2; i += 8) {
+			uint16x8_t sum = vaddq_u16(vpaddlq_u8(vld1q_u8(src0 + 2 * i)), vpaddlq_u8(vld1q_u8(src1 + 2 * i)));
+			vst1_u8(out + i, vrshrn_n_u16(sum, 2));
+		}
+#elif defined(IMAGE_KERNEL_SSE2)
+		const __m128i low_mask = _mm_set1_epi16(0x00ff);
+		const __m128i rounding = _mm_set1_epi16(2);
+
+		for (; i + 16 <= width / 2; i += 16) {
+			__m128i sum[2];
+			int half = 0;
+
+			for (half = 0; half < 2; half++) {
+				__m128i row0 = _mm_loadu_si128((const __m128i *)(src0 + 2 * i + 16 * half));
+				__m128i row1 = _mm_loadu_si128((const __m128i *)(src1 + 2 * i + 16 * half));
+				__m128i total = _mm_add_epi16(_mm_and_si128(row0, low_mask), _mm_srli_epi16(row0, 8));
+				total = _mm_add_epi16(total, _mm_and_si128(row1, low_mask));
+				total = _mm_add_epi16(total, _mm_srli_epi16(row1, 8));
+				sum[half] = _mm_srli_epi16(_mm_add_epi16(total, rounding), 2);
+			}
+			_mm_storeu_si128((__m128i *)(out + i), _mm_packus_epi16(sum[0], sum[1]));
+		}
+#endif
+
+		for (; i < width / 2; i++)
+			out[i] = (src0[2 * i] + src0[2 * i + 1] + src1[2 * i] + src1[2 * i + 1] + 2) >> 2;
+	}
+}
+
+void image_kernel_yuv422_to_luma(camera_pixel_format_e format, const unsigned char *src, unsigned int src_stride,
+	unsigned char *dst, unsigned int width, unsigned int height)
+{
+	int y_offset = (format == CAMERA_PIXEL_FORMAT_UYVY) ? 1 : 0;
+	unsigned int row = 0;
+
+	for (row = 0; row < height; row++) {
+		const unsigned char *in = src + (size_t)src_stride * row;
+		unsigned char *out = dst + (size_t)width * row;
+		unsigned int i = 0;
+
+#if defined(IMAGE_KERNEL_NEON)
+		for (; i + 16 <= width; i += 16) {
+			uint8x16x2_t pixels = vld2q_u8(in + 2 * i);
+			vst1q_u8(out + i, pixels.val[y_offset]);
+		}
+#elif defined(IMAGE_KERNEL_SSE2)
+		const __m128i low_mask = _mm_set1_epi16(0x00ff);
+
+		for (; i + 16 <= width; i += 16) {
+			__m128i first = _mm_loadu_si128((const __m128i *)(in + 2 * i));
+			__m128i second = _mm_loadu_si128((const __m128i *)(in + 2 * i + 16));
+			__m128i luma;
+
+			if (y_offset == 0)
+				luma = _mm_packus_epi16(_mm_and_si128(first, low_mask), _mm_and_si128(second, low_mask));
+			else
+				luma = _mm_packus_epi16(_mm_srli_epi16(first, 8), _mm_srli_epi16(second, 8));
+			_mm_storeu_si128((__m128i *)(out + i), luma);
+		}
+#endif
+
+		for (; i < width; i++)
+			out[i] = in[2 * i + y_offset];
+	}
+}
+
+void image_kernel_background_diff(const unsigned char *src, const unsigned short *background,
+	unsigned char *mask, unsigned int count, unsigned char threshold)
+{
+	unsigned int i = 0;
+
+#if defined(IMAGE_KERNEL_NEON)
+	const uint8x16_t limit = vdupq_n_u8(threshold);
+
+	for (; i + 16 <= count; i += 16) {
+		/* Saturating, a background right under 256 rounds up to 256 */
+		uint8x16_t level = vcombine_u8(vqrshrn_n_u16(vld1q_u16(background + i), 8),
+			vqrshrn_n_u16(vld1q_u16(background + i + 8), 8));
+		vst1q_u8(mask + i, vcgtq_u8(vabdq_u8(vld1q_u8(src + i), level), limit));
+	}
+#elif defined(IMAGE_KERNEL_SSE2)
+	const __m128i limit = _mm_set1_epi8((char)threshold);
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i one = _mm_set1_epi16(1);
+	const __m128i all_set = _mm_set1_epi8((char)0xff);
+
+	for (; i + 16 <= count; i += 16) {
+		__m128i low = _mm_loadu_si128((const __m128i *)(background + i));
+		__m128i high = _mm_loadu_si128((const __m128i *)(background + i + 8));
+		__m128i pixels = _mm_loadu_si128((const __m128i *)(src + i));
+		__m128i level, diff, over;
+
+		/* (x >> 8) + bit 7 rounds without overflowing 16 bits, packus clamps 256 to 255 */
+		low = _mm_add_epi16(_mm_srli_epi16(low, 8), _mm_and_si128(_mm_srli_epi16(low, 7), one));
+		high = _mm_add_epi16(_mm_srli_epi16(high, 8), _mm_and_si128(_mm_srli_epi16(high, 7), one));
+		level = _mm_packus_epi16(low, high);
+
+		diff = _mm_or_si128(_mm_subs_epu8(pixels, level), _mm_subs_epu8(level, pixels));
+		over = _mm_cmpeq_epi8(_mm_subs_epu8(diff, limit), zero);
+		_mm_storeu_si128((__m128i *)(mask + i), _mm_xor_si128(over, all_set));
+	}
+#endif
+
+	for (; i < count; i++) {
+		int level = (background[i] + 128) >> 8;
+		int diff = 0;
+
+		if (level > 255)
+			level = 255;
+		diff = src[i] > level ? src[i] - level : level - src[i];
+		mask[i] = diff > threshold ? 255 : 0;
+	}
+}
+
+void image_kernel_background_update(unsigned short *background, const unsigned char *src, const unsigned char *mask,
+	unsigned int count, unsigned int background_shift, unsigned int foreground_shift)
+{
+	unsigned int i = 0;
+
+	/*
+	 * b += ((src << 8) - b) >> s is computed as b - (b >> s) + (src << (8 - s)),
+	 * every term fits 16 bits for 1 <= s <= 8 and the truncation stays under 2^s / 256 of a level.
+	 */
+#if defined(IMAGE_KERNEL_NEON)
+	const int16x8_t background_right = vdupq_n_s16(-(int)background_shift);
+	const int16x8_t background_left = vdupq_n_s16(8 - (int)background_shift);
+	const int16x8_t foreground_right = vdupq_n_s16(-(int)foreground_shift);
+	const int16x8_t foreground_left = vdupq_n_s16(8 - (int)foreground_shift);
+
+	for (; i + 8 <= count; i += 8) {
+		uint16x8_t current = vld1q_u16(background + i);
+		uint16x8_t pixels = vmovl_u8(vld1_u8(src + i));
+		uint16x8_t moving = vmovl_u8(vld1_u8(mask + i));
+		uint16x8_t as_background = vaddq_u16(vsubq_u16(current, vshlq_u16(current, background_right)),
+			vshlq_u16(pixels, background_left));
+		uint16x8_t as_foreground = vaddq_u16(vsubq_u16(current, vshlq_u16(current, foreground_right)),
+			vshlq_u16(pixels, foreground_left));
+
+		vst1q_u16(background + i, vbslq_u16(vtstq_u16(moving, moving), as_foreground, as_background));
+	}
+#elif defined(IMAGE_KERNEL_SSE2)
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i background_right = _mm_cvtsi32_si128(background_shift);
+	const __m128i background_left = _mm_cvtsi32_si128(8 - background_shift);
+	const __m128i foreground_right = _mm_cvtsi32_si128(foreground_shift);
+	const __m128i foreground_left = _mm_cvtsi32_si128(8 - foreground_shift);
+
+	for (; i + 8 <= count; i += 8) {
+		__m128i current = _mm_loadu_si128((const __m128i *)(background + i));
+		__m128i pixels = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(src + i)), zero);
+		__m128i moving = _mm_loadl_epi64((const __m128i *)(mask + i));
+		__m128i as_background = _mm_add_epi16(_mm_sub_epi16(current, _mm_srl_epi16(current, background_right)),
+			_mm_sll_epi16(pixels, background_left));
+		__m128i as_foreground = _mm_add_epi16(_mm_sub_epi16(current, _mm_srl_epi16(current, foreground_right)),
+			_mm_sll_epi16(pixels, foreground_left));
+
+		/* 0 / 255 bytes doubled up to 0 / 0xffff words */
+		moving = _mm_unpacklo_epi8(moving, moving);
+		_mm_storeu_si128((__m128i *)(background + i),
+			_mm_or_si128(_mm_and_si128(moving, as_foreground), _mm_andnot_si128(moving, as_background)));
+	}
+#endif
+
+	for (; i < count; i++) {
+		unsigned int shift = mask[i] ? foreground_shift : background_shift;
+
+		background[i] = background[i] - (background[i] >> shift) + (src[i] << (8 - shift));
+	}
+}
+
+/* out = min or max of a, b and c */
+static void __min_max_3(const unsigned char *a, const unsigned char *b, const unsigned char *c,
+	unsigned char *out, unsigned int count, int dilate)
+{
+	unsigned int i = 0;
+
+#if defined(IMAGE_KERNEL_NEON)
+	for (; i + 16 <= count; i += 16) {
+		uint8x16_t pixels_a = vld1q_u8(a + i);
+		uint8x16_t pixels_b = vld1q_u8(b + i);
+		uint8x16_t pixels_c = vld1q_u8(c + i);
+
+		if (dilate)
+			vst1q_u8(out + i, vmaxq_u8(vmaxq_u8(pixels_a, pixels_b), pixels_c));
+		else
+			vst1q_u8(out + i, vminq_u8(vminq_u8(pixels_a, pixels_b), pixels_c));
+	}
+#elif defined(IMAGE_KERNEL_SSE2)
+	for (; i + 16 <= count; i += 16) {
+		__m128i pixels_a = _mm_loadu_si128((const __m128i *)(a + i));
+		__m128i pixels_b = _mm_loadu_si128((const __m128i *)(b + i));
+		__m128i pixels_c = _mm_loadu_si128((const __m128i *)(c + i));
+
+		if (dilate)
+			_mm_storeu_si128((__m128i *)(out + i), _mm_max_epu8(_mm_max_epu8(pixels_a, pixels_b), pixels_c));
+		else
+			_mm_storeu_si128((__m128i *)(out + i), _mm_min_epu8(_mm_min_epu8(pixels_a, pixels_b), pixels_c));
+	}
+#endif
+
+	for (; i < count; i++) {
+		unsigned char value = b[i];
+
+		if (dilate) {
+			if (a[i] > value)
+				value = a[i];
+			if (c[i] > value)
+				value = c[i];
+		} else {
+			if (a[i] < value)
+				value = a[i];
+			if (c[i] < value)
+				value = c[i];
+		}
+		out[i] = value;
+	}
+}
+
+/* Separable, a row pass into tmp then a column pass. Edge pixels are replicated */
+static void __morph_3x3(const unsigned char *src, unsigned char *dst, unsigned char *tmp,
+	unsigned int width, unsigned int height, int dilate)
+{
+	unsigned int row = 0;
+
+	if (width < 2 || height == 0) {
+		memcpy(dst, src, (size_t)width * height);
+		return;
+	}
+
+	for (row = 0; row < height; row++) {
+		const unsigned char *in = src + (size_t)width * row;
+		unsigned char *out = tmp + (size_t)width * row;
+
+		__min_max_3(in, in, in + 1, out, 1, dilate);
+		__min_max_3(in, in + 1, in + 2, out + 1, width - 2, dilate);
+		__min_max_3(in + width - 2, in + width - 1, in + width - 1, out + width - 1, 1, dilate);
+	}
+
+	for (row = 0; row < height; row++) {
+		const unsigned char *above = tmp + (size_t)width * (row > 0 ? row - 1 : 0);
+		const unsigned char *below = tmp + (size_t)width * (row + 1 < height ? row + 1 : row);
+
+		__min_max_3(above, tmp + (size_t)width * row, below, dst + (size_t)width * row, width, dilate);
+	}
+}
+
+void image_kernel_erode_3x3(const unsigned char *src, unsigned char *dst, unsigned char *tmp,
+	unsigned int width, unsigned int height)
+{
+	__morph_3x3(src, dst, tmp, width, height, 0);
+}
+
+void image_kernel_dilate_3x3(const unsigned char *src, unsigned char *dst, unsigned char *tmp,
+	unsigned int width, unsigned int height)
+{
+	__morph_3x3(src, dst, tmp, width, height, 1);
+}
+
+int image_kernel_convert_to_i420(camera_pixel_format_e format, const unsigned char *src,
+	unsigned int width, unsigned int height, unsigned char *dst)
+{
+	unsigned int luma_size = width * height;
+	unsigned int chroma_size = (width / 2) * (height / 2);
+	unsigned char *dst_u = dst + luma_size;
+	unsigned char *dst_v = dst_u + chroma_size;
+
+	retv_if(!src, -1);
+	retv_if(!dst, -1);
+
+	switch (format) {
+	case CAMERA_PIXEL_FORMAT_I420:
+		memcpy(dst, src, luma_size + 2 * chroma_size);
+		break;
+	case CAMERA_PIXEL_FORMAT_YV12:
+		memcpy(dst, src, luma_size);
+		memcpy(dst_u, src + luma_size + chroma_size, chroma_size);
+		memcpy(dst_v, src + luma_size, chroma_size);
+		break;
+	case CAMERA_PIXEL_FORMAT_NV12:
+		image_kernel_nv12_to_i420(src, width, src + luma_size, width, dst, dst_u, dst_v, width, height);
+		break;
+	case CAMERA_PIXEL_FORMAT_NV21:
+		image_kernel_nv12_to_i420(src, width, src + luma_size, width, dst, dst_v, dst_u, width, height);
+		break;
+	case CAMERA_PIXEL_FORMAT_YUYV:
+	case CAMERA_PIXEL_FORMAT_UYVY:
+		image_kernel_yuv422_to_i420(format, src, width * 2, dst, dst_u, dst_v, width, height);
+		break;
+	default:
+		return -1;
+	}
+
+	return 0;
+}
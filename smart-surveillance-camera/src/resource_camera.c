@@ -15,18 +15,44 @@
  */
 
 #include <stdlib.h>
+#include <limits.h>
+#include <time.h>
+#include <pthread.h>
 #include <Ecore.h>
 #include <camera.h>
 
 #include "log.h"
 #include "controller.h"
 #include "resource_camera.h"
+#include "frame_pool.h"
+#include "frame_queue.h"
+#include "frame_governor.h"
+#include "frame_trace.h"
+#include "image_kernel.h"
+
+#ifndef CAMERA_BACKEND_SYNTHETIC
+
+struct __resolution_s {
+	int width;
+	int height;
+	int best_width;
+	int best_height;
+};
 
 struct __camera_data {
+	int camera_index;
 	camera_h cam_handle;
+	frame_pool_h frame_pool;
+	frame_queue_h frame_queue;
+	frame_governor_h frame_governor;
+
+	int preview_width;
+	int preview_height;
+	camera_pixel_format_e preview_format;
 
-	void *captured_file;
-	unsigned int image_size;
+	frame_pool_h capture_pool;
+	image_buffer_data_s *captured_image;
+	long long int capture_started_us;
 
 	preview_image_buffer_created_cb preview_image_buffer_created_cb;
 	void *preview_image_buffer_created_cb_data;
@@ -35,9 +61,13 @@ struct __camera_data {
 	void *capture_completed_cb_data;
 
 	bool is_af_enabled;
-};
 
-static struct __camera_data *g_camera_data = NULL;
+	/* A still completes on the camera thread, stopping waits for it */
+	pthread_mutex_t capture_mutex;
+	pthread_cond_t capture_cond;
+	bool capturing; // to capture_mutex
+	bool stopped; // written to capture_mutex, resource_camera_stop() was called, no callback comes anymore
+};
 
 static const char * __cam_err_to_str(camera_error_e err)
 {
@@ -118,100 +148,6 @@ static void __print_camera_state(camera_state_e previous, camera_state_e current
 	}
 }
 
-static long long int __get_monotonic_ms(void)
-{
-	long long int ret_time = 0;
-	struct timespec time_s;
-
-	if (0 == clock_gettime(CLOCK_MONOTONIC, &time_s))
-		ret_time = time_s.tv_sec* 1000 + time_s.tv_nsec / 1000000;
-	else
-		_E("Failed to get time");
-
-	return ret_time;
-}
-
-static image_buffer_data_s *__make_preview_image_buffer_data(camera_preview_data_s *frame)
-{
-	unsigned char *buffer = NULL;
-	unsigned int buffer_size = 0;
-
-	image_buffer_data_s *image_buffer = malloc(sizeof(image_buffer_data_s));
-	if (image_buffer == NULL) {
-		_E("Failed to allocate image buffer data");
-		goto ERROR;
-	}
-
-	switch (frame->num_of_planes) {
-	case 1:
-		buffer_size = frame->data.single_plane.size;
-		buffer = malloc(buffer_size);
-		if (!buffer) {
-			_E("failed to malloc buffer");
-			goto ERROR;
-		}
-		memcpy(buffer, frame->data.single_plane.yuv, buffer_size);
-		break;
-	case 2:
-		{
-			unsigned char *buffer2 = NULL;
-			buffer_size =
-				frame->data.double_plane.y_size + frame->data.double_plane.uv_size;
-			buffer = malloc(buffer_size);
-			if (!buffer) {
-				_E("failed to malloc buffer");
-				goto ERROR;
-			}
-			buffer2 = buffer + frame->data.double_plane.y_size;
-			memcpy(buffer,
-				frame->data.double_plane.y, frame->data.double_plane.y_size);
-			memcpy(buffer2,
-				frame->data.double_plane.uv, frame->data.double_plane.uv_size);
-		}
-		break;
-	case 3:
-		{
-			unsigned char *buffer2 = NULL;
-			unsigned char *buffer3 = NULL;
-			buffer_size = frame->data.triple_plane.y_size
-						+ frame->data.triple_plane.u_size
-						+ frame->data.triple_plane.v_size;
-			buffer = malloc(buffer_size);
-			if (!buffer) {
-				_E("failed to malloc buffer");
-				goto ERROR;
-			}
-			buffer2 = buffer + frame->data.triple_plane.y_size;
-			buffer3 = buffer2 + frame->data.triple_plane.u_size;
-			memcpy(buffer,
-				frame->data.triple_plane.y, frame->data.triple_plane.y_size);
-			memcpy(buffer2,
-				frame->data.triple_plane.u, frame->data.triple_plane.u_size);
-			memcpy(buffer3,
-				frame->data.triple_plane.v, frame->data.triple_plane.v_size);
-		}
-		break;
-	default:
-		_E("unhandled num of planes : %d", frame->num_of_planes);
-		goto ERROR;
-		break;
-	}
-
-	image_buffer->image_width = frame->width;
-	image_buffer->image_height = frame->height;
-	image_buffer->buffer_size = buffer_size;
-	image_buffer->buffer = buffer;
-	image_buffer->format = frame->format;
-
-	return image_buffer;
-
-ERROR:
-	free(buffer);
-	free(image_buffer);
-
-	return NULL;
-}
-
 static bool __camera_attr_supported_af_mode_cb(camera_attr_af_mode_e mode, void *user_data)
 {
 	struct __camera_data *camera_data = user_data;
@@ -224,172 +160,596 @@ static bool __camera_attr_supported_af_mode_cb(camera_attr_af_mode_e mode, void
 	return true;
 }
 
+static bool __supported_resolution_cb(int width, int height, void *user_data)
+{
+	struct __resolution_s *resolution = user_data;
+	bool fits = (width <= resolution->width && height <= resolution->height);
+	bool best_fits = (resolution->best_width <= resolution->width && resolution->best_height <= resolution->height);
+	int area = width * height;
+	int best_area = resolution->best_width * resolution->best_height;
+
+	_D("supported resolution [%d x %d]", width, height);
+
+	/* Largest one within the wanted size, or the smallest one if nothing fits */
+	if (best_area == 0
+		|| (fits && !best_fits)
+		|| (fits == best_fits && (fits ? area > best_area : area < best_area))) {
+		resolution->best_width = width;
+		resolution->best_height = height;
+	}
+
+	return true;
+}
+
 static void __capturing_cb(camera_image_data_s *image, camera_image_data_s *postview, camera_image_data_s *thumbnail, void *user_data)
 {
 	struct __camera_data *camera_data = user_data;
+	image_buffer_data_s *image_buffer = NULL;
+
 	if (image == NULL) {
 		_E("Image is NULL");
 		return;
 	}
 
-	free(camera_data->captured_file);
-	camera_data->captured_file = malloc(image->size);
-	if (camera_data->captured_file == NULL)
+	image_buffer = frame_pool_acquire(camera_data->capture_pool);
+	if (image_buffer == NULL) {
+		_E("No free capture buffer");
+		return;
+	}
+
+	if (image->size > image_buffer->buffer_size) {
+		_E("captured image [%u] exceeds capture buffer [%u]", image->size, image_buffer->buffer_size);
+		image_buffer_unref(image_buffer);
 		return;
+	}
 
 	_D("Now is on Capturing: Image size[%d x %d]", image->width, image->height);
 
-	memcpy(camera_data->captured_file, image->data, image->size);
-	camera_data->image_size = image->size;
+	memcpy(image_buffer->buffer, image->data, image->size);
+	image_buffer->buffer_size = image->size;
+	image_buffer->image_width = image->width;
+	image_buffer->image_height = image->height;
+	image_buffer->format = image->format;
+	image_buffer->timestamp_us = camera_data->capture_started_us;
+	image_buffer->trace_time_us = frame_trace_get_time_us();
+
+	/* One still per capture, a leftover one was never completed */
+	if (camera_data->captured_image)
+		image_buffer_unref(camera_data->captured_image);
+	camera_data->captured_image = image_buffer;
+}
 
-	return;
+static void __capture_done(struct __camera_data *camera_data)
+{
+	pthread_mutex_lock(&camera_data->capture_mutex);
+	camera_data->capturing = false;
+	pthread_cond_broadcast(&camera_data->capture_cond);
+	pthread_mutex_unlock(&camera_data->capture_mutex);
 }
 
 static void __completed_cb(void *user_data)
 {
 	int ret = 0;
 	struct __camera_data *camera_data = user_data;
+	image_buffer_data_s *image_buffer = camera_data->captured_image;
+	capture_completed_cb completed_cb = camera_data->capture_completed_cb;
+	bool stopped = false;
 
-	if (camera_data->capture_completed_cb)
-		camera_data->capture_completed_cb(camera_data->captured_file, camera_data->image_size, camera_data->capture_completed_cb_data);
-
+	camera_data->captured_image = NULL;
 	camera_data->capture_completed_cb = NULL;
-	free(camera_data->captured_file);
-	camera_data->captured_file = NULL;
 
+	pthread_mutex_lock(&camera_data->capture_mutex);
+	stopped = camera_data->stopped;
+	pthread_mutex_unlock(&camera_data->capture_mutex);
+
+	/* Stopped while capturing, the still goes nowhere and the preview stays off */
+	if (stopped) {
+		image_buffer_unref(image_buffer);
+		__capture_done(camera_data);
+		return;
+	}
+
+	/* Preview first, analysis is starved until it runs again */
 	if (!camera_data->cam_handle) {
 		_E("Camera is NULL");
-		return;
+	} else {
+		ret = camera_start_preview(camera_data->cam_handle);
+		if (ret != CAMERA_ERROR_NONE)
+			_E("Failed to start preview [%s]", __cam_err_to_str(ret));
+		else
+			frame_trace_record(FRAME_TRACE_STAGE_PREVIEW_GAP, camera_data->camera_index,
+				image_buffer ? image_buffer->sequence : 0,
+				camera_data->capture_started_us, frame_trace_get_time_us());
 	}
 
-	ret = camera_start_preview(camera_data->cam_handle);
-	if (ret != CAMERA_ERROR_NONE) {
-		_E("Failed to start preview [%s]", __cam_err_to_str(ret));
-		return;
+	if (image_buffer) {
+		if (completed_cb)
+			completed_cb(image_buffer, camera_data->capture_completed_cb_data);
+		else
+			image_buffer_unref(image_buffer);
 	}
 
-    return;
+	__capture_done(camera_data);
 }
 
-static void __start_capture(void *user_data)
+static int __start_capture(void *user_data)
 {
 	int ret = 0;
 	struct __camera_data *camera_data = user_data;
 
+	camera_data->capture_started_us = frame_trace_get_time_us();
+
 	ret = camera_start_capture(camera_data->cam_handle, __capturing_cb, __completed_cb, camera_data);
 	if (ret != CAMERA_ERROR_NONE) {
 		_E("Failed to start capturing [%s]", __cam_err_to_str(ret));
-		return;
+		return -1;
+	}
+
+	return 0;
+}
+
+static void __frame_queue_consume_cb(image_buffer_data_s *image_buffer, void *user_data)
+{
+	struct __camera_data *camera_data = user_data;
+	long long int now = frame_trace_get_time_us();
+
+	frame_trace_record(FRAME_TRACE_STAGE_QUEUE, camera_data->camera_index, image_buffer->sequence,
+		image_buffer->trace_time_us, now);
+	image_buffer->trace_time_us = now;
+
+	image_buffer->user_data = camera_data->preview_image_buffer_created_cb_data;
+	camera_data->preview_image_buffer_created_cb(image_buffer);
+}
+
+static void __deliver_preview_image_buffer(struct __camera_data *camera_data, image_buffer_data_s *image_buffer)
+{
+	/* The frame was taken from the pool as the preview callback started */
+	image_buffer->trace_time_us = frame_trace_get_time_us();
+	frame_trace_record(FRAME_TRACE_STAGE_CAPTURE, camera_data->camera_index, image_buffer->sequence,
+		image_buffer->timestamp_us, image_buffer->trace_time_us);
+
+	frame_queue_push(camera_data->frame_queue, image_buffer);
+}
+
+#ifdef ENABLE_CAMERA_ZERO_COPY
+/* Returns the packet data if all planes are tightly packed back to back, NULL otherwise */
+static unsigned char *__get_contiguous_packet_data(struct __camera_data *camera_data,
+	media_packet_h packet, uint32_t num_of_planes, unsigned int *size)
+{
+	unsigned char *base = NULL;
+	unsigned char *expected = NULL;
+	unsigned int row_size = 0;
+	unsigned int rows = 0;
+	uint32_t i = 0;
+
+	for (i = 0; i < num_of_planes; i++) {
+		void *plane = NULL;
+		int stride_width = 0;
+		int stride_height = 0;
+
+		if (media_packet_get_video_plane_data_ptr(packet, i, &plane) != MEDIA_PACKET_ERROR_NONE)
+			return NULL;
+		if (media_packet_get_video_stride_width(packet, i, &stride_width) != MEDIA_PACKET_ERROR_NONE)
+			return NULL;
+		if (media_packet_get_video_stride_height(packet, i, &stride_height) != MEDIA_PACKET_ERROR_NONE)
+			return NULL;
+
+		if (image_kernel_get_plane_geometry(camera_data->preview_format, i,
+			camera_data->preview_width, camera_data->preview_height, &row_size, &rows))
+			return NULL;
+
+		if (stride_width != (int)row_size || stride_height != (int)rows)
+			return NULL;
+
+		if (i == 0)
+			base = plane;
+		else if (plane != expected)
+			return NULL;
+
+		expected = (unsigned char *)plane + row_size * rows;
+	}
+
+	*size = expected - base;
+
+	return base;
+}
+
+static int __copy_packet_planes(struct __camera_data *camera_data,
+	media_packet_h packet, uint32_t num_of_planes, image_buffer_data_s *image_buffer)
+{
+	unsigned char *dst = image_buffer->buffer;
+	unsigned char *dst_end = image_buffer->buffer + image_buffer->buffer_size;
+	unsigned int row_size = 0;
+	unsigned int rows = 0;
+	uint32_t i = 0;
+
+	for (i = 0; i < num_of_planes; i++) {
+		void *plane = NULL;
+		int stride_width = 0;
+
+		if (media_packet_get_video_plane_data_ptr(packet, i, &plane) != MEDIA_PACKET_ERROR_NONE)
+			return -1;
+		if (media_packet_get_video_stride_width(packet, i, &stride_width) != MEDIA_PACKET_ERROR_NONE)
+			return -1;
+
+		if (image_kernel_get_plane_geometry(camera_data->preview_format, i,
+			camera_data->preview_width, camera_data->preview_height, &row_size, &rows))
+			return -1;
+
+		retv_if(stride_width < (int)row_size, -1);
+		retv_if(dst + row_size * rows > dst_end, -1);
+
+		image_kernel_copy_plane(dst, row_size, plane, stride_width, row_size, rows);
+		dst += row_size * rows;
+	}
+
+	image_buffer->buffer_size = dst - image_buffer->buffer;
+
+	return 0;
+}
+
+static void __camera_media_packet_preview_cb(media_packet_h packet, void *user_data)
+{
+	struct __camera_data *camera_data = user_data;
+	image_buffer_data_s *image_buffer = NULL;
+	unsigned char *data = NULL;
+	unsigned int size = 0;
+	uint32_t num_of_planes = 0;
+
+	if (!frame_governor_accept_frame(camera_data->frame_governor))
+		goto DROP_PACKET;
+
+	if (media_packet_get_number_of_video_planes(packet, &num_of_planes) != MEDIA_PACKET_ERROR_NONE) {
+		_E("Failed to get number of planes");
+		goto DROP_PACKET;
+	}
+
+	image_buffer = frame_pool_acquire(camera_data->frame_pool);
+	if (image_buffer == NULL) {
+		_E("No free frame in pool");
+		goto DROP_PACKET;
+	}
+
+	image_buffer->image_width = camera_data->preview_width;
+	image_buffer->image_height = camera_data->preview_height;
+	image_buffer->format = camera_data->preview_format;
+
+	data = __get_contiguous_packet_data(camera_data, packet, num_of_planes, &size);
+	if (data) {
+		/* The frame keeps the packet and returns it to the camera on its last unref */
+		image_buffer->packet = packet;
+		image_buffer->buffer = data;
+		image_buffer->buffer_size = size;
+	} else {
+		/* Padded planes, fall back to a single copy into the pool frame */
+		if (__copy_packet_planes(camera_data, packet, num_of_planes, image_buffer)) {
+			_E("Failed to copy packet planes");
+			image_buffer_unref(image_buffer);
+			goto DROP_PACKET;
+		}
+		media_packet_destroy(packet);
+	}
+
+	__deliver_preview_image_buffer(camera_data, image_buffer);
+	return;
+
+DROP_PACKET:
+	media_packet_destroy(packet);
+}
+#else /* ENABLE_CAMERA_ZERO_COPY */
+static image_buffer_data_s *__make_preview_image_buffer_data(struct __camera_data *camera_data, camera_preview_data_s *frame)
+{
+	unsigned char *buffer = NULL;
+	unsigned int buffer_size = 0;
+	image_buffer_data_s *image_buffer = NULL;
+	const unsigned char *planes[3] = {NULL, };
+	unsigned int plane_sizes[3] = {0, };
+	unsigned int row_sizes[3] = {0, };
+	unsigned int rows[3] = {0, };
+	unsigned int strides[3] = {0, };
+	int i = 0;
+
+	switch (frame->num_of_planes) {
+	case 1:
+		planes[0] = frame->data.single_plane.yuv;
+		plane_sizes[0] = frame->data.single_plane.size;
+		break;
+	case 2:
+		planes[0] = frame->data.double_plane.y;
+		plane_sizes[0] = frame->data.double_plane.y_size;
+		planes[1] = frame->data.double_plane.uv;
+		plane_sizes[1] = frame->data.double_plane.uv_size;
+		break;
+	case 3:
+		planes[0] = frame->data.triple_plane.y;
+		plane_sizes[0] = frame->data.triple_plane.y_size;
+		planes[1] = frame->data.triple_plane.u;
+		plane_sizes[1] = frame->data.triple_plane.u_size;
+		planes[2] = frame->data.triple_plane.v;
+		plane_sizes[2] = frame->data.triple_plane.v_size;
+		break;
+	default:
+		_E("unhandled num of planes : %d", frame->num_of_planes);
+		return NULL;
+	}
+
+	/* Planes may be padded, the pool frame is always tightly packed */
+	for (i = 0; i < frame->num_of_planes; i++) {
+		if (image_kernel_get_plane_geometry(frame->format, i, frame->width, frame->height, &row_sizes[i], &rows[i]))
+			return NULL;
+
+		if (rows[i] == 0 || plane_sizes[i] < row_sizes[i] * rows[i]) {
+			_E("plane[%d] size [%u] is too small for [%u x %u]", i, plane_sizes[i], row_sizes[i], rows[i]);
+			return NULL;
+		}
+		buffer_size += row_sizes[i] * rows[i];
+	}
+
+	/* Planar format delivered in one buffer, the planes follow each other without padding */
+	if (frame->num_of_planes == 1) {
+		unsigned int frame_size = frame_pool_get_frame_size(frame->format, frame->width, frame->height);
+		if (frame_size > buffer_size) {
+			retvm_if(plane_sizes[0] < frame_size, NULL, "plane size [%u] is too small for [%u]", plane_sizes[0], frame_size);
+			row_sizes[0] = frame_size;
+			rows[0] = 1;
+			buffer_size = frame_size;
+		}
 	}
+
+	/* The preview data carries no stride, it is only known when the rows fill the plane exactly */
+	for (i = 0; i < frame->num_of_planes; i++) {
+		if (plane_sizes[i] % rows[i]) {
+			_E("plane[%d] size [%u] is no multiple of its [%u] rows, unknown stride", i, plane_sizes[i], rows[i]);
+			return NULL;
+		}
+		strides[i] = plane_sizes[i] / rows[i];
+	}
+
+	image_buffer = frame_pool_acquire(camera_data->frame_pool);
+	if (image_buffer == NULL) {
+		_E("No free frame in pool");
+		return NULL;
+	}
+
+	if (buffer_size > image_buffer->buffer_size) {
+		_E("frame size [%u] exceeds pool frame size [%u]", buffer_size, image_buffer->buffer_size);
+		image_buffer_unref(image_buffer);
+		return NULL;
+	}
+
+	buffer = image_buffer->buffer;
+
+	for (i = 0; i < frame->num_of_planes; i++) {
+		image_kernel_copy_plane(buffer, row_sizes[i], planes[i], strides[i], row_sizes[i], rows[i]);
+		buffer += row_sizes[i] * rows[i];
+	}
+
+	image_buffer->image_width = frame->width;
+	image_buffer->image_height = frame->height;
+	image_buffer->buffer_size = buffer_size;
+	image_buffer->format = frame->format;
+
+	return image_buffer;
 }
 
 static void __camera_preview_cb(camera_preview_data_s *frame, void *user_data)
 {
 	struct __camera_data *camera_data = user_data;
-	static long long int last = 0;
-	long long int now = __get_monotonic_ms();
 
-	if (now - last < CAMERA_PREVIEW_INTERVAL_MIN)
+	if (!frame_governor_accept_frame(camera_data->frame_governor))
 		return;
 
-	image_buffer_data_s *image_buffer_data = __make_preview_image_buffer_data(frame);
+	image_buffer_data_s *image_buffer_data = __make_preview_image_buffer_data(camera_data, frame);
 	if (image_buffer_data == NULL) {
 		_E("Failed to create mv source");
 		return;
 	}
-	image_buffer_data->user_data = camera_data->preview_image_buffer_created_cb_data;
 
-	ecore_main_loop_thread_safe_call_async(camera_data->preview_image_buffer_created_cb, image_buffer_data);
-	last = now;
+	__deliver_preview_image_buffer(camera_data, image_buffer_data);
 }
+#endif /* ENABLE_CAMERA_ZERO_COPY */
 
-int resource_camera_init(preview_image_buffer_created_cb preview_image_buffer_created_cb, void *user_data)
+static int __create_frame_pool(struct __camera_data *camera_data)
 {
 	int ret = CAMERA_ERROR_NONE;
+	int width = 0;
+	int height = 0;
+	camera_pixel_format_e format = CAMERA_PIXEL_FORMAT_INVALID;
+	unsigned int frame_size = 0;
+
+	ret = camera_get_preview_resolution(camera_data->cam_handle, &width, &height);
+	if (ret != CAMERA_ERROR_NONE) {
+		_E("Failed to get preview resolution [%s]", __cam_err_to_str(ret));
+		return -1;
+	}
+
+	ret = camera_get_preview_format(camera_data->cam_handle, &format);
+	if (ret != CAMERA_ERROR_NONE) {
+		_E("Failed to get preview format [%s]", __cam_err_to_str(ret));
+		return -1;
+	}
+
+	frame_size = frame_pool_get_frame_size(format, width, height);
+	retv_if(frame_size == 0, -1);
+
+	_I("camera%d preview [%d x %d], format [%d], frame size [%u]",
+		camera_data->camera_index, width, height, format, frame_size);
+
+	camera_data->preview_width = width;
+	camera_data->preview_height = height;
+	camera_data->preview_format = format;
+
+	camera_data->frame_pool = frame_pool_create(CAMERA_FRAME_POOL_SIZE, frame_size);
+	retv_if(!camera_data->frame_pool, -1);
+
+	return 0;
+}
+
+int resource_camera_init(int camera_index, unsigned int width, unsigned int height,
+	preview_image_buffer_created_cb preview_image_buffer_created_cb, void *user_data, resource_camera_h *camera)
+{
+	struct __camera_data *camera_data = NULL;
+	struct __resolution_s resolution = {0, };
+	int ret = CAMERA_ERROR_NONE;
 
 	if (preview_image_buffer_created_cb == NULL)
 		return -1;
 
-	g_camera_data = malloc(sizeof(struct __camera_data));
-	if (g_camera_data == NULL) {
+	retv_if(!camera, -1);
+	retv_if(camera_index < 0, -1);
+
+	camera_data = malloc(sizeof(struct __camera_data));
+	if (camera_data == NULL) {
 		_E("Failed to allocate Camera data");
 		return -1;
 	}
-	memset(g_camera_data, 0, sizeof(struct __camera_data));
+	memset(camera_data, 0, sizeof(struct __camera_data));
+	camera_data->camera_index = camera_index;
+	pthread_mutex_init(&camera_data->capture_mutex, NULL);
+	pthread_cond_init(&camera_data->capture_cond, NULL);
 
-	ret = camera_create(CAMERA_DEVICE_CAMERA0, &(g_camera_data->cam_handle));
+	ret = camera_create(CAMERA_DEVICE_CAMERA0 + camera_index, &(camera_data->cam_handle));
 	if (ret != CAMERA_ERROR_NONE) {
-		_E("Failed to create camera [%s]", __cam_err_to_str(ret));
+		_E("Failed to create camera%d [%s]", camera_index, __cam_err_to_str(ret));
 		goto ERROR;
 	}
 
-	ret = camera_attr_set_image_quality(g_camera_data->cam_handle, CAMERA_IMAGE_QUALITY);
+	ret = camera_attr_set_image_quality(camera_data->cam_handle, CAMERA_IMAGE_QUALITY);
 	if (ret != CAMERA_ERROR_NONE) {
 		_E("Failed to set image quality [%s]", __cam_err_to_str(ret));
 		goto ERROR;
 	}
 
-	ret = camera_set_preview_resolution(g_camera_data->cam_handle, IMAGE_WIDTH, IMAGE_HEIGHT);
+	resolution.width = width;
+	resolution.height = height;
+	ret = camera_foreach_supported_preview_resolution(camera_data->cam_handle, __supported_resolution_cb, &resolution);
+	if (ret != CAMERA_ERROR_NONE || resolution.best_width == 0) {
+		_E("Failed to get supported preview resolutions [%s]", __cam_err_to_str(ret));
+		goto ERROR;
+	}
+
+	/* Preview sizes are far below INT_MAX, so the casts keep their value */
+	if (resolution.best_width != (int)width ||resolution.best_height != (int)height)
+		_W("camera%d does not support [%u x %u], using [%d x %d]", camera_index,
+			width, height, resolution.best_width, resolution.best_height);
+
+	ret = camera_set_preview_resolution(camera_data->cam_handle, resolution.best_width, resolution.best_height);
 	if (ret != CAMERA_ERROR_NONE) {
 		_E("Failed to set preview resolution [%s]", __cam_err_to_str(ret));
 		goto ERROR;
 	}
 
-	ret = camera_set_capture_resolution(g_camera_data->cam_handle, IMAGE_WIDTH, IMAGE_HEIGHT);
+	if (__create_frame_pool(camera_data)) {
+		_E("Failed to create frame pool");
+		goto ERROR;
+	}
+
+	camera_data->frame_governor = frame_governor_create(CAMERA_PREVIEW_FPS_MAX,
+			CAMERA_PREVIEW_FPS_IDLE, CAMERA_SCENE_IDLE_TIMEOUT_MS);
+	if (!camera_data->frame_governor) {
+		_E("Failed to create frame governor");
+		goto ERROR;
+	}
+
+	camera_data->frame_queue = frame_queue_create(CAMERA_FRAME_QUEUE_SIZE,
+			CAMERA_FRAME_QUEUE_POLICY, CAMERA_FRAME_QUEUE_BATCH,
+			__frame_queue_consume_cb, camera_data);
+	if (!camera_data->frame_queue) {
+		_E("Failed to create frame queue");
+		goto ERROR;
+	}
+
+	/* Stills are evidence, capture at the largest size the sensor has */
+	resolution.width = INT_MAX;
+	resolution.height = INT_MAX;
+	resolution.best_width = 0;
+	resolution.best_height = 0;
+	ret = camera_foreach_supported_capture_resolution(camera_data->cam_handle, __supported_resolution_cb, &resolution);
+	if (ret != CAMERA_ERROR_NONE || resolution.best_width == 0) {
+		_E("Failed to get supported capture resolutions [%s]", __cam_err_to_str(ret));
+		goto ERROR;
+	}
+
+	ret = camera_set_capture_resolution(camera_data->cam_handle, resolution.best_width, resolution.best_height);
 	if (ret != CAMERA_ERROR_NONE) {
 		_E("Failed to set capture resolution [%s]", __cam_err_to_str(ret));
 		goto ERROR;
 	}
 
-	ret = camera_set_capture_format(g_camera_data->cam_handle, CAMERA_PIXEL_FORMAT_JPEG);
+	/* A JPEG is smaller than the raw I420 frame, anything larger is dropped */
+	camera_data->capture_pool = frame_pool_create(CAMERA_CAPTURE_POOL_SIZE,
+			frame_pool_get_frame_size(CAMERA_PIXEL_FORMAT_I420, resolution.best_width, resolution.best_height));
+	if (!camera_data->capture_pool) {
+		_E("Failed to create capture pool");
+		goto ERROR;
+	}
+
+	_I("camera%d capture [%d x %d]", camera_index, resolution.best_width, resolution.best_height);
+
+	ret = camera_set_capture_format(camera_data->cam_handle, CAMERA_PIXEL_FORMAT_JPEG);
 	if (ret != CAMERA_ERROR_NONE) {
 		_E("Failed to set capture format [%s]", __cam_err_to_str(ret));
 		goto ERROR;
 	}
 
-	ret = camera_set_state_changed_cb(g_camera_data->cam_handle, __print_camera_state, NULL);
+	ret = camera_set_state_changed_cb(camera_data->cam_handle, __print_camera_state, NULL);
 	if (ret != CAMERA_ERROR_NONE) {
 		_E("Failed to set state changed callback [%s]", __cam_err_to_str(ret));
 		goto ERROR;
 	}
 
-	ret = camera_set_preview_cb(g_camera_data->cam_handle, __camera_preview_cb, g_camera_data);
+#ifdef ENABLE_CAMERA_ZERO_COPY
+	ret = camera_set_media_packet_preview_cb(camera_data->cam_handle, __camera_media_packet_preview_cb, camera_data);
+#else
+	ret = camera_set_preview_cb(camera_data->cam_handle, __camera_preview_cb, camera_data);
+#endif
 	if (ret != CAMERA_ERROR_NONE) {
 		_E("Failed to set preview callback [%s]", __cam_err_to_str(ret));
 		goto ERROR;
 	}
 
-	ret = camera_attr_foreach_supported_af_mode(g_camera_data->cam_handle, __camera_attr_supported_af_mode_cb, g_camera_data);
+	ret = camera_attr_foreach_supported_af_mode(camera_data->cam_handle, __camera_attr_supported_af_mode_cb, camera_data);
 	if (ret != CAMERA_ERROR_NONE) {
 		_E("Failed to set auto focus attribute check callback [%s]", __cam_err_to_str(ret));
 		goto ERROR;
 	}
 
-	g_camera_data->preview_image_buffer_created_cb = preview_image_buffer_created_cb;
-	g_camera_data->preview_image_buffer_created_cb_data = user_data;
+	camera_data->preview_image_buffer_created_cb = preview_image_buffer_created_cb;
+	camera_data->preview_image_buffer_created_cb_data = user_data;
+
+	*camera = camera_data;
 
 	return 0;
 
 ERROR:
-	if (g_camera_data->cam_handle)
-		camera_destroy(g_camera_data->cam_handle);
-
-	free(g_camera_data);
-	g_camera_data = NULL;
+	if (camera_data->cam_handle)
+		camera_destroy(camera_data->cam_handle);
+
+	frame_queue_destroy(camera_data->frame_queue);
+	frame_governor_destroy(camera_data->frame_governor);
+	frame_pool_destroy(camera_data->frame_pool);
+	frame_pool_destroy(camera_data->capture_pool);
+	pthread_cond_destroy(&camera_data->capture_cond);
+	pthread_mutex_destroy(&camera_data->capture_mutex);
+	free(camera_data);
 	return -1;
 }
 
-int resource_camera_start_preview(void)
+int resource_camera_start_preview(resource_camera_h camera_data)
 {
 	camera_state_e state;
 	int ret = CAMERA_ERROR_NONE;
 
-	if (g_camera_data == NULL) {
+	if (camera_data == NULL) {
 		_I("Camera is not initialized");
 		return -1;
 	}
 
-	ret = camera_get_state(g_camera_data->cam_handle, &state);
+	/* Stopped for good, the camera is being closed */
+	if (camera_data->stopped)
+		return -1;
+
+	ret = camera_get_state(camera_data->cam_handle, &state);
 	if (ret != CAMERA_ERROR_NONE) {
 		_E("Failed to get camera state [%s]", __cam_err_to_str(ret));
 		return -1;
@@ -401,7 +761,7 @@ int resource_camera_start_preview(void)
 	}
 
 	if (state != CAMERA_STATE_PREVIEW) {
-		ret = camera_start_preview(g_camera_data->cam_handle);
+		ret = camera_start_preview(camera_data->cam_handle);
 		if (ret != CAMERA_ERROR_NONE) {
 			_E("Failed to start preview [%s]", __cam_err_to_str(ret));
 			return -1;
@@ -411,17 +771,21 @@ int resource_camera_start_preview(void)
 	return 0;
 }
 
-int resource_camera_capture(capture_completed_cb capture_completed_cb, void *user_data)
+int resource_camera_capture(resource_camera_h camera_data, capture_completed_cb capture_completed_cb, void *user_data)
 {
 	camera_state_e state;
 	int ret = CAMERA_ERROR_NONE;
 
-	if (g_camera_data == NULL) {
+	if (camera_data == NULL) {
 		_I("Camera is not initialized");
 		return -1;
 	}
 
-	ret = camera_get_state(g_camera_data->cam_handle, &state);
+	/* Stopped for good, the camera is being closed */
+	if (camera_data->stopped)
+		return -1;
+
+	ret = camera_get_state(camera_data->cam_handle, &state);
 	if (ret != CAMERA_ERROR_NONE) {
 		_E("Failed to get camera state [%s]", __cam_err_to_str(ret));
 		return -1;
@@ -434,35 +798,156 @@ int resource_camera_capture(capture_completed_cb capture_completed_cb, void *use
 
 	if (state != CAMERA_STATE_PREVIEW) {
 		_I("Preview is not started [%d]", state);
-		ret = camera_start_preview(g_camera_data->cam_handle);
+		ret = camera_start_preview(camera_data->cam_handle);
 		if (ret != CAMERA_ERROR_NONE) {
 			_E("Failed to start preview [%s]", __cam_err_to_str(ret));
 			return -1;
 		}
 	}
 
-	__start_capture(g_camera_data);
+	/* Set before starting, the capture completes on the camera thread */
+	camera_data->capture_completed_cb = capture_completed_cb;
+	camera_data->capture_completed_cb_data = user_data;
+	pthread_mutex_lock(&camera_data->capture_mutex);
+	camera_data->capturing = true;
+	pthread_mutex_unlock(&camera_data->capture_mutex);
 
-	g_camera_data->capture_completed_cb = capture_completed_cb;
-	g_camera_data->capture_completed_cb_data = user_data;
+	if (__start_capture(camera_data)) {
+		camera_data->capture_completed_cb = NULL;
+		__capture_done(camera_data);
+		return -1;
+	}
+
+	return 0;
+}
+
+int resource_camera_get_preview_resolution(resource_camera_h camera_data, unsigned int *width, unsigned int *height)
+{
+	retv_if(!camera_data, -1);
+	retv_if(!width, -1);
+	retv_if(!height, -1);
+
+	*width = camera_data->preview_width;
+	*height = camera_data->preview_height;
 
 	return 0;
 }
 
-void resource_camera_close(void)
+int resource_camera_get_frame_pool_stats(resource_camera_h camera_data, frame_pool_stats_s *stats)
 {
-	if (g_camera_data == NULL)
+	retv_if(!camera_data, -1);
+	retv_if(!camera_data->frame_pool, -1);
+	retv_if(!stats, -1);
+
+	frame_pool_get_stats(camera_data->frame_pool, stats);
+
+	return 0;
+}
+
+int resource_camera_get_frame_queue_stats(resource_camera_h camera_data, frame_queue_stats_s *stats)
+{
+	retv_if(!camera_data, -1);
+	retv_if(!camera_data->frame_queue, -1);
+	retv_if(!stats, -1);
+
+	frame_queue_get_stats(camera_data->frame_queue, stats);
+
+	return 0;
+}
+
+frame_governor_h resource_camera_get_frame_governor(resource_camera_h camera_data)
+{
+	retv_if(!camera_data, NULL);
+
+	return camera_data->frame_governor;
+}
+
+void resource_camera_stop(resource_camera_h camera_data)
+{
+	ret_if(!camera_data);
+
+	camera_state_e state = CAMERA_STATE_NONE;
+	struct timespec deadline;
+	int ret = CAMERA_ERROR_NONE;
+
+	if (camera_data->stopped)
 		return;
 
-	camera_unset_preview_cb(g_camera_data->cam_handle);
-	camera_stop_preview(g_camera_data->cam_handle);
+#ifdef ENABLE_CAMERA_ZERO_COPY
+	camera_unset_media_packet_preview_cb(camera_data->cam_handle);
+#else
+	camera_unset_preview_cb(camera_data->cam_handle);
+#endif
+
+	/* A still in flight completes into nothing, the camera leaves CAPTURING first */
+	clock_gettime(CLOCK_REALTIME, &deadline);
+	deadline.tv_sec += CAMERA_CAPTURE_STOP_TIMEOUT_MS / 1000;
+	deadline.tv_nsec += (CAMERA_CAPTURE_STOP_TIMEOUT_MS % 1000) * 1000000L;
+	if (deadline.tv_nsec >= 1000000000L) {
+		deadline.tv_sec++;
+		deadline.tv_nsec -= 1000000000L;
+	}
 
-	camera_destroy(g_camera_data->cam_handle);
-	g_camera_data->cam_handle = NULL;
+	pthread_mutex_lock(&camera_data->capture_mutex);
+	camera_data->stopped = true;
+	while (camera_data->capturing) {
+		if (pthread_cond_timedwait(&camera_data->capture_cond, &camera_data->capture_mutex, &deadline)) {
+			_E("camera%d still capturing after %d ms", camera_data->camera_index, CAMERA_CAPTURE_STOP_TIMEOUT_MS);
+			break;
+		}
+	}
+	pthread_mutex_unlock(&camera_data->capture_mutex);
 
-	free(g_camera_data->captured_file);
-	g_camera_data->captured_file = NULL;
+	/* A completed still leaves the camera CAPTURED, it only goes back through the preview, no callback is set anymore */
+	if (camera_get_state(camera_data->cam_handle, &state) == CAMERA_ERROR_NONE && state == CAMERA_STATE_CAPTURED)
+		camera_start_preview(camera_data->cam_handle);
 
-	free(g_camera_data);
-	g_camera_data = NULL;
+	ret = camera_stop_preview(camera_data->cam_handle);
+	if (ret != CAMERA_ERROR_NONE)
+		_E("Failed to stop preview [%s]", __cam_err_to_str(ret));
 }
+
+void resource_camera_close(resource_camera_h camera_data)
+{
+	if (camera_data == NULL)
+		return;
+
+	resource_camera_stop(camera_data);
+
+	if (camera_data->captured_image) {
+		image_buffer_unref(camera_data->captured_image);
+		camera_data->captured_image = NULL;
+	}
+
+	/* Frames may wrap camera packets, the queued ones go back before the camera goes away */
+	frame_queue_destroy(camera_data->frame_queue);
+	camera_data->frame_queue = NULL;
+
+#ifdef ENABLE_CAMERA_ZERO_COPY
+	if (camera_data->frame_pool) {
+		frame_pool_stats_s stats = {0, };
+
+		frame_pool_get_stats(camera_data->frame_pool, &stats);
+		if (stats.in_use)
+			_W("%u frames still in use, their packets outlive the camera", stats.in_use);
+	}
+#endif
+
+	camera_destroy(camera_data->cam_handle);
+	camera_data->cam_handle = NULL;
+
+	frame_governor_destroy(camera_data->frame_governor);
+	camera_data->frame_governor = NULL;
+
+	frame_pool_destroy(camera_data->frame_pool);
+	camera_data->frame_pool = NULL;
+
+	frame_pool_destroy(camera_data->capture_pool);
+	camera_data->capture_pool = NULL;
+
+	pthread_cond_destroy(&camera_data->capture_cond);
+	pthread_mutex_destroy(&camera_data->capture_mutex);
+	free(camera_data);
+}
+
+#endif /* !CAMERA_BACKEND_SYNTHETIC */
@@ -0,0 +1,734 @@
+ /*
+ * Copyright (c) 2018 Samsung Electronics Co., Ltd.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Camera backend without camera, for profiling and regression tests.
+ * It replays raw YUV / Y4M files or renders moving boxes, and feeds the
+ * frames through the same pool, governor and queue as the real camera.
+ *
+ * SYNTHETIC_CAMERA_FILE   : .y4m (4:2:0, its size wins over the requested one) or
+ *                           raw file in SYNTHETIC_CAMERA_FORMAT at the requested
+ *                           size, procedural scene when not set. A comma separated
+ *                           list gives one file per camera index, the last
+ *                           entry is reused for the remaining cameras
+ * SYNTHETIC_CAMERA_FORMAT : NV12, I420 or YUYV (default NV12)
+ * SYNTHETIC_CAMERA_FPS    : frame rate, 0 runs as fast as the pipeline consumes
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <glib.h>
+#include <tizen.h>
+#include <Ecore.h>
+#include <camera.h>
+
+#include "log.h"
+#include "controller.h"
+#include "resource_camera.h"
+
+#ifdef CAMERA_BACKEND_SYNTHETIC
+
+#include <image_util.h>
+#include "frame_pool.h"
+#include "frame_queue.h"
+#include "frame_governor.h"
+#include "frame_trace.h"
+#include "image_kernel.h"
+
+#define SYNTHETIC_ENV_FILE "SYNTHETIC_CAMERA_FILE"
+#define SYNTHETIC_ENV_FORMAT "SYNTHETIC_CAMERA_FORMAT"
+#define SYNTHETIC_ENV_FPS "SYNTHETIC_CAMERA_FPS"
+#define SYNTHETIC_FPS_DEFAULT 30
+#define SYNTHETIC_OBJECT_COUNT 3
+#define SYNTHETIC_NOISE_AMPLITUDE 4
+#define SYNTHETIC_BACKPRESSURE_SLEEP_US 1000
+#define Y4M_FRAME_HEADER "FRAME"
+
+typedef enum {
+	SYNTHETIC_SOURCE_PROCEDURAL,
+	SYNTHETIC_SOURCE_RAW,
+	SYNTHETIC_SOURCE_Y4M,
+} synthetic_source_e;
+
+struct __synthetic_object {
+	int x;
+	int y;
+	int dx;
+	int dy;
+	int width;
+	int height;
+	unsigned char luma;
+	unsigned char u;
+	unsigned char v;
+};
+
+struct __camera_data {
+	int camera_index;
+	frame_pool_h frame_pool;
+	frame_pool_h capture_pool;
+	frame_queue_h frame_queue;
+	frame_governor_h frame_governor;
+
+	int preview_width;
+	int preview_height;
+	camera_pixel_format_e preview_format;
+	unsigned int fps;
+
+	synthetic_source_e source;
+	FILE *file;
+	long file_data_offset;
+	unsigned char *scratch; // I420 frame the output format is converted from
+	struct __synthetic_object objects[SYNTHETIC_OBJECT_COUNT];
+	unsigned int noise_seed;
+	unsigned int frame_count;
+
+	pthread_t thread;
+	bool thread_started;
+	volatile gint running;
+	volatile gint previewing;
+
+	preview_image_buffer_created_cb preview_image_buffer_created_cb;
+	void *preview_image_buffer_created_cb_data;
+
+	capture_completed_cb capture_completed_cb;
+	void *capture_completed_cb_data;
+	pthread_mutex_t mutex;
+};
+
+static long long int __get_monotonic_us(void)
+{
+	long long int ret_time = 0;
+	struct timespec time_s;
+
+	if (0 == clock_gettime(CLOCK_MONOTONIC, &time_s))
+		ret_time = time_s.tv_sec * 1000000LL + time_s.tv_nsec / 1000;
+	else
+		_E("Failed to get time");
+
+	return ret_time;
+}
+
+static camera_pixel_format_e __format_from_str(const char *str)
+{
+	if (!str || !g_strcmp0(str, "NV12"))
+		return CAMERA_PIXEL_FORMAT_NV12;
+	if (!g_strcmp0(str, "I420"))
+		return CAMERA_PIXEL_FORMAT_I420;
+	if (!g_strcmp0(str, "YUYV"))
+		return CAMERA_PIXEL_FORMAT_YUYV;
+
+	_E("unsupported synthetic format : %s", str);
+	return CAMERA_PIXEL_FORMAT_INVALID;
+}
+
+static image_util_colorspace_e __format_to_image_util(camera_pixel_format_e format)
+{
+	switch (format) {
+	case CAMERA_PIXEL_FORMAT_NV12:
+		return IMAGE_UTIL_COLORSPACE_NV12;
+	case CAMERA_PIXEL_FORMAT_YUYV:
+		return IMAGE_UTIL_COLORSPACE_YUYV;
+	default:
+		return IMAGE_UTIL_COLORSPACE_I420;
+	}
+}
+
+/* 420p10 and the like have the same prefix but 16 bit samples */
+static bool __is_8bit_420(const char *colorspace)
+{
+	return !strcmp(colorspace, "420") || !strcmp(colorspace, "420jpeg")
+		|| !strcmp(colorspace, "420paldv") || !strcmp(colorspace, "420mpeg2");
+}
+
+/* YUV4MPEG2 W320 H240 F30:1 Ip A1:1 C420jpeg */
+static int __open_y4m(struct __camera_data *camera_data, FILE *file)
+{
+	char header[256] = {'\0', };
+	char *token = NULL;
+	char *saveptr = NULL;
+	int width = 0;
+	int height = 0;
+
+	retv_if(!fgets(header, sizeof(header), file), -1);
+	retvm_if(strncmp(header, "YUV4MPEG2", 9), -1, "not a y4m file");
+
+	for (token = strtok_r(header, " \n", &saveptr); token; token = strtok_r(NULL, " \n", &saveptr)) {
+		if (token[0] == 'W')
+			width = atoi(token + 1);
+		else if (token[0] == 'H')
+			height = atoi(token + 1);
+		else if (token[0] == 'C')
+			retvm_if(!__is_8bit_420(token + 1), -1, "only 8 bit 4:2:0 y4m files are supported [%s]", token);
+	}
+
+	retvm_if(width <= 0 || height <= 0 || (width & 1) || (height & 1), -1,
+		"unsupported y4m resolution [%d x %d]", width, height);
+
+	if (width != camera_data->preview_width || height != camera_data->preview_height)
+		_W("y4m resolution [%d x %d] replaces preview [%d x %d]",
+			width, height, camera_data->preview_width, camera_data->preview_height);
+
+	camera_data->preview_width = width;
+	camera_data->preview_height = height;
+
+	camera_data->file_data_offset = ftell(file);
+
+	return 0;
+}
+
+static gchar *__get_source_path(int camera_index)
+{
+	const char *paths = getenv(SYNTHETIC_ENV_FILE);
+	gchar **entries = NULL;
+	gchar *path = NULL;
+	int count = 0;
+
+	if (!paths || !paths[0])
+		return NULL;
+
+	entries = g_strsplit(paths, ",", -1);
+	count = g_strv_length(entries);
+	if (count > 0)
+		path = g_strdup(g_strstrip(entries[camera_index < count ? camera_index : count - 1]));
+	g_strfreev(entries);
+
+	return path;
+}
+
+static int __open_source(struct __camera_data *camera_data)
+{
+	gchar *path = __get_source_path(camera_data->camera_index);
+	const char *ext = NULL;
+	int i = 0;
+
+	if (!path || !path[0]) {
+		g_free(path);
+		camera_data->source = SYNTHETIC_SOURCE_PROCEDURAL;
+
+		for (i = 0; i < SYNTHETIC_OBJECT_COUNT; i++) {
+			struct __synthetic_object *object = &camera_data->objects[i];
+
+			object->width = camera_data->preview_width / (6 + 2 * i);
+			object->height = camera_data->preview_height / (4 + 2 * i);
+			object->x = (camera_data->preview_width / SYNTHETIC_OBJECT_COUNT) * i;
+			object->y = (camera_data->preview_height / SYNTHETIC_OBJECT_COUNT) * i;
+			/* Every camera gets its own traffic */
+			object->dx = 2 + i + camera_data->camera_index;
+			object->dy = 1 + i;
+			object->luma = 40 + 90 * i;
+			object->u = 90 + 30 * i;
+			object->v = 170 - 30 * i;
+		}
+		camera_data->noise_seed = 1 + camera_data->camera_index;
+
+		_I("synthetic camera%d - procedural scene", camera_data->camera_index);
+		return 0;
+	}
+
+	camera_data->file = fopen(path, "rb");
+	if (!camera_data->file) {
+		_E("failed to open %s", path);
+		g_free(path);
+		return -1;
+	}
+
+	ext = strrchr(path, '.');
+	if (ext && !g_strcmp0(ext, ".y4m")) {
+		camera_data->source = SYNTHETIC_SOURCE_Y4M;
+		if (__open_y4m(camera_data, camera_data->file)) {
+			fclose(camera_data->file);
+			camera_data->file = NULL;
+			g_free(path);
+			return -1;
+		}
+	} else {
+		camera_data->source = SYNTHETIC_SOURCE_RAW;
+		camera_data->file_data_offset = 0;
+	}
+
+	_I("synthetic camera%d - replaying %s", camera_data->camera_index, path);
+	g_free(path);
+
+	return 0;
+}
+
+static int __read_file_frame(struct __camera_data *camera_data, unsigned char *dst, unsigned int size)
+{
+	char header[64] = {'\0', };
+	int retry = 0;
+
+	/* Rewind at the end of the file and loop the clip */
+	for (retry = 0; retry < 2; retry++) {
+		if (camera_data->source == SYNTHETIC_SOURCE_Y4M) {
+			if (!fgets(header, sizeof(header), camera_data->file)
+				|| strncmp(header, Y4M_FRAME_HEADER, strlen(Y4M_FRAME_HEADER))) {
+				fseek(camera_data->file, camera_data->file_data_offset, SEEK_SET);
+				continue;
+			}
+		}
+
+		if (fread(dst, 1, size, camera_data->file) == size)
+			return 0;
+
+		fseek(camera_data->file, camera_data->file_data_offset, SEEK_SET);
+	}
+
+	_E("failed to read a frame of %u bytes", size);
+	return -1;
+}
+
+static void __render_procedural_frame(struct __camera_data *camera_data, unsigned char *i420)
+{
+	int width = camera_data->preview_width;
+	int height = camera_data->preview_height;
+	unsigned char *y_plane = i420;
+	unsigned char *u_plane = i420 + width * height;
+	unsigned char *v_plane = u_plane + (width / 2) * (height / 2);
+	unsigned int seed = camera_data->noise_seed;
+	int x = 0;
+	int y = 0;
+	int i = 0;
+
+	/* Static gradient with a little sensor noise */
+	for (y = 0; y < height; y++) {
+		for (x = 0; x < width; x++) {
+			int value = 64 + (x + y) * 128 / (width + height);
+			seed = seed * 1103515245 + 12345;
+			value += (int)((seed >> 16) % (2 * SYNTHETIC_NOISE_AMPLITUDE + 1)) - SYNTHETIC_NOISE_AMPLITUDE;
+			y_plane[y * width + x] = (unsigned char)value;
+		}
+	}
+	memset(u_plane, 128, (width / 2) * (height / 2));
+	memset(v_plane, 128, (width / 2) * (height / 2));
+	camera_data->noise_seed = seed;
+
+	for (i = 0; i < SYNTHETIC_OBJECT_COUNT; i++) {
+		struct __synthetic_object *object = &camera_data->objects[i];
+
+		object->x += object->dx;
+		object->y += object->dy;
+		if (object->x < 0 || object->x + object->width > width) {
+			object->dx = -object->dx;
+			object->x += 2 * object->dx;
+		}
+		if (object->y < 0 || object->y + object->height > height) {
+			object->dy = -object->dy;
+			object->y += 2 * object->dy;
+		}
+
+		for (y = object->y; y < object->y + object->height; y++)
+			memset(y_plane + y * width + object->x, object->luma, object->width);
+
+		for (y = object->y / 2; y < (object->y + object->height) / 2; y++) {
+			memset(u_plane + y * (width / 2) + object->x / 2, object->u, object->width / 2);
+			memset(v_plane + y * (width / 2) + object->x / 2, object->v, object->width / 2);
+		}
+	}
+}
+
+static void __convert_from_i420(struct __camera_data *camera_data, const unsigned char *i420, unsigned char *dst)
+{
+	int width = camera_data->preview_width;
+	int height = camera_data->preview_height;
+	const unsigned char *y_plane = i420;
+	const unsigned char *u_plane = i420 + width * height;
+	const unsigned char *v_plane = u_plane + (width / 2) * (height / 2);
+	int x = 0;
+	int y = 0;
+
+	switch (camera_data->preview_format) {
+	case CAMERA_PIXEL_FORMAT_I420:
+		memcpy(dst, i420, width * height * 3 / 2);
+		break;
+	case CAMERA_PIXEL_FORMAT_NV12:
+		image_kernel_i420_to_nv12(y_plane, u_plane, v_plane, dst, dst + width * height, width, height);
+		break;
+	case CAMERA_PIXEL_FORMAT_YUYV:
+		for (y = 0; y < height; y++) {
+			const unsigned char *u_row = u_plane + (y / 2) * (width / 2);
+			const unsigned char *v_row = v_plane + (y / 2) * (width / 2);
+			for (x = 0; x < width; x += 2) {
+				*dst++ = y_plane[y * width + x];
+				*dst++ = u_row[x / 2];
+				*dst++ = y_plane[y * width + x + 1];
+				*dst++ = v_row[x / 2];
+			}
+		}
+		break;
+	default:
+		break;
+	}
+}
+
+static int __fill_frame(struct __camera_data *camera_data, image_buffer_data_s *image_buffer)
+{
+	unsigned int i420_size = camera_data->preview_width * camera_data->preview_height * 3 / 2;
+
+	switch (camera_data->source) {
+	case SYNTHETIC_SOURCE_RAW:
+		/* Raw files already are in the preview format */
+		if (__read_file_frame(camera_data, image_buffer->buffer, image_buffer->buffer_size))
+			return -1;
+		break;
+	case SYNTHETIC_SOURCE_Y4M:
+		if (__read_file_frame(camera_data, camera_data->scratch, i420_size))
+			return -1;
+		__convert_from_i420(camera_data, camera_data->scratch, image_buffer->buffer);
+		break;
+	default:
+		__render_procedural_frame(camera_data, camera_data->scratch);
+		__convert_from_i420(camera_data, camera_data->scratch, image_buffer->buffer);
+		break;
+	}
+
+	image_buffer->image_width = camera_data->preview_width;
+	image_buffer->image_height = camera_data->preview_height;
+	image_buffer->format = camera_data->preview_format;
+	camera_data->frame_count++;
+
+	return 0;
+}
+
+static void __complete_capture(struct __camera_data *camera_data, image_buffer_data_s *image_buffer)
+{
+	capture_completed_cb completed_cb = NULL;
+	void *completed_cb_data = NULL;
+	image_util_encode_h encode_h = NULL;
+	image_buffer_data_s *still = NULL;
+	unsigned char *encoded = NULL;
+	unsigned long long size = 0;
+	int ret = 0;
+
+	pthread_mutex_lock(&camera_data->mutex);
+	completed_cb = camera_data->capture_completed_cb;
+	completed_cb_data = camera_data->capture_completed_cb_data;
+	camera_data->capture_completed_cb = NULL;
+	pthread_mutex_unlock(&camera_data->mutex);
+
+	if (!completed_cb)
+		return;
+
+	ret = image_util_encode_create(IMAGE_UTIL_JPEG, &encode_h);
+	retm_if(ret != IMAGE_UTIL_ERROR_NONE, "image_util_encode_create [%s]", get_error_message(ret));
+
+	image_util_encode_set_resolution(encode_h, image_buffer->image_width, image_buffer->image_height);
+	image_util_encode_set_colorspace(encode_h, __format_to_image_util(image_buffer->format));
+	image_util_encode_set_quality(encode_h, CAMERA_IMAGE_QUALITY);
+	image_util_encode_set_input_buffer(encode_h, image_buffer->buffer);
+	image_util_encode_set_output_buffer(encode_h, &encoded);
+
+	ret = image_util_encode_run(encode_h, &size);
+	if (ret != IMAGE_UTIL_ERROR_NONE) {
+		_E("image_util_encode_run [%s]", get_error_message(ret));
+		goto OUT;
+	}
+
+	/* The still is the preview frame itself, there is no larger sensor to read */
+	still = frame_pool_acquire(camera_data->capture_pool);
+	goto_if(!still, OUT);
+	if (size > still->buffer_size) {
+		_E("encoded image [%llu] exceeds capture buffer [%u]", size, still->buffer_size);
+		image_buffer_unref(still);
+		goto OUT;
+	}
+
+	memcpy(still->buffer, encoded, size);
+	still->buffer_size = size;
+	still->image_width = image_buffer->image_width;
+	still->image_height = image_buffer->image_height;
+	still->format = CAMERA_PIXEL_FORMAT_JPEG;
+	still->timestamp_us = image_buffer->timestamp_us;
+	completed_cb(still, completed_cb_data);
+
+OUT:
+	free(encoded);
+	image_util_encode_destroy(encode_h);
+}
+
+static void __wait_for_backpressure(struct __camera_data *camera_data)
+{
+	frame_queue_stats_s stats = {0, };
+
+	/* Max throughput mode never drops, it waits until analysis catches up */
+	while (g_atomic_int_get(&camera_data->running)) {
+		frame_queue_get_stats(camera_data->frame_queue, &stats);
+		if (stats.depth < stats.capacity)
+			break;
+		usleep(SYNTHETIC_BACKPRESSURE_SLEEP_US);
+	}
+}
+
+static void *__generator_thread(void *data)
+{
+	struct __camera_data *camera_data = data;
+	image_buffer_data_s *image_buffer = NULL;
+	long long int next_frame_time = __get_monotonic_us();
+	long long int now = 0;
+	bool max_throughput = (camera_data->fps == 0);
+
+	while (g_atomic_int_get(&camera_data->running)) {
+		if (!max_throughput) {
+			next_frame_time += 1000000 / camera_data->fps;
+			now = __get_monotonic_us();
+			if (next_frame_time > now)
+				usleep(next_frame_time - now);
+			else
+				next_frame_time = now; // fell behind, do not burst
+		}
+
+		if (!g_atomic_int_get(&camera_data->previewing))
+			continue;
+
+		if (max_throughput) {
+			__wait_for_backpressure(camera_data);
+		} else if (!frame_governor_accept_frame(camera_data->frame_governor)) {
+			continue;
+		}
+
+		image_buffer = frame_pool_acquire(camera_data->frame_pool);
+		if (!image_buffer) {
+			if (max_throughput)
+				usleep(SYNTHETIC_BACKPRESSURE_SLEEP_US);
+			continue;
+		}
+
+		if (__fill_frame(camera_data, image_buffer)) {
+			image_buffer_unref(image_buffer);
+			continue;
+		}
+
+		__complete_capture(camera_data, image_buffer);
+
+		/* Rendering or reading the frame stands for the sensor readout */
+		image_buffer->trace_time_us = frame_trace_get_time_us();
+		frame_trace_record(FRAME_TRACE_STAGE_CAPTURE, camera_data->camera_index, image_buffer->sequence,
+			image_buffer->timestamp_us, image_buffer->trace_time_us);
+
+		frame_queue_push(camera_data->frame_queue, image_buffer);
+	}
+
+	return NULL;
+}
+
+static void __frame_queue_consume_cb(image_buffer_data_s *image_buffer, void *user_data)
+{
+	struct __camera_data *camera_data = user_data;
+	long long int now = frame_trace_get_time_us();
+
+	frame_trace_record(FRAME_TRACE_STAGE_QUEUE, camera_data->camera_index, image_buffer->sequence,
+		image_buffer->trace_time_us, now);
+	image_buffer->trace_time_us = now;
+
+	image_buffer->user_data = camera_data->preview_image_buffer_created_cb_data;
+	camera_data->preview_image_buffer_created_cb(image_buffer);
+}
+
+int resource_camera_init(int camera_index, unsigned int width, unsigned int height,
+	preview_image_buffer_created_cb preview_image_buffer_created_cb, void *user_data, resource_camera_h *camera)
+{
+	struct __camera_data *camera_data = NULL;
+	const char *fps = getenv(SYNTHETIC_ENV_FPS);
+	unsigned int frame_size = 0;
+
+	if (preview_image_buffer_created_cb == NULL)
+		return -1;
+
+	retv_if(!camera, -1);
+	retv_if(camera_index < 0, -1);
+
+	camera_data = calloc(1, sizeof(struct __camera_data));
+	if (camera_data == NULL) {
+		_E("Failed to allocate Camera data");
+		return -1;
+	}
+	pthread_mutex_init(&camera_data->mutex, NULL);
+
+	/* Any even size is supported, a y4m clip brings its own */
+	camera_data->camera_index = camera_index;
+	camera_data->preview_width = width & ~1;
+	camera_data->preview_height = height & ~1;
+	camera_data->preview_format = __format_from_str(getenv(SYNTHETIC_ENV_FORMAT));
+	camera_data->fps = fps ? (unsigned int)atoi(fps) : SYNTHETIC_FPS_DEFAULT;
+	goto_if(camera_data->preview_format == CAMERA_PIXEL_FORMAT_INVALID, ERROR);
+	goto_if(camera_data->preview_width == 0 || camera_data->preview_height == 0, ERROR);
+
+	goto_if(__open_source(camera_data), ERROR);
+
+	frame_size = frame_pool_get_frame_size(camera_data->preview_format,
+			camera_data->preview_width, camera_data->preview_height);
+	goto_if(frame_size == 0, ERROR);
+
+	_I("synthetic camera%d [%d x %d], format [%d], fps [%u]", camera_data->camera_index,
+		camera_data->preview_width, camera_data->preview_height,
+		camera_data->preview_format, camera_data->fps);
+
+	camera_data->scratch = malloc(camera_data->preview_width * camera_data->preview_height * 3 / 2);
+	goto_if(!camera_data->scratch, ERROR);
+
+	camera_data->frame_pool = frame_pool_create(CAMERA_FRAME_POOL_SIZE, frame_size);
+	goto_if(!camera_data->frame_pool, ERROR);
+
+	camera_data->capture_pool = frame_pool_create(CAMERA_CAPTURE_POOL_SIZE,
+			frame_pool_get_frame_size(CAMERA_PIXEL_FORMAT_I420, camera_data->preview_width, camera_data->preview_height));
+	goto_if(!camera_data->capture_pool, ERROR);
+
+	camera_data->frame_governor = frame_governor_create(CAMERA_PREVIEW_FPS_MAX,
+			CAMERA_PREVIEW_FPS_IDLE, CAMERA_SCENE_IDLE_TIMEOUT_MS);
+	goto_if(!camera_data->frame_governor, ERROR);
+
+	camera_data->frame_queue = frame_queue_create(CAMERA_FRAME_QUEUE_SIZE,
+			CAMERA_FRAME_QUEUE_POLICY, CAMERA_FRAME_QUEUE_BATCH,
+			__frame_queue_consume_cb, camera_data);
+	goto_if(!camera_data->frame_queue, ERROR);
+
+	camera_data->preview_image_buffer_created_cb = preview_image_buffer_created_cb;
+	camera_data->preview_image_buffer_created_cb_data = user_data;
+
+	g_atomic_int_set(&camera_data->running, 1);
+	if (pthread_create(&camera_data->thread, NULL, __generator_thread, camera_data)) {
+		_E("Failed to create generator thread");
+		goto ERROR;
+	}
+	camera_data->thread_started = true;
+
+	*camera = camera_data;
+
+	return 0;
+
+ERROR:
+	resource_camera_close(camera_data);
+	return -1;
+}
+
+int resource_camera_start_preview(resource_camera_h camera_data)
+{
+	if (camera_data == NULL) {
+		_I("Camera is not initialized");
+		return -1;
+	}
+
+	g_atomic_int_set(&camera_data->previewing, 1);
+
+	return 0;
+}
+
+int resource_camera_capture(resource_camera_h camera_data, capture_completed_cb capture_completed_cb, void *user_data)
+{
+	if (camera_data == NULL) {
+		_I("Camera is not initialized");
+		return -1;
+	}
+
+	/* Stopped for good, the camera is being closed */
+	if (!g_atomic_int_get(&camera_data->running))
+		return -1;
+
+	pthread_mutex_lock(&camera_data->mutex);
+	if (camera_data->capture_completed_cb) {
+		pthread_mutex_unlock(&camera_data->mutex);
+		_D("Camera is now capturing");
+		return -1;
+	}
+	camera_data->capture_completed_cb = capture_completed_cb;
+	camera_data->capture_completed_cb_data = user_data;
+	pthread_mutex_unlock(&camera_data->mutex);
+
+	/* The next generated frame is encoded and handed over */
+	g_atomic_int_set(&camera_data->previewing, 1);
+
+	return 0;
+}
+
+int resource_camera_get_preview_resolution(resource_camera_h camera_data, unsigned int *width, unsigned int *height)
+{
+	retv_if(!camera_data, -1);
+	retv_if(!width, -1);
+	retv_if(!height, -1);
+
+	*width = camera_data->preview_width;
+	*height = camera_data->preview_height;
+
+	return 0;
+}
+
+int resource_camera_get_frame_pool_stats(resource_camera_h camera_data, frame_pool_stats_s *stats)
+{
+	retv_if(!camera_data, -1);
+	retv_if(!camera_data->frame_pool, -1);
+	retv_if(!stats, -1);
+
+	frame_pool_get_stats(camera_data->frame_pool, stats);
+
+	return 0;
+}
+
+int resource_camera_get_frame_queue_stats(resource_camera_h camera_data, frame_queue_stats_s *stats)
+{
+	retv_if(!camera_data, -1);
+	retv_if(!camera_data->frame_queue, -1);
+	retv_if(!stats, -1);
+
+	frame_queue_get_stats(camera_data->frame_queue, stats);
+
+	return 0;
+}
+
+frame_governor_h resource_camera_get_frame_governor(resource_camera_h camera_data)
+{
+	retv_if(!camera_data, NULL);
+
+	return camera_data->frame_governor;
+}
+
+void resource_camera_stop(resource_camera_h camera_data)
+{
+	ret_if(!camera_data);
+
+	/* The generator thread delivers the frames and the stills */
+	g_atomic_int_set(&camera_data->running, 0);
+	if (camera_data->thread_started) {
+		pthread_join(camera_data->thread, NULL);
+		camera_data->thread_started = false;
+	}
+}
+
+void resource_camera_close(resource_camera_h camera_data)
+{
+	if (camera_data == NULL)
+		return;
+
+	resource_camera_stop(camera_data);
+
+	_I("synthetic camera%d - %u frames generated", camera_data->camera_index, camera_data->frame_count);
+
+	frame_queue_destroy(camera_data->frame_queue);
+	frame_governor_destroy(camera_data->frame_governor);
+	frame_pool_destroy(camera_data->frame_pool);
+	frame_pool_destroy(camera_data->capture_pool);
+
+	if (camera_data->file)
+		fclose(camera_data->file);
+	free(camera_data->scratch);
+
+	pthread_mutex_destroy(&camera_data->mutex);
+	free(camera_data);
+}
+
+#endif /* CAMERA_BACKEND_SYNTHETIC */